@@ -0,0 +1,27 @@
+#include "arena.hpp"
+#include <algorithm>
+
+using namespace AST;
+
+Arena::~Arena() {
+  for (auto destructor = this->destructors.rbegin();
+       destructor != this->destructors.rend(); ++destructor) {
+    destructor->destroy(destructor->object);
+  }
+}
+
+void *Arena::allocateBlock(std::size_t size, std::size_t align) {
+  // Oversized requests get a block of their own and leave the current one
+  // in use.
+  auto blockSize = std::max(BLOCK_SIZE, size + align);
+  this->blocks.emplace_back(new char[blockSize]);
+  auto *block = this->blocks.back().get();
+  auto address = reinterpret_cast<std::uintptr_t>(block);
+  auto *start = block + (((address + align - 1) & ~(align - 1)) - address);
+  if (blockSize == BLOCK_SIZE || !this->cursor) {
+    this->cursor = start + size;
+    this->limit = block + blockSize;
+  }
+  this->used += size;
+  return start;
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <source.hpp>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AST {
+/*
+
+  Arena
+
+  Every node of one parse is bump-allocated from large blocks owned by an
+  Arena and freed with it in one go. Nodes point at their children with raw
+  pointers and keep their child lists in the arena as well, so dropping a
+  program releases a handful of blocks instead of walking millions of
+  reference counts. The few objects that still need their destructor run
+  are recorded when they're made and destroyed in reverse order.
+
+  The arena also owns the Source the nodes' tokens point into, and whatever
+  needs nodes to outlive their Program, like a function value holding on to
+  its body, keeps the whole arena alive instead. Function bodies the parser
+  only brace-matched are parsed into the same arena when they're first
+  needed, through the body parser it leaves here. A program read back from
+  a cache file leaves one that builds them from that file instead, and the
+  arena keeps the file open for it.
+
+*/
+class BlockStatement;
+class FunctionLiteral;
+
+
+template <class T>
+class Span {
+ private:
+  const T *_data = nullptr;
+  std::size_t _size = 0;
+
+ public:
+  Span() = default;
+  Span(const T *data, std::size_t size) : _data(data), _size(size) {}
+  const T *begin() const { return this->_data; }
+  const T *end() const { return this->_data + this->_size; }
+  std::size_t size() const { return this->_size; }
+  bool empty() const { return this->_size == 0; }
+  const T &operator[](std::size_t index) const { return this->_data[index]; }
+  const T &front() const { return this->_data[0]; }
+  const T &back() const { return this->_data[this->_size - 1]; }
+};
+
+class Arena : public std::enable_shared_from_this<Arena> {
+ public:
+  // Parses the deferred body of `literal`, or sets `error` and returns
+  // nullptr if it has syntax errors.
+  typedef BlockStatement *(*BodyParser)(Arena &arena,
+                                        const FunctionLiteral &literal,
+                                        std::string &error);
+
+ private:
+  static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Destructor {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  Source source;
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char *cursor = nullptr;
+  char *limit = nullptr;
+  std::size_t used = 0;
+  std::vector<Destructor> destructors;
+  BodyParser bodyParser = nullptr;
+  // What bodyParser reads from when it isn't the source.
+  Source bodySource;
+  std::vector<FunctionLiteral *> _deferred;
+
+  void *allocateBlock(std::size_t size, std::size_t align);
+
+ public:
+  explicit Arena(Source source = nullptr) : source(std::move(source)) {}
+  ~Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  const Source &getSource() const { return this->source; }
+  void setBodyParser(BodyParser parser, Source from = nullptr) {
+    this->bodyParser = parser;
+    this->bodySource = std::move(from);
+  }
+  const Source &getBodySource() const { return this->bodySource; }
+  BlockStatement *parseBody(const FunctionLiteral &literal,
+                            std::string &error) {
+    return this->bodyParser(*this, literal, error);
+  }
+  // Every function literal whose body was deferred, in the order they were
+  // parsed, including the ones whose body has been parsed since.
+  const std::vector<FunctionLiteral *> &deferred() const {
+    return this->_deferred;
+  }
+  void defer(const std::vector<FunctionLiteral *> &literals) {
+    this->_deferred.insert(this->_deferred.end(), literals.begin(),
+                           literals.end());
+  }
+  // Bytes handed out so far, not counting block slack.
+  std::size_t size() const { return this->used; }
+
+  void *allocate(std::size_t size, std::size_t align) {
+    auto address = reinterpret_cast<std::uintptr_t>(this->cursor);
+    auto aligned = (address + align - 1) & ~(align - 1);
+    auto *start = this->cursor + (aligned - address);
+    if (this->cursor && start + size <= this->limit) {
+      this->cursor = start + size;
+      this->used += size;
+      return start;
+    }
+    return this->allocateBlock(size, align);
+  }
+
+  template <class T, class... Args>
+  T *make(Args &&...args) {
+    auto *object = new (this->allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      this->destructors.push_back(
+          {object, [](void *object) { static_cast<T *>(object)->~T(); }});
+    }
+    return object;
+  }
+
+  // Copies `values` into the arena.
+  template <class T>
+  Span<T> copy(const std::vector<T> &values) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Spans are never destroyed");
+    if (values.empty()) {
+      return Span<T>();
+    }
+    auto *data = static_cast<T *>(
+        this->allocate(sizeof(T) * values.size(), alignof(T)));
+    std::uninitialized_copy(values.begin(), values.end(), data);
+    return Span<T>(data, values.size());
+  }
+};
+}  // namespace AST
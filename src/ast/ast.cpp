@@ -16,13 +16,13 @@ std::string Expression::toDebugString() const {
 
 */
 
-const std::vector<std::shared_ptr<Statement>> &Program::getStatements() const {
+const std::vector<Statement *> &Program::getStatements() const {
   return this->statements;
 }
 
 const uint64_t Program::size() { return this->statements.size(); };
 
-void Program::addStatement(std::shared_ptr<Statement> statement) {
+void Program::addStatement(Statement *statement) {
   this->statements.push_back(statement);
 };
 
@@ -49,15 +49,21 @@ std::string Program::toDebugString() const {
 
 */
 
-const std::string Identifier::getValue() { return this->value; };
+const std::string &Identifier::getValue() const {
+  return this->symbol.name();
+};
+
+void Identifier::resolve(std::size_t depth, std::size_t slot) {
+  this->resolved = true;
+  this->depth = depth;
+  this->slot = slot;
+};
 
 std::string Identifier::toDebugString() const {
   std::stringstream ss;
   ss << "[identifier";
-  if (this->token) {
-    ss << " token=" << *this->token;
-  }
-  ss << " value=" << this->value << "]";
+  ss << " token=" << this->token;
+  ss << " value=" << this->getValue() << "]";
   return ss.str();
 };
 
@@ -66,37 +72,27 @@ const int64_t IntegerLiteral::getValue() { return this->value; };
 std::string IntegerLiteral::toDebugString() const {
   std::stringstream ss;
   ss << "[integer";
-  if (this->token) {
-    ss << " token=" << *this->token;
-  }
+  ss << " token=" << this->token;
   ss << " value=" << this->value << "]";
   return ss.str();
 };
 
-const std::string StringLiteral::getValue() { return this->value; };
+std::string_view StringLiteral::getValue() const { return this->value; };
 
 std::string StringLiteral::toDebugString() const {
   std::stringstream ss;
   ss << "[string";
-  if (this->token) {
-    ss << " token=" << *this->token;
-  }
+  ss << " token=" << this->token;
   ss << " value=" << this->value << "]";
   return ss.str();
 };
 
-const std::vector<std::shared_ptr<Expression>> &ArrayLiteral::getValues()
-    const {
-  return this->values;
-}
+Span<Expression *> ArrayLiteral::getValues() const { return this->values; }
 const uint64_t ArrayLiteral::size() { return this->values.size(); }
-void ArrayLiteral::addValue(std::shared_ptr<Expression> val) {
-  this->values.push_back(val);
-}
 
 std::string ArrayLiteral::toDebugString() const {
   std::stringstream ss;
-  ss << "[array token=" << *this->token << " values=[";
+  ss << "[array token=" << this->token << " values=[";
   for (const auto &val : values) {
     ss << val->toDebugString() << ", ";
   }
@@ -112,15 +108,7 @@ std::string Boolean::toDebugString() const {
   return ss.str();
 };
 
-const std::map<std::shared_ptr<Expression>, std::shared_ptr<Expression>>
-    &HashLiteral::getPairs() {
-  return this->pairs;
-};
-
-void HashLiteral::addPair(std::shared_ptr<Expression> key,
-                          std::shared_ptr<Expression> value) {
-  this->pairs[key] = value;
-}
+Span<HashLiteral::Pair> HashLiteral::getPairs() const { return this->pairs; };
 
 std::string HashLiteral::toDebugString() const {
   std::stringstream ss;
@@ -140,18 +128,14 @@ std::string HashLiteral::toDebugString() const {
 
 */
 
-const std::shared_ptr<Expression> PrefixExpression::getRight() {
-  return this->right;
-};
+Expression *PrefixExpression::getRight() const { return this->right; };
 
 const Operator PrefixExpression::getOp() { return this->op; };
 
 std::string PrefixExpression::toDebugString() const {
   std::stringstream ss;
   ss << "[prefix";
-  if (this->token) {
-    ss << " token=" << *this->token;
-  }
+  ss << " token=" << this->token;
   if (this->right) {
     ss << " right=" << this->right->toDebugString();
   }
@@ -159,20 +143,16 @@ std::string PrefixExpression::toDebugString() const {
   return ss.str();
 };
 
-const std::shared_ptr<Expression> InfixExpression::getLeft() {
-  return this->left;
-};
+Expression *InfixExpression::getLeft() const { return this->left; };
 
-const std::shared_ptr<Expression> InfixExpression::getRight() {
-  return this->right;
-};
+Expression *InfixExpression::getRight() const { return this->right; };
 
 const Operator InfixExpression::getOp() { return this->op; };
 
 std::string InfixExpression::toDebugString() const {
   std::stringstream ss;
   ss << "[infix"
-     << " token=" << *this->token << " left=" << this->left->toDebugString();
+     << " token=" << this->token << " left=" << this->left->toDebugString();
   if (this->right) {
     ss << " right=" << this->right->toDebugString();
   }
@@ -180,15 +160,11 @@ std::string InfixExpression::toDebugString() const {
   return ss.str();
 };
 
-const std::shared_ptr<Expression> IndexExpression::getLeft() {
-  return this->left;
-};
-const std::shared_ptr<Expression> IndexExpression::getIndex() {
-  return this->index;
-};
+Expression *IndexExpression::getLeft() const { return this->left; };
+Expression *IndexExpression::getIndex() const { return this->index; };
 std::string IndexExpression::toDebugString() const {
   std::stringstream ss;
-  ss << "[index token=" << *this->token
+  ss << "[index token=" << this->token
      << " left=" << this->left->toDebugString()
      << " index=" << this->index->toDebugString() << "]";
   return ss.str();
@@ -200,19 +176,15 @@ std::string IndexExpression::toDebugString() const {
 
 */
 
-std::shared_ptr<Expression> &IfExpression::getCondition() {
-  return this->condition;
-};
-std::shared_ptr<BlockStatement> &IfExpression::getWhenTrue() {
-  return this->whenTrue;
-};
-std::shared_ptr<BlockStatement> &IfExpression::getWhenFalse() {
+Expression *IfExpression::getCondition() const { return this->condition; };
+BlockStatement *IfExpression::getWhenTrue() const { return this->whenTrue; };
+BlockStatement *IfExpression::getWhenFalse() const {
   return this->whenFalse;
 };
 
 std::string IfExpression::toDebugString() const {
   std::stringstream ss;
-  ss << "[if token=" << *this->token
+  ss << "[if token=" << this->token
      << " condition=" << this->condition->toDebugString()
      << " whenTrue=" << this->whenTrue->toDebugString();
   if (this->whenFalse) {
@@ -222,60 +194,69 @@ std::string IfExpression::toDebugString() const {
   return ss.str();
 };
 
-std::shared_ptr<BlockStatement> &WhileExpression::getBody() {
-  return this->body;
-};
+BlockStatement *WhileExpression::getBody() const { return this->body; };
 
 std::string WhileExpression::toDebugString() const {
   std::stringstream ss;
-  ss << "[while token=" << *this->token
+  ss << "[while token=" << this->token
      << " body=" << this->body->toDebugString() << "]";
   return ss.str();
 };
 
-const std::vector<std::shared_ptr<Identifier>> &FunctionLiteral::getArguments()
-    const {
+std::shared_ptr<const Arena> FunctionLiteral::getArena() const {
+  return this->arena->shared_from_this();
+};
+
+Span<Identifier *> FunctionLiteral::getArguments() const {
   return this->arguments;
 };
 
 const uint64_t FunctionLiteral::size() { return this->arguments.size(); };
 
-void FunctionLiteral::addArgument(std::shared_ptr<Identifier> identifier) {
-  this->arguments.push_back(identifier);
+BlockStatement *FunctionLiteral::getBody() const {
+  if (this->deferred) {
+    this->deferred = false;
+    this->body = this->arena->parseBody(*this, this->bodyError);
+  }
+  return this->body;
+};
+
+const std::shared_ptr<const std::vector<Intern::Symbol>>
+    &FunctionLiteral::getLocals() const {
+  return this->locals;
 };
 
-std::shared_ptr<BlockStatement> &FunctionLiteral::getBody() {
-  return this->body;
+void FunctionLiteral::setLocals(
+    std::shared_ptr<const std::vector<Intern::Symbol>> locals) {
+  this->locals = locals;
 };
 
 std::string FunctionLiteral::toDebugString() const {
   std::stringstream ss;
-  ss << "[function token=" << *this->token << " arguments=[";
+  ss << "[function token=" << this->token << " arguments=[";
   for (const auto &ident : arguments) {
     ss << ident->toDebugString() << ", ";
   }
-  ss << "] body=" << this->body->toDebugString();
+  ss << "] body=";
+  if (this->isDeferred()) {
+    ss << "[deferred]";
+  } else if (this->body) {
+    ss << this->body->toDebugString();
+  }
   return ss.str();
 };
 
-const std::vector<std::shared_ptr<Expression>> &CallExpression::getArguments()
-    const {
+Span<Expression *> CallExpression::getArguments() const {
   return this->arguments;
 };
 
 const uint64_t CallExpression::size() { return this->arguments.size(); };
 
-void CallExpression::addArgument(std::shared_ptr<Expression> expr) {
-  this->arguments.push_back(expr);
-};
-
-std::shared_ptr<Expression> CallExpression::getFunction() {
-  return this->func;
-};
+Expression *CallExpression::getFunction() const { return this->func; };
 
 std::string CallExpression::toDebugString() const {
   std::stringstream ss;
-  ss << "[call token=" << *this->token
+  ss << "[call token=" << this->token
      << " func=" << this->func->toDebugString() << " arguments=[";
   for (const auto &arg : arguments) {
     ss << arg->toDebugString() << ", ";
@@ -290,13 +271,13 @@ std::string CallExpression::toDebugString() const {
 
 */
 
-std::shared_ptr<Expression> ReturnStatement::getReturnValue() const {
+Expression *ReturnStatement::getReturnValue() const {
   return this->returnValue;
 }
 
 std::string ReturnStatement::toDebugString() const {
   std::stringstream ss;
-  ss << "[return token=" << *this->token;
+  ss << "[return token=" << this->token;
   if (this->returnValue) {
     ss << " returnValue=" << this->returnValue->toDebugString();
   }
@@ -304,13 +285,13 @@ std::string ReturnStatement::toDebugString() const {
   return ss.str();
 };
 
-std::shared_ptr<Expression> ExpressionStatement::getExpression() const {
+Expression *ExpressionStatement::getExpression() const {
   return this->expression;
 };
 
 std::string ExpressionStatement::toDebugString() const {
   std::stringstream ss;
-  ss << "[expression token=" << *this->token;
+  ss << "[expression token=" << this->token;
   if (this->expression) {
     ss << " expression=" << this->expression->toDebugString();
   }
@@ -318,20 +299,14 @@ std::string ExpressionStatement::toDebugString() const {
   return ss.str();
 };
 
-const std::shared_ptr<Identifier> LetStatement::getName() {
-  return this->name;
-};
+Identifier *LetStatement::getName() const { return this->name; };
 
-const std::shared_ptr<Expression> LetStatement::getValue() {
-  return this->value;
-};
+Expression *LetStatement::getValue() const { return this->value; };
 
 std::string LetStatement::toDebugString() const {
   std::stringstream ss;
   ss << "[letstatement";
-  if (this->token) {
-    ss << " token=" << *this->token;
-  }
+  ss << " token=" << this->token;
   if (this->name) {
     ss << " name=" << this->name->toDebugString();
   }
@@ -342,17 +317,12 @@ std::string LetStatement::toDebugString() const {
   return ss.str();
 };
 
-const std::vector<std::shared_ptr<Statement>> &BlockStatement::getStatements()
-    const {
+Span<Statement *> BlockStatement::getStatements() const {
   return this->statements;
 };
 
 const uint64_t BlockStatement::size() { return this->statements.size(); };
 
-void BlockStatement::addStatement(std::shared_ptr<Statement> statement) {
-  this->statements.push_back(statement);
-};
-
 std::string BlockStatement::toDebugString() const {
   std::stringstream ss;
   ss << "[block statements=[";
@@ -1,13 +1,18 @@
 #pragma once
 #include <spdlog/spdlog.h>
+#include <arena.hpp>
 #include <list>
 #include <map>
 #include <sstream>
 #include <string>
 #include <token.hpp>
 
+namespace Eval {
+class Value;
+}
+
 namespace AST {
-typedef std::string Operator;
+typedef std::string_view Operator;
 
 class Node;
 class Statement;
@@ -78,12 +83,12 @@ class Node {
 
 class Statement : public Node {
  protected:
-  std::shared_ptr<Token> token;
+  Token token;
 
  public:
-  const std::shared_ptr<Token> getToken() const { return this->token; };
+  const Token &getToken() const { return this->token; };
   virtual std::string tokenLiteral() const override {
-    return this->token->literal;
+    return std::string(this->token.literal);
   }
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
@@ -93,12 +98,19 @@ class Statement : public Node {
 
 class Expression : public Node {
  protected:
-  std::shared_ptr<Token> token;
+  Token token;
+
+ private:
+  // Set by ConstantFolder when the expression always evaluates to the same
+  // value. It lives in the program's arena.
+  const Eval::Value *constant = nullptr;
 
  public:
-  const std::shared_ptr<Token> getToken() const { return this->token; };
+  const Token &getToken() const { return this->token; };
+  const Eval::Value *getConstant() const { return this->constant; }
+  void setConstant(const Eval::Value *constant) { this->constant = constant; }
   virtual std::string tokenLiteral() const override {
-    return this->token->literal;
+    return std::string(this->token.literal);
   }
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
@@ -113,12 +125,17 @@ class Expression : public Node {
 */
 class Program : public Node {
  private:
-  std::vector<std::shared_ptr<Statement>> statements;
+  std::vector<Statement *> statements;
+  // Holds the program's nodes and the source their tokens point into.
+  std::shared_ptr<Arena> arena;
 
  public:
-  const std::vector<std::shared_ptr<Statement>> &getStatements() const;
+  explicit Program(std::shared_ptr<Arena> arena = std::make_shared<Arena>())
+      : arena(std::move(arena)) {}
+  const std::vector<Statement *> &getStatements() const;
   const uint64_t size();
-  void addStatement(std::shared_ptr<Statement> statement);
+  void addStatement(Statement *statement);
+  Arena &getArena() const { return *this->arena; }
   virtual std::string tokenLiteral() const override;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
@@ -134,15 +151,25 @@ class Program : public Node {
 
 class Identifier : public Expression {
  private:
-  std::string value;
+  Intern::Symbol symbol;
+  bool resolved = false;
+  std::size_t depth = 0;
+  std::size_t slot = 0;
 
  public:
-  Identifier(std::shared_ptr<Token> token, const std::string &value)
-      : value(value) {
+  Identifier(const Token &token, Intern::Symbol symbol) : symbol(symbol) {
     this->token = token;
   }
 
-  const std::string getValue();
+  const std::string &getValue() const;
+  Intern::Symbol getSymbol() const { return this->symbol; }
+  // Lexical address filled in by the resolver: the number of function scopes
+  // to walk out and the slot within that scope. Unresolved identifiers are
+  // globals or builtins and are looked up by name.
+  void resolve(std::size_t depth, std::size_t slot);
+  bool isResolved() const { return this->resolved; }
+  std::size_t getDepth() const { return this->depth; }
+  std::size_t getSlot() const { return this->slot; }
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -154,7 +181,7 @@ class IntegerLiteral : public Expression {
   int64_t value;
 
  public:
-  IntegerLiteral(std::shared_ptr<Token> token, int64_t value) : value(value) {
+  IntegerLiteral(const Token &token, int64_t value) : value(value) {
     this->token = token;
   }
 
@@ -165,17 +192,17 @@ class IntegerLiteral : public Expression {
   }
 };
 
+// The value is a view of the Source, which the Arena keeps alive.
 class StringLiteral : public Expression {
  private:
-  std::string value;
+  std::string_view value;
 
  public:
-  StringLiteral(std::shared_ptr<Token> token, const std::string &value)
-      : value(value) {
+  StringLiteral(const Token &token, std::string_view value) : value(value) {
     this->token = token;
   }
 
-  const std::string getValue();
+  std::string_view getValue() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -184,13 +211,15 @@ class StringLiteral : public Expression {
 
 class ArrayLiteral : public Expression {
  private:
-  std::vector<std::shared_ptr<Expression>> values;
+  Span<Expression *> values;
 
  public:
-  ArrayLiteral(std::shared_ptr<Token> token) { this->token = token; }
-  const std::vector<std::shared_ptr<Expression>> &getValues() const;
+  ArrayLiteral(const Token &token, Span<Expression *> values)
+      : values(values) {
+    this->token = token;
+  }
+  Span<Expression *> getValues() const;
   const uint64_t size();
-  void addValue(std::shared_ptr<Expression> val);
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -202,7 +231,7 @@ class Boolean : public Expression {
   bool value;
 
  public:
-  Boolean(std::shared_ptr<Token> token, bool value) : value(value) {
+  Boolean(const Token &token, bool value) : value(value) {
     this->token = token;
   };
   const bool getValue();
@@ -213,15 +242,18 @@ class Boolean : public Expression {
 };
 
 class HashLiteral : public Expression {
+ public:
+  typedef std::pair<Expression *, Expression *> Pair;
+
  private:
-  std::map<std::shared_ptr<Expression>, std::shared_ptr<Expression>> pairs;
+  // In source order, which decides the value kept for a repeated key.
+  Span<Pair> pairs;
 
  public:
-  HashLiteral(std::shared_ptr<Token> token) { this->token = token; };
-  const std::map<std::shared_ptr<Expression>, std::shared_ptr<Expression>>
-      &getPairs();
-  void addPair(std::shared_ptr<Expression> key,
-               std::shared_ptr<Expression> value);
+  HashLiteral(const Token &token, Span<Pair> pairs) : pairs(pairs) {
+    this->token = token;
+  };
+  Span<Pair> getPairs() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -235,17 +267,16 @@ class HashLiteral : public Expression {
 */
 class PrefixExpression : public Expression {
  private:
-  std::shared_ptr<Expression> right;
+  Expression *right;
   Operator op;
 
  public:
-  PrefixExpression(std::shared_ptr<Token> token,
-                   std::shared_ptr<Expression> right, const Operator &op)
+  PrefixExpression(const Token &token, Expression *right, Operator op)
       : right(right), op(op) {
     this->token = token;
   }
 
-  const std::shared_ptr<Expression> getRight();
+  Expression *getRight() const;
   const Operator getOp();
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
@@ -255,20 +286,19 @@ class PrefixExpression : public Expression {
 
 class InfixExpression : public Expression {
  private:
-  std::shared_ptr<Expression> left;
-  std::shared_ptr<Expression> right;
+  Expression *left;
+  Expression *right;
   Operator op;
 
  public:
-  InfixExpression(std::shared_ptr<Token> token,
-                  std::shared_ptr<Expression> left,
-                  std::shared_ptr<Expression> right, const Operator &op)
+  InfixExpression(const Token &token, Expression *left, Expression *right,
+                  Operator op)
       : left(left), right(right), op(op) {
     this->token = token;
   }
 
-  const std::shared_ptr<Expression> getLeft();
-  const std::shared_ptr<Expression> getRight();
+  Expression *getLeft() const;
+  Expression *getRight() const;
   const Operator getOp();
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
@@ -278,19 +308,17 @@ class InfixExpression : public Expression {
 
 class IndexExpression : public Expression {
  private:
-  std::shared_ptr<Expression> left;
-  std::shared_ptr<Expression> index;
+  Expression *left;
+  Expression *index;
 
  public:
-  IndexExpression(std::shared_ptr<Token> token,
-                  std::shared_ptr<Expression> left,
-                  std::shared_ptr<Expression> index)
+  IndexExpression(const Token &token, Expression *left, Expression *index)
       : left(left), index(index) {
     this->token = token;
   }
 
-  const std::shared_ptr<Expression> getLeft();
-  const std::shared_ptr<Expression> getIndex();
+  Expression *getLeft() const;
+  Expression *getIndex() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -303,21 +331,19 @@ class IndexExpression : public Expression {
 
 */
 class IfExpression : public Expression {
-  std::shared_ptr<Expression> condition;
-  std::shared_ptr<BlockStatement> whenTrue;
-  std::shared_ptr<BlockStatement> whenFalse;
+  Expression *condition;
+  BlockStatement *whenTrue;
+  BlockStatement *whenFalse;
 
  public:
-  IfExpression(std::shared_ptr<Token> token,
-               std::shared_ptr<Expression> condition,
-               std::shared_ptr<BlockStatement> whenTrue,
-               std::shared_ptr<BlockStatement> whenFalse)
+  IfExpression(const Token &token, Expression *condition,
+               BlockStatement *whenTrue, BlockStatement *whenFalse)
       : condition(condition), whenTrue(whenTrue), whenFalse(whenFalse) {
     this->token = token;
   };
-  std::shared_ptr<Expression> &getCondition();
-  std::shared_ptr<BlockStatement> &getWhenTrue();
-  std::shared_ptr<BlockStatement> &getWhenFalse();
+  Expression *getCondition() const;
+  BlockStatement *getWhenTrue() const;
+  BlockStatement *getWhenFalse() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -325,35 +351,83 @@ class IfExpression : public Expression {
 };
 
 class WhileExpression : public Expression {
-  std::shared_ptr<BlockStatement> body;
+  BlockStatement *body;
 
  public:
-  WhileExpression(std::shared_ptr<Token> token,
-                  std::shared_ptr<BlockStatement> body)
-      : body(body) {
+  WhileExpression(const Token &token, BlockStatement *body) : body(body) {
     this->token = token;
   };
-  std::shared_ptr<BlockStatement> &getBody();
+  BlockStatement *getBody() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
   }
 };
 
+// The slot names of each function scope around a function literal,
+// outermost first.
+typedef std::vector<std::vector<Intern::Symbol>> Scopes;
+
 class FunctionLiteral : public Expression {
-  std::vector<std::shared_ptr<Identifier>> arguments;
-  std::shared_ptr<BlockStatement> body;
+  Arena *arena;
+  Span<Identifier *> arguments;
+  // A deferred body is parsed the first time it's asked for.
+  mutable BlockStatement *body;
+  mutable bool deferred = false;
+  mutable std::string bodyError;
+  // Where a deferred body is for the arena's body parser: its bytes in the
+  // source from its { to just past its }, or for a program read from a
+  // cache, the run of nodes in the cache file that ends with its block.
+  std::size_t bodyBegin = 0;
+  std::size_t bodyEnd = 0;
+  std::shared_ptr<const std::vector<Intern::Symbol>> locals;
+  std::shared_ptr<const Scopes> enclosingScopes;
 
  public:
-  FunctionLiteral(std::shared_ptr<Token> token,
-                  std::shared_ptr<BlockStatement> body)
-      : body(body) {
+  FunctionLiteral(const Token &token, Arena *arena,
+                  Span<Identifier *> arguments, BlockStatement *body)
+      : arena(arena), arguments(arguments), body(body) {
     this->token = token;
   };
-  const std::vector<std::shared_ptr<Identifier>> &getArguments() const;
+  // A literal whose body the parser only brace-matched.
+  FunctionLiteral(const Token &token, Arena *arena,
+                  Span<Identifier *> arguments, std::size_t bodyBegin,
+                  std::size_t bodyEnd)
+      : arena(arena),
+        arguments(arguments),
+        body(nullptr),
+        deferred(true),
+        bodyBegin(bodyBegin),
+        bodyEnd(bodyEnd) {
+    this->token = token;
+  };
+  // The arena this literal was parsed into, for function values to keep
+  // alive along with their body.
+  std::shared_ptr<const Arena> getArena() const;
+  // The same arena, for passes over a deferred body to allocate from once
+  // it's parsed.
+  Arena &getBodyArena() const { return *this->arena; }
+  Span<Identifier *> getArguments() const;
   const uint64_t size();
-  void addArgument(std::shared_ptr<Identifier> identifier);
-  std::shared_ptr<BlockStatement> &getBody();
+  // Parses a deferred body first. nullptr if it has syntax errors.
+  BlockStatement *getBody() const;
+  bool isDeferred() const { return this->deferred; }
+  std::size_t getBodyBegin() const { return this->bodyBegin; }
+  std::size_t getBodyEnd() const { return this->bodyEnd; }
+  // The first syntax error in a deferred body, once it's been parsed.
+  const std::string &getBodyError() const { return this->bodyError; }
+  // Names of the resolver's slots for this function: the arguments followed by
+  // every name bound with `let` in the body.
+  const std::shared_ptr<const std::vector<Intern::Symbol>> &getLocals() const;
+  void setLocals(std::shared_ptr<const std::vector<Intern::Symbol>> locals);
+  // The scopes the resolver found a deferred literal in, kept until its body
+  // is resolved.
+  const std::shared_ptr<const Scopes> &getEnclosingScopes() const {
+    return this->enclosingScopes;
+  }
+  void setEnclosingScopes(std::shared_ptr<const Scopes> scopes) {
+    this->enclosingScopes = std::move(scopes);
+  }
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -361,18 +435,18 @@ class FunctionLiteral : public Expression {
 };
 
 class CallExpression : public Expression {
-  std::shared_ptr<Expression> func;
-  std::vector<std::shared_ptr<Expression>> arguments;
+  Expression *func;
+  Span<Expression *> arguments;
 
  public:
-  CallExpression(std::shared_ptr<Token> token, std::shared_ptr<Expression> func)
-      : func(func) {
+  CallExpression(const Token &token, Expression *func,
+                 Span<Expression *> arguments)
+      : func(func), arguments(arguments) {
     this->token = token;
   };
-  const std::vector<std::shared_ptr<Expression>> &getArguments() const;
+  Span<Expression *> getArguments() const;
   const uint64_t size();
-  void addArgument(std::shared_ptr<Expression> expr);
-  std::shared_ptr<Expression> getFunction();
+  Expression *getFunction() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -386,15 +460,14 @@ class CallExpression : public Expression {
 */
 class ReturnStatement : public Statement {
  private:
-  std::shared_ptr<Expression> returnValue;
+  Expression *returnValue;
 
  public:
-  ReturnStatement(std::shared_ptr<Token> token,
-                  std::shared_ptr<Expression> returnValue)
+  ReturnStatement(const Token &token, Expression *returnValue)
       : returnValue(returnValue) {
     this->token = token;
   };
-  std::shared_ptr<Expression> getReturnValue() const;
+  Expression *getReturnValue() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -403,16 +476,15 @@ class ReturnStatement : public Statement {
 
 class ExpressionStatement : public Statement {
  private:
-  std::shared_ptr<Expression> expression;
+  Expression *expression;
 
  public:
-  ExpressionStatement(std::shared_ptr<Token> token,
-                      std::shared_ptr<Expression> expression)
+  ExpressionStatement(const Token &token, Expression *expression)
       : expression(expression) {
     this->token = token;
   };
 
-  std::shared_ptr<Expression> getExpression() const;
+  Expression *getExpression() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -421,18 +493,17 @@ class ExpressionStatement : public Statement {
 
 class LetStatement : public Statement {
  private:
-  std::shared_ptr<Identifier> name;
-  std::shared_ptr<Expression> value;
+  Identifier *name;
+  Expression *value;
 
  public:
-  LetStatement(std::shared_ptr<Token> token, std::shared_ptr<Identifier> name,
-               std::shared_ptr<Expression> value)
+  LetStatement(const Token &token, Identifier *name, Expression *value)
       : name(name), value(value) {
     this->token = token;
   };
 
-  const std::shared_ptr<Identifier> getName();
-  const std::shared_ptr<Expression> getValue();
+  Identifier *getName() const;
+  Expression *getValue() const;
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -441,15 +512,15 @@ class LetStatement : public Statement {
 
 class BlockStatement : public Statement {
  private:
-  std::vector<std::shared_ptr<Statement>> statements;
+  Span<Statement *> statements;
 
  public:
-  explicit BlockStatement(std::shared_ptr<Token> token) {
+  BlockStatement(const Token &token, Span<Statement *> statements)
+      : statements(statements) {
     this->token = token;
   };
-  const std::vector<std::shared_ptr<Statement>> &getStatements() const;
+  Span<Statement *> getStatements() const;
   const uint64_t size();
-  void addStatement(std::shared_ptr<Statement> statement);
   virtual std::string toDebugString() const override;
   void visit(AbstractDispatcher &dispatcher) override {
     dispatcher.dispatch(*this);
@@ -0,0 +1,370 @@
+#include "flat.hpp"
+
+using namespace Flat;
+
+/*
+
+  Conversion
+
+*/
+namespace Flat {
+// Appends each node after its children, leaving the new node's index in
+// `last`.
+class Builder : public AST::AbstractDispatcher {
+ private:
+  Tree &tree;
+  std::uint32_t last = NONE;
+
+  Slice slice(std::string_view text) const {
+    if (!this->tree.source) {
+      return Slice();
+    }
+    auto source = this->tree.source->text();
+    if (text.empty() || text.data() < source.data() ||
+        text.data() + text.size() > source.data() + source.size()) {
+      return Slice();
+    }
+    return {static_cast<std::uint32_t>(text.data() - source.data()),
+            static_cast<std::uint32_t>(text.size())};
+  }
+
+  std::uint32_t add(Kind kind, const Token &token, std::uint32_t a = NONE,
+                    std::uint32_t b = NONE, std::uint32_t c = NONE) {
+    this->tree._nodes.push_back({kind, token.type, a, b, c});
+    this->tree._tokens.push_back(this->slice(token.literal));
+    this->last = static_cast<std::uint32_t>(this->tree._nodes.size() - 1);
+    return this->last;
+  }
+
+  std::uint32_t build(AST::Node *node) {
+    if (!node) {
+      return NONE;
+    }
+    node->visit(*this);
+    return this->last;
+  }
+
+  // Builds every node first, since their own lists go into the same array,
+  // and returns where their indices start in it.
+  template <class Nodes>
+  std::uint32_t buildList(const Nodes &nodes) {
+    std::vector<std::uint32_t> children;
+    children.reserve(nodes.size());
+    for (auto *node : nodes) {
+      children.push_back(this->build(node));
+    }
+    auto first = static_cast<std::uint32_t>(this->tree._lists.size());
+    this->tree._lists.insert(this->tree._lists.end(), children.begin(),
+                             children.end());
+    return first;
+  }
+
+ public:
+  explicit Builder(Tree &tree) : tree(tree) {}
+
+  void dispatch(AST::Node &) override {}
+  void dispatch(AST::Statement &) override {}
+  void dispatch(AST::Expression &) override {}
+
+  void dispatch(AST::Program &node) override {
+    const auto &statements = node.getStatements();
+    auto first = this->buildList(statements);
+    this->add(Kind::PROGRAM, Token(), first,
+              static_cast<std::uint32_t>(statements.size()));
+  }
+
+  void dispatch(AST::Identifier &node) override {
+    auto index = static_cast<std::uint32_t>(this->tree._identifiers.size());
+    this->tree._identifiers.push_back(
+        {node.getSymbol(), node.isResolved(),
+         static_cast<std::uint32_t>(node.getDepth()),
+         static_cast<std::uint32_t>(node.getSlot())});
+    this->add(Kind::IDENTIFIER, node.getToken(), index);
+  }
+  void dispatch(AST::IntegerLiteral &node) override {
+    auto index = static_cast<std::uint32_t>(this->tree._integers.size());
+    this->tree._integers.push_back(node.getValue());
+    this->add(Kind::INTEGER, node.getToken(), index);
+  }
+  void dispatch(AST::StringLiteral &node) override {
+    auto index = static_cast<std::uint32_t>(this->tree._strings.size());
+    this->tree._strings.push_back(this->slice(node.getValue()));
+    this->add(Kind::STRING, node.getToken(), index);
+  }
+  void dispatch(AST::Boolean &node) override {
+    this->add(Kind::BOOLEAN, node.getToken(), node.getValue() ? 1u : 0u);
+  }
+  void dispatch(AST::ArrayLiteral &node) override {
+    auto values = node.getValues();
+    auto first = this->buildList(values);
+    this->add(Kind::ARRAY, node.getToken(), first,
+              static_cast<std::uint32_t>(values.size()));
+  }
+  void dispatch(AST::HashLiteral &node) override {
+    auto pairs = node.getPairs();
+    std::vector<AST::Expression *> flattened;
+    flattened.reserve(pairs.size() * 2);
+    for (const auto &pair : pairs) {
+      flattened.push_back(pair.first);
+      flattened.push_back(pair.second);
+    }
+    auto first = this->buildList(flattened);
+    this->add(Kind::HASH, node.getToken(), first,
+              static_cast<std::uint32_t>(pairs.size()));
+  }
+
+  void dispatch(AST::IndexExpression &node) override {
+    auto left = this->build(node.getLeft());
+    auto index = this->build(node.getIndex());
+    this->add(Kind::INDEX, node.getToken(), left, index);
+  }
+  void dispatch(AST::PrefixExpression &node) override {
+    auto right = this->build(node.getRight());
+    this->add(Kind::PREFIX, node.getToken(), right);
+  }
+  void dispatch(AST::InfixExpression &node) override {
+    auto left = this->build(node.getLeft());
+    auto right = this->build(node.getRight());
+    this->add(Kind::INFIX, node.getToken(), left, right);
+  }
+  void dispatch(AST::IfExpression &node) override {
+    auto condition = this->build(node.getCondition());
+    auto whenTrue = this->build(node.getWhenTrue());
+    auto whenFalse = this->build(node.getWhenFalse());
+    this->add(Kind::IF, node.getToken(), condition, whenTrue, whenFalse);
+  }
+  void dispatch(AST::WhileExpression &node) override {
+    auto body = this->build(node.getBody());
+    this->add(Kind::WHILE, node.getToken(), body);
+  }
+  void dispatch(AST::FunctionLiteral &node) override {
+    auto arguments = node.getArguments();
+    auto first = this->buildList(arguments);
+    auto body = this->build(node.getBody());
+    this->add(Kind::FUNCTION, node.getToken(), first,
+              static_cast<std::uint32_t>(arguments.size()), body);
+  }
+  void dispatch(AST::CallExpression &node) override {
+    auto function = this->build(node.getFunction());
+    auto arguments = node.getArguments();
+    auto first = this->buildList(arguments);
+    this->add(Kind::CALL, node.getToken(), function, first,
+              static_cast<std::uint32_t>(arguments.size()));
+  }
+
+  void dispatch(AST::ReturnStatement &node) override {
+    auto value = this->build(node.getReturnValue());
+    this->add(Kind::RETURN, node.getToken(), value);
+  }
+  void dispatch(AST::ExpressionStatement &node) override {
+    auto expression = this->build(node.getExpression());
+    this->add(Kind::EXPRESSION, node.getToken(), expression);
+  }
+  void dispatch(AST::LetStatement &node) override {
+    auto name = this->build(node.getName());
+    auto value = this->build(node.getValue());
+    this->add(Kind::LET, node.getToken(), name, value);
+  }
+  void dispatch(AST::BlockStatement &node) override {
+    auto statements = node.getStatements();
+    auto first = this->buildList(statements);
+    this->add(Kind::BLOCK, node.getToken(), first,
+              static_cast<std::uint32_t>(statements.size()));
+  }
+};
+}  // namespace Flat
+
+Tree Tree::fromProgram(AST::Program &program) {
+  Tree tree;
+  tree.source = program.getArena().getSource();
+  Builder builder(tree);
+  program.visit(builder);
+  tree._nodes.shrink_to_fit();
+  tree._tokens.shrink_to_fit();
+  tree._lists.shrink_to_fit();
+  return tree;
+}
+
+/*
+
+  Printing
+
+*/
+static std::string_view operatorText(TokenType type) {
+  switch (type) {
+    case TokenType::PLUS:
+      return "+";
+    case TokenType::MINUS:
+      return "-";
+    case TokenType::BANG:
+      return "!";
+    case TokenType::ASTERISK:
+      return "*";
+    case TokenType::SLASH:
+      return "/";
+    case TokenType::LT:
+      return "<";
+    case TokenType::GT:
+      return ">";
+    case TokenType::EQ:
+      return "==";
+    case TokenType::NE:
+      return "!=";
+    default:
+      return "?";
+  }
+}
+
+namespace {
+class Printer {
+ private:
+  const Tree &tree;
+  std::string out;
+  std::size_t indent = 0;
+
+  void list(std::uint32_t first, std::uint32_t count) {
+    for (auto at = first; at < first + count; at++) {
+      if (at != first) {
+        this->out += ", ";
+      }
+      this->print(this->tree.list(at));
+    }
+  }
+
+ public:
+  explicit Printer(const Tree &tree) : tree(tree) {}
+
+  std::string result() { return std::move(this->out); }
+
+  void print(std::uint32_t index) {
+    const auto &node = this->tree[index];
+    switch (node.kind) {
+      case Kind::PROGRAM:
+        for (auto at = node.a; at < node.a + node.b; at++) {
+          this->print(this->tree.list(at));
+        }
+        break;
+      case Kind::IDENTIFIER:
+        this->out += this->tree.identifier(node).symbol.name();
+        break;
+      case Kind::INTEGER:
+        this->out += std::to_string(this->tree.integer(node));
+        break;
+      case Kind::STRING:
+        this->out += "\"";
+        this->out += this->tree.string(node);
+        this->out += "\"";
+        break;
+      case Kind::BOOLEAN:
+        this->out += node.a ? "true" : "false";
+        break;
+      case Kind::ARRAY:
+        this->out += "[";
+        this->list(node.a, node.b);
+        this->out += "]";
+        break;
+      case Kind::HASH:
+        this->out += "{";
+        for (std::uint32_t pair = 0; pair < node.b; pair++) {
+          if (pair) {
+            this->out += ", ";
+          }
+          this->print(this->tree.list(node.a + pair * 2));
+          this->out += ":";
+          this->print(this->tree.list(node.a + pair * 2 + 1));
+        }
+        this->out += "}";
+        break;
+      case Kind::PREFIX:
+        this->out += "(";
+        this->out += operatorText(node.type);
+        this->print(node.a);
+        this->out += ")";
+        break;
+      case Kind::INFIX:
+        this->out += "(";
+        this->print(node.a);
+        this->out += " ";
+        this->out += operatorText(node.type);
+        this->out += " ";
+        if (node.b != NONE) {
+          this->print(node.b);
+        }
+        this->out += ")";
+        break;
+      case Kind::INDEX:
+        this->out += "(";
+        this->print(node.a);
+        this->out += "[";
+        this->print(node.b);
+        this->out += "])";
+        break;
+      case Kind::IF:
+        this->out += "if ";
+        this->print(node.a);
+        this->out += " ";
+        this->print(node.b);
+        if (node.c != NONE) {
+          this->out += " else ";
+          this->print(node.c);
+        }
+        break;
+      case Kind::WHILE:
+        this->out += "while ";
+        this->print(node.a);
+        break;
+      case Kind::FUNCTION:
+        this->out += "fn(";
+        this->list(node.a, node.b);
+        this->out += ") ";
+        if (node.c != NONE) {
+          this->print(node.c);
+        } else {
+          this->out += "{ }";
+        }
+        break;
+      case Kind::CALL:
+        this->print(node.a);
+        this->out += "(";
+        this->list(node.b, node.c);
+        this->out += ")";
+        break;
+      case Kind::RETURN:
+        this->out += "return";
+        if (node.a != NONE) {
+          this->out += " ";
+          this->print(node.a);
+        }
+        break;
+      case Kind::EXPRESSION:
+        this->print(node.a);
+        break;
+      case Kind::LET:
+        this->out += "let ";
+        this->print(node.a);
+        this->out += " = ";
+        this->print(node.b);
+        break;
+      case Kind::BLOCK:
+        this->out += "{ ";
+        this->indent++;
+        for (auto at = node.a; at < node.a + node.b; at++) {
+          this->out += "\n" + std::string(this->indent * 2, ' ');
+          this->print(this->tree.list(at));
+          if (at + 1 != node.a + node.b) {
+            this->out += ";";
+          }
+        }
+        this->indent--;
+        this->out += "\n" + std::string(this->indent * 2, ' ') + "}";
+        break;
+    }
+  }
+};
+}  // namespace
+
+std::string Tree::toString() const {
+  Printer printer(*this);
+  printer.print(this->root());
+  return printer.result();
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+
+namespace Flat {
+/*
+
+  Flat AST
+
+  A read-only copy of a Program laid out for passes that walk the whole
+  tree. Every node is 16 bytes in one contiguous array and names its children
+  by 32-bit index; tokens, literals, identifiers and child lists live in side
+  arrays. Text is kept as offsets into the source rather than pointers, so
+  every array is plain data that can be written out and mapped back in.
+  Nodes are stored in post-order, so a child always comes before its parent
+  and the program is the last node. A pass that only needs its children's
+  results can therefore be a single forward loop over nodes(), and any other
+  pass recurses with forEachChild, which switches on the kind instead of
+  going through virtual visit calls.
+
+  What a, b and c hold for each kind, with NONE for a missing child:
+
+    PROGRAM, BLOCK, ARRAY   a: first entry in lists, b: count
+    HASH                    a: first entry in lists, b: pair count; keys and
+                            values alternate
+    IDENTIFIER              a: index into identifiers
+    INTEGER                 a: index into integers
+    STRING                  a: index into strings
+    BOOLEAN                 a: 0 or 1
+    PREFIX                  a: operand
+    INFIX, INDEX            a: left, b: right or index
+    IF                      a: condition, b: consequence, c: alternative
+    WHILE                   a: body
+    FUNCTION                a: first parameter in lists, b: count, c: body;
+                            a deferred body is parsed first
+    CALL                    a: callee, b: first argument in lists, c: count
+    RETURN, EXPRESSION      a: value
+    LET                     a: name, b: value
+
+*/
+enum class Kind : std::uint8_t {
+  PROGRAM,
+  IDENTIFIER,
+  INTEGER,
+  STRING,
+  BOOLEAN,
+  ARRAY,
+  HASH,
+  PREFIX,
+  INFIX,
+  INDEX,
+  IF,
+  WHILE,
+  FUNCTION,
+  CALL,
+  RETURN,
+  EXPRESSION,
+  LET,
+  BLOCK,
+};
+
+inline constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+struct Node {
+  Kind kind;
+  // The type of the node's token, which is the operator for PREFIX and INFIX
+  // nodes.
+  TokenType type = TokenType::ILLEGAL;
+  std::uint32_t a = NONE;
+  std::uint32_t b = NONE;
+  std::uint32_t c = NONE;
+};
+
+static_assert(sizeof(Node) == 16, "Flat nodes should stay 16 bytes");
+
+// A run of source text. Tokens whose literal isn't in the source, like the
+// end of the input, are empty.
+struct Slice {
+  std::uint32_t offset = 0;
+  std::uint32_t size = 0;
+};
+
+// An identifier and the lexical address the resolver gave it, if any.
+struct Identifier {
+  Intern::Symbol symbol;
+  bool resolved;
+  std::uint32_t depth;
+  std::uint32_t slot;
+};
+
+class Tree {
+ private:
+  std::vector<Node> _nodes;
+  // Each node's token, by node index.
+  std::vector<Slice> _tokens;
+  std::vector<std::uint32_t> _lists;
+  std::vector<std::int64_t> _integers;
+  std::vector<Slice> _strings;
+  std::vector<Identifier> _identifiers;
+  Source source;
+
+  friend class Builder;
+
+ public:
+  // Copies `program`, including any resolution already done on it.
+  static Tree fromProgram(AST::Program &program);
+
+  const std::vector<Node> &nodes() const { return this->_nodes; }
+  const std::vector<Slice> &tokens() const { return this->_tokens; }
+  const std::vector<std::uint32_t> &lists() const { return this->_lists; }
+  const std::vector<std::int64_t> &integers() const { return this->_integers; }
+  const std::vector<Slice> &strings() const { return this->_strings; }
+  const std::vector<Identifier> &identifiers() const {
+    return this->_identifiers;
+  }
+  const Source &getSource() const { return this->source; }
+  const Node &operator[](std::uint32_t index) const {
+    return this->_nodes[index];
+  }
+  std::uint32_t root() const {
+    return static_cast<std::uint32_t>(this->_nodes.size() - 1);
+  }
+  std::uint32_t list(std::uint32_t at) const { return this->_lists[at]; }
+  std::int64_t integer(const Node &node) const {
+    return this->_integers[node.a];
+  }
+  std::string_view string(const Node &node) const {
+    auto slice = this->_strings[node.a];
+    return this->source->text().substr(slice.offset, slice.size);
+  }
+  const Identifier &identifier(const Node &node) const {
+    return this->_identifiers[node.a];
+  }
+
+  // Calls fn with the index of each child of `index` in source order.
+  template <class Fn>
+  void forEachChild(std::uint32_t index, Fn &&fn) const {
+    const auto &node = this->_nodes[index];
+    auto each = [&](std::uint32_t first, std::uint32_t count) {
+      for (auto at = first; at < first + count; at++) {
+        fn(this->_lists[at]);
+      }
+    };
+    auto one = [&](std::uint32_t child) {
+      if (child != NONE) {
+        fn(child);
+      }
+    };
+    switch (node.kind) {
+      case Kind::PROGRAM:
+      case Kind::BLOCK:
+      case Kind::ARRAY:
+        each(node.a, node.b);
+        break;
+      case Kind::HASH:
+        each(node.a, node.b * 2);
+        break;
+      case Kind::IDENTIFIER:
+      case Kind::INTEGER:
+      case Kind::STRING:
+      case Kind::BOOLEAN:
+        break;
+      case Kind::PREFIX:
+      case Kind::WHILE:
+      case Kind::RETURN:
+      case Kind::EXPRESSION:
+        one(node.a);
+        break;
+      case Kind::INFIX:
+      case Kind::INDEX:
+      case Kind::LET:
+        one(node.a);
+        one(node.b);
+        break;
+      case Kind::IF:
+        one(node.a);
+        one(node.b);
+        one(node.c);
+        break;
+      case Kind::FUNCTION:
+        each(node.a, node.b);
+        one(node.c);
+        break;
+      case Kind::CALL:
+        one(node.a);
+        each(node.b, node.c);
+        break;
+    }
+  }
+
+  // Prints the tree the way ASTPrinter prints the Program it came from.
+  std::string toString() const;
+};
+}  // namespace Flat
@@ -0,0 +1,97 @@
+#include "code.hpp"
+#include <spdlog/spdlog.h>
+#include <map>
+#include <sstream>
+
+using namespace Code;
+
+std::map<Opcode, Definition> definitions = {
+    {Opcode::CONSTANT, {"CONSTANT", {2}}},
+    {Opcode::POP, {"POP", {}}},
+    {Opcode::PUSH_TRUE, {"PUSH_TRUE", {}}},
+    {Opcode::PUSH_FALSE, {"PUSH_FALSE", {}}},
+    {Opcode::PUSH_NULL, {"PUSH_NULL", {}}},
+    {Opcode::ADD, {"ADD", {}}},
+    {Opcode::SUB, {"SUB", {}}},
+    {Opcode::MUL, {"MUL", {}}},
+    {Opcode::DIV, {"DIV", {}}},
+    {Opcode::EQUAL, {"EQUAL", {}}},
+    {Opcode::NOT_EQUAL, {"NOT_EQUAL", {}}},
+    {Opcode::GREATER_THAN, {"GREATER_THAN", {}}},
+    {Opcode::LESS_THAN, {"LESS_THAN", {}}},
+    {Opcode::MINUS, {"MINUS", {}}},
+    {Opcode::BANG, {"BANG", {}}},
+    {Opcode::JUMP, {"JUMP", {2}}},
+    {Opcode::JUMP_NOT_TRUTHY, {"JUMP_NOT_TRUTHY", {2}}},
+    {Opcode::GET_GLOBAL, {"GET_GLOBAL", {2}}},
+    {Opcode::SET_GLOBAL, {"SET_GLOBAL", {2}}},
+    {Opcode::GET_LOCAL, {"GET_LOCAL", {1}}},
+    {Opcode::SET_LOCAL, {"SET_LOCAL", {1}}},
+    {Opcode::GET_BUILTIN, {"GET_BUILTIN", {1}}},
+    {Opcode::GET_FREE, {"GET_FREE", {1}}},
+    {Opcode::CURRENT_CLOSURE, {"CURRENT_CLOSURE", {}}},
+    {Opcode::ARRAY, {"ARRAY", {2}}},
+    {Opcode::HASH, {"HASH", {2}}},
+    {Opcode::INDEX, {"INDEX", {}}},
+    {Opcode::CALL, {"CALL", {1}}},
+    {Opcode::RETURN_VALUE, {"RETURN_VALUE", {}}},
+    {Opcode::RETURN, {"RETURN", {}}},
+    {Opcode::CLOSURE, {"CLOSURE", {2, 1}}},
+};
+
+const Definition &Code::lookup(Opcode op) {
+  auto def = definitions.find(op);
+  if (def == definitions.end()) {
+    throw "Opcode doesn't exist!";
+  }
+  return def->second;
+}
+
+Instructions Code::make(Opcode op,
+                        std::initializer_list<std::uint32_t> operands) {
+  const auto &def = lookup(op);
+  std::size_t length = 1;
+  for (auto width : def.operandWidths) {
+    length += width;
+  }
+  Instructions instruction(length);
+  instruction[0] = static_cast<std::uint8_t>(op);
+  std::size_t offset = 1;
+  auto operand = operands.begin();
+  for (auto width : def.operandWidths) {
+    auto value = operand != operands.end() ? *(operand++) : 0;
+    switch (width) {
+      case 2:
+        putUint16(&instruction[offset], static_cast<std::uint16_t>(value));
+        break;
+      case 1:
+        instruction[offset] = static_cast<std::uint8_t>(value);
+        break;
+    }
+    offset += width;
+  }
+  return instruction;
+}
+
+std::string Code::instructionsToString(const Instructions &instructions) {
+  std::stringstream ss;
+  std::size_t offset = 0;
+  while (offset < instructions.size()) {
+    const auto &def = lookup(static_cast<Opcode>(instructions[offset]));
+    ss << fmt::format("{:04d} {}", offset, def.name);
+    offset += 1;
+    for (auto width : def.operandWidths) {
+      switch (width) {
+        case 2:
+          ss << " " << readUint16(&instructions[offset]);
+          break;
+        case 1:
+          ss << " " << static_cast<int>(readUint8(&instructions[offset]));
+          break;
+      }
+      offset += width;
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace Code {
+typedef std::vector<std::uint8_t> Instructions;
+
+enum class Opcode : std::uint8_t {
+  // Stack
+  CONSTANT = 0x0,
+  POP = 0x1,
+  PUSH_TRUE = 0x2,
+  PUSH_FALSE = 0x3,
+  PUSH_NULL = 0x4,
+
+  // Arithmetic and comparison
+  ADD = 0x10,
+  SUB = 0x11,
+  MUL = 0x12,
+  DIV = 0x13,
+  EQUAL = 0x14,
+  NOT_EQUAL = 0x15,
+  GREATER_THAN = 0x16,
+  LESS_THAN = 0x17,
+  MINUS = 0x18,
+  BANG = 0x19,
+
+  // Control flow
+  JUMP = 0x20,
+  JUMP_NOT_TRUTHY = 0x21,
+
+  // Bindings
+  GET_GLOBAL = 0x30,
+  SET_GLOBAL = 0x31,
+  GET_LOCAL = 0x32,
+  SET_LOCAL = 0x33,
+  GET_BUILTIN = 0x34,
+  GET_FREE = 0x35,
+  CURRENT_CLOSURE = 0x36,
+
+  // Composite values
+  ARRAY = 0x40,
+  HASH = 0x41,
+  INDEX = 0x42,
+
+  // Functions
+  CALL = 0x50,
+  RETURN_VALUE = 0x51,
+  RETURN = 0x52,
+  CLOSURE = 0x53,
+};
+
+struct Definition {
+  std::string name;
+  std::vector<std::uint8_t> operandWidths;
+};
+
+const Definition &lookup(Opcode op);
+
+Instructions make(Opcode op, std::initializer_list<std::uint32_t> operands);
+
+std::string instructionsToString(const Instructions &instructions);
+
+inline std::uint16_t readUint16(const std::uint8_t *ins) {
+  return static_cast<std::uint16_t>((ins[0] << 8) | ins[1]);
+}
+
+inline std::uint8_t readUint8(const std::uint8_t *ins) { return ins[0]; }
+
+inline void putUint16(std::uint8_t *ins, std::uint16_t value) {
+  ins[0] = static_cast<std::uint8_t>(value >> 8);
+  ins[1] = static_cast<std::uint8_t>(value & 0xff);
+}
+}  // namespace Code
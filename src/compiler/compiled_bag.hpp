@@ -0,0 +1,85 @@
+#pragma once
+#include <ast.hpp>
+#include <bag.hpp>
+#include <code.hpp>
+
+namespace Eval {
+/*
+
+  Bytecode bag classes
+
+*/
+class CompiledFunctionBag : public Bag {
+ private:
+  Code::Instructions _instructions;
+  std::uint32_t _numLocals;
+  // Keeps the parameters and body, which only inspect() uses, alive.
+  std::shared_ptr<const AST::Arena> _arena;
+  AST::Span<AST::Identifier*> _parameters;
+  AST::BlockStatement* _body;
+
+ public:
+  CompiledFunctionBag(Code::Instructions instructions, std::uint32_t numLocals,
+                      std::shared_ptr<const AST::Arena> arena,
+                      AST::Span<AST::Identifier*> parameters,
+                      AST::BlockStatement* body)
+      : _instructions(std::move(instructions)),
+        _numLocals(numLocals),
+        _arena(std::move(arena)),
+        _parameters(parameters),
+        _body(body){};
+  virtual std::string inspect() const override {
+    return inspectFunction(_parameters.begin(), _parameters.end(), _body);
+  };
+  virtual Type type() const override { return Type::COMPILED_FUNC_OBJ; };
+  const Code::Instructions& instructions() const { return _instructions; }
+  std::uint32_t numLocals() const { return _numLocals; }
+  std::uint32_t numParameters() const { return _parameters.size(); }
+  AST::Span<AST::Identifier*> parameters() const { return _parameters; }
+  AST::BlockStatement& body() const { return *_body; }
+};
+
+class ClosureBag : public Bag {
+ private:
+  std::shared_ptr<CompiledFunctionBag> _fn;
+  std::vector<Value> _free;
+  std::vector<Value> _bound;
+
+ public:
+  ClosureBag(std::shared_ptr<CompiledFunctionBag> fn,
+             std::vector<Value> free,
+             std::vector<Value> bound = {})
+      : _fn(fn), _free(std::move(free)), _bound(std::move(bound)){};
+  virtual std::string inspect() const override {
+    auto parameters = _fn->parameters();
+    return inspectFunction(parameters.begin() + _bound.size(),
+                           parameters.end(), &_fn->body());
+  };
+  virtual Type type() const override { return Type::CLOSURE_OBJ; };
+  virtual void trace(GC::Tracer& tracer) const override {
+    tracer.visit(_fn.get());
+    for (const auto& value : _free) {
+      value.trace(tracer);
+    }
+    for (const auto& value : _bound) {
+      value.trace(tracer);
+    }
+  }
+  virtual void clear() override {
+    _free.clear();
+    _bound.clear();
+  }
+  const std::shared_ptr<CompiledFunctionBag>& fn() const { return _fn; }
+  const std::vector<Value>& free() const { return _free; }
+  // Arguments already supplied by partial application.
+  const std::vector<Value>& bound() const { return _bound; }
+};
+
+inline std::shared_ptr<CompiledFunctionBag> convertToCompiledFunction(
+    const Value& value) {
+  return convertType<CompiledFunctionBag>(value, Type::COMPILED_FUNC_OBJ);
+}
+inline std::shared_ptr<ClosureBag> convertToClosure(const Value& value) {
+  return convertType<ClosureBag>(value, Type::CLOSURE_OBJ);
+}
+}  // namespace Eval
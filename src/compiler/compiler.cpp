@@ -0,0 +1,404 @@
+#include "compiler.hpp"
+#include <spdlog/spdlog.h>
+#include <builtin.hpp>
+#include <constant_folder.hpp>
+#include <eval_ops.hpp>
+#include <limits>
+
+using Code::Opcode;
+
+Compiler::Compiler(std::shared_ptr<SymbolTable> globals,
+                   std::vector<Eval::Value> constants)
+    : constants(std::move(constants)),
+      globals(globals),
+      symbolTable(globals),
+      logger(Trace::logger(COMPILER_LOGGER)) {
+  this->scopes.emplace_back();
+}
+
+std::shared_ptr<SymbolTable> Compiler::makeGlobals() {
+  auto globals = std::make_shared<SymbolTable>();
+  const auto &builtins = Builtin::list();
+  for (std::uint32_t index = 0; index < builtins.size(); index++) {
+    globals->defineBuiltin(index, builtins[index]->inspect());
+  }
+  return globals;
+}
+
+Bytecode Compiler::bytecode() const {
+  return Bytecode{this->scopes.front().instructions, this->constants};
+}
+
+/*
+
+  Emitting helpers
+
+*/
+std::size_t Compiler::addConstant(Eval::Value value) {
+  if (this->constants.size() > std::numeric_limits<std::uint16_t>::max()) {
+    this->addError("too many constants in one program");
+  }
+  this->constants.push_back(std::move(value));
+  return this->constants.size() - 1;
+}
+
+std::size_t Compiler::emit(Opcode op,
+                           std::initializer_list<std::uint32_t> operands) {
+  auto instruction = Code::make(op, operands);
+  auto &scope = this->currentScope();
+  auto position = scope.instructions.size();
+  scope.instructions.insert(scope.instructions.end(), instruction.begin(),
+                            instruction.end());
+  scope.previousInstruction = scope.lastInstruction;
+  scope.lastInstruction = EmittedInstruction{op, position};
+  scope.hasLastInstruction = true;
+  return position;
+}
+
+bool Compiler::lastInstructionIs(Opcode op) const {
+  const auto &scope = this->scopes.back();
+  return scope.hasLastInstruction && scope.lastInstruction.opcode == op;
+}
+
+void Compiler::removeLastPop() {
+  auto &scope = this->currentScope();
+  scope.instructions.resize(scope.lastInstruction.position);
+  scope.lastInstruction = scope.previousInstruction;
+}
+
+void Compiler::replaceLastPopWithReturn() {
+  auto &scope = this->currentScope();
+  scope.instructions[scope.lastInstruction.position] =
+      static_cast<std::uint8_t>(Opcode::RETURN_VALUE);
+  scope.lastInstruction.opcode = Opcode::RETURN_VALUE;
+}
+
+void Compiler::changeOperand(std::size_t position, std::uint32_t operand) {
+  auto &instructions = this->currentScope().instructions;
+  auto op = static_cast<Opcode>(instructions[position]);
+  auto instruction = Code::make(op, {operand});
+  std::copy(instruction.begin(), instruction.end(),
+            instructions.begin() + position);
+}
+
+std::uint32_t Compiler::jumpTarget(std::size_t position) {
+  if (position > std::numeric_limits<std::uint16_t>::max()) {
+    this->addError("too much code in one function to jump over");
+  }
+  return static_cast<std::uint32_t>(position);
+}
+
+void Compiler::loadSymbol(const Symbol &symbol) {
+  switch (symbol.scope) {
+    case SymbolScope::GLOBAL:
+      this->emit(Opcode::GET_GLOBAL, {symbol.index});
+      break;
+    case SymbolScope::LOCAL:
+      this->emit(Opcode::GET_LOCAL, {symbol.index});
+      break;
+    case SymbolScope::BUILTIN:
+      this->emit(Opcode::GET_BUILTIN, {symbol.index});
+      break;
+    case SymbolScope::FREE:
+      this->emit(Opcode::GET_FREE, {symbol.index});
+      break;
+    case SymbolScope::FUNCTION:
+      this->emit(Opcode::CURRENT_CLOSURE);
+      break;
+  }
+}
+
+void Compiler::enterScope() {
+  this->scopes.emplace_back();
+  this->symbolTable = std::make_shared<SymbolTable>(this->symbolTable);
+}
+
+Code::Instructions Compiler::leaveScope() {
+  auto instructions = std::move(this->currentScope().instructions);
+  this->scopes.pop_back();
+  this->symbolTable = this->symbolTable->outer();
+  return instructions;
+}
+
+void Compiler::compileBlock(AST::BlockStatement &block) {
+  for (const auto &statement : block.getStatements()) {
+    this->compile(*statement);
+  }
+  // Blocks are expressions: leave their last value on the stack, or null when
+  // they end in a statement that doesn't produce one.
+  if (this->lastInstructionIs(Opcode::POP)) {
+    this->removeLastPop();
+  } else {
+    this->emit(Opcode::PUSH_NULL);
+  }
+}
+
+bool Compiler::compileConstant(AST::Expression &node) {
+  auto constant = node.getConstant();
+  if (!constant) {
+    return false;
+  }
+  auto index = this->addConstant(*constant);
+  this->emit(Opcode::CONSTANT, {static_cast<std::uint32_t>(index)});
+  return true;
+}
+
+/*
+
+  Dispatchers
+
+*/
+void Compiler::dispatch(AST::Node &) {}
+void Compiler::dispatch(AST::Statement &) {}
+void Compiler::dispatch(AST::Expression &) {}
+
+void Compiler::dispatch(AST::Program &node) {
+  TRACE_INFO(this->logger, "Compiling program");
+  for (const auto &statement : node.getStatements()) {
+    this->compile(*statement);
+  }
+  TRACE_INFO(this->logger, "Compiled program to {} bytes with {} constants",
+             this->currentScope().instructions.size(), this->constants.size());
+}
+
+void Compiler::dispatch(AST::Identifier &node) {
+  auto symbol = this->symbolTable->resolve(node.getValue());
+  if (!symbol) {
+    // Globals may be defined after the code that reads them, the VM reports
+    // unset globals when they are read.
+    symbol = &this->globals->define(node.getValue());
+  }
+  this->loadSymbol(*symbol);
+}
+
+void Compiler::dispatch(AST::Boolean &node) {
+  this->emit(node.getValue() ? Opcode::PUSH_TRUE : Opcode::PUSH_FALSE);
+}
+
+void Compiler::dispatch(AST::IntegerLiteral &node) {
+  auto index = this->addConstant(Eval::Value::fromInteger(node.getValue()));
+  this->emit(Opcode::CONSTANT, {static_cast<std::uint32_t>(index)});
+}
+
+void Compiler::dispatch(AST::StringLiteral &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  auto index =
+      this->addConstant(makeStringBag(std::string(node.getValue())));
+  this->emit(Opcode::CONSTANT, {static_cast<std::uint32_t>(index)});
+}
+
+void Compiler::dispatch(AST::ArrayLiteral &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  for (const auto &value : node.getValues()) {
+    this->compile(*value);
+  }
+  this->emit(Opcode::ARRAY, {static_cast<std::uint32_t>(node.size())});
+}
+
+void Compiler::dispatch(AST::HashLiteral &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  for (const auto &pair : node.getPairs()) {
+    this->compile(*pair.first);
+    this->compile(*pair.second);
+  }
+  this->emit(Opcode::HASH,
+             {static_cast<std::uint32_t>(node.getPairs().size())});
+}
+
+void Compiler::dispatch(AST::IndexExpression &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  this->compile(*node.getLeft());
+  this->compile(*node.getIndex());
+  this->emit(Opcode::INDEX);
+}
+
+void Compiler::dispatch(AST::PrefixExpression &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  this->compile(*node.getRight());
+  if (node.getOp() == "!") {
+    this->emit(Opcode::BANG);
+  } else if (node.getOp() == "-") {
+    this->emit(Opcode::MINUS);
+  } else {
+    this->addError(fmt::format("unknown prefix operator {}", node.getOp()));
+  }
+}
+
+void Compiler::dispatch(AST::InfixExpression &node) {
+  if (this->compileConstant(node)) {
+    return;
+  }
+  this->compile(*node.getLeft());
+  this->compile(*node.getRight());
+  auto op = node.getOp();
+  if (op == "+") {
+    this->emit(Opcode::ADD);
+  } else if (op == "-") {
+    this->emit(Opcode::SUB);
+  } else if (op == "*") {
+    this->emit(Opcode::MUL);
+  } else if (op == "/") {
+    this->emit(Opcode::DIV);
+  } else if (op == "<") {
+    this->emit(Opcode::LESS_THAN);
+  } else if (op == ">") {
+    this->emit(Opcode::GREATER_THAN);
+  } else if (op == "==") {
+    this->emit(Opcode::EQUAL);
+  } else if (op == "!=") {
+    this->emit(Opcode::NOT_EQUAL);
+  } else {
+    this->addError(fmt::format("unknown infix operator {}", op));
+  }
+}
+
+void Compiler::dispatch(AST::IfExpression &node) {
+  this->compile(*node.getCondition());
+  auto jumpNotTruthy = this->emit(Opcode::JUMP_NOT_TRUTHY, {0});
+  this->compileBlock(*node.getWhenTrue());
+  auto jump = this->emit(Opcode::JUMP, {0});
+  auto end = this->currentScope().instructions.size();
+  this->changeOperand(jumpNotTruthy, this->jumpTarget(end));
+  if (node.getWhenFalse()) {
+    this->compileBlock(*node.getWhenFalse());
+  } else {
+    this->emit(Opcode::PUSH_NULL);
+  }
+  end = this->currentScope().instructions.size();
+  this->changeOperand(jump, this->jumpTarget(end));
+}
+
+void Compiler::dispatch(AST::WhileExpression &node) {
+  auto loopStart = this->currentScope().instructions.size();
+  this->currentScope().loopExits.emplace_back();
+  for (const auto &statement : node.getBody()->getStatements()) {
+    this->compile(*statement);
+  }
+  this->emit(Opcode::JUMP, {this->jumpTarget(loopStart)});
+  auto exits = std::move(this->currentScope().loopExits.back());
+  this->currentScope().loopExits.pop_back();
+  auto loopEnd = this->jumpTarget(this->currentScope().instructions.size());
+  for (auto exit : exits) {
+    this->changeOperand(exit, loopEnd);
+  }
+}
+
+void Compiler::dispatch(AST::FunctionLiteral &node) {
+  auto name = std::move(this->pendingFunctionName);
+  this->pendingFunctionName.clear();
+  // Deferred bodies are parsed here: closures need their free variables
+  // before anything runs. They missed the folding pass, so it runs on them
+  // now.
+  auto deferred = node.isDeferred();
+  auto body = node.getBody();
+  if (!body) {
+    this->addError(fmt::format("syntax error in function body: {}",
+                               node.getBodyError()));
+    return;
+  }
+  if (deferred) {
+    ConstantFolder::fold(node.getBodyArena(), *body);
+  }
+
+  this->enterScope();
+  if (!name.empty()) {
+    this->symbolTable->defineFunctionName(name);
+  }
+  for (const auto &argument : node.getArguments()) {
+    this->symbolTable->define(argument->getValue());
+  }
+  for (const auto &statement : body->getStatements()) {
+    this->compile(*statement);
+  }
+  if (this->lastInstructionIs(Opcode::POP)) {
+    this->replaceLastPopWithReturn();
+  }
+  if (!this->lastInstructionIs(Opcode::RETURN_VALUE)) {
+    this->emit(Opcode::RETURN);
+  }
+
+  auto freeSymbols = this->symbolTable->freeSymbols();
+  auto numLocals = this->symbolTable->size();
+  auto instructions = this->leaveScope();
+  for (const auto &symbol : freeSymbols) {
+    this->loadSymbol(symbol);
+  }
+  if (node.getArguments().size() > std::numeric_limits<std::uint8_t>::max() ||
+      numLocals > std::numeric_limits<std::uint8_t>::max()) {
+    this->addError("too many local bindings in one function");
+  }
+  auto fn = std::make_shared<Eval::CompiledFunctionBag>(
+      std::move(instructions), numLocals, node.getArena(), node.getArguments(),
+      body);
+  TRACE_INFO(this->logger,
+             "Compiled function {} with {} locals and {} free variables",
+             name.empty() ? "<anonymous>" : name, numLocals,
+             freeSymbols.size());
+  auto index = this->addConstant(fn);
+  this->emit(Opcode::CLOSURE, {static_cast<std::uint32_t>(index),
+                               static_cast<std::uint32_t>(freeSymbols.size())});
+}
+
+void Compiler::dispatch(AST::CallExpression &node) {
+  this->compile(*node.getFunction());
+  for (const auto &argument : node.getArguments()) {
+    this->compile(*argument);
+  }
+  if (node.getArguments().size() > std::numeric_limits<std::uint8_t>::max()) {
+    this->addError("too many arguments in one call");
+  }
+  this->emit(Opcode::CALL,
+             {static_cast<std::uint32_t>(node.getArguments().size())});
+}
+
+void Compiler::dispatch(AST::ReturnStatement &node) {
+  if (node.getReturnValue()) {
+    this->compile(*node.getReturnValue());
+  } else {
+    this->emit(Opcode::PUSH_NULL);
+  }
+  auto &loopExits = this->currentScope().loopExits;
+  if (!loopExits.empty()) {
+    loopExits.back().push_back(this->emit(Opcode::JUMP, {0}));
+    return;
+  }
+  this->emit(Opcode::RETURN_VALUE);
+}
+
+void Compiler::dispatch(AST::ExpressionStatement &node) {
+  this->compile(*node.getExpression());
+  this->emit(Opcode::POP);
+}
+
+void Compiler::dispatch(AST::LetStatement &node) {
+  auto name = node.getName()->getValue();
+  auto builtin = this->globals->resolve(name);
+  if (builtin && builtin->scope == SymbolScope::BUILTIN) {
+    // Builtins can't be rebound, the statement evaluates to the builtin.
+    this->loadSymbol(*builtin);
+    this->emit(Opcode::POP);
+    return;
+  }
+  if (dynamic_cast<AST::FunctionLiteral *>(node.getValue())) {
+    this->pendingFunctionName = name;
+  }
+  this->compile(*node.getValue());
+  const auto &symbol = this->symbolTable->define(name);
+  if (symbol.scope == SymbolScope::GLOBAL) {
+    this->emit(Opcode::SET_GLOBAL, {symbol.index});
+  } else {
+    this->emit(Opcode::SET_LOCAL, {symbol.index});
+  }
+}
+
+void Compiler::dispatch(AST::BlockStatement &node) { this->compileBlock(node); }
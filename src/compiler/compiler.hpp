@@ -0,0 +1,101 @@
+#pragma once
+#include <ast.hpp>
+#include <bag.hpp>
+#include <code.hpp>
+#include <compiled_bag.hpp>
+#include <memory>
+#include <string>
+#include <symbol_table.hpp>
+#include <trace.hpp>
+#include <vector>
+
+const std::string COMPILER_LOGGER = "compiler";
+
+struct Bytecode {
+  Code::Instructions instructions;
+  std::vector<Eval::Value> constants;
+};
+
+class Compiler : public AST::AbstractDispatcher {
+ private:
+  struct EmittedInstruction {
+    Code::Opcode opcode;
+    std::size_t position;
+  };
+
+  struct CompilationScope {
+    Code::Instructions instructions;
+    EmittedInstruction lastInstruction{Code::Opcode::POP, 0};
+    EmittedInstruction previousInstruction{Code::Opcode::POP, 0};
+    bool hasLastInstruction = false;
+    // A `return` inside a while body ends the loop with that value, so each
+    // enclosing while collects the jumps that have to be patched to its exit.
+    std::vector<std::vector<std::size_t>> loopExits;
+  };
+
+  std::vector<Eval::Value> constants;
+  std::shared_ptr<SymbolTable> globals;
+  std::shared_ptr<SymbolTable> symbolTable;
+  std::vector<CompilationScope> scopes;
+  std::vector<std::string> _errors;
+  std::string pendingFunctionName;
+  std::shared_ptr<spdlog::logger> logger;
+
+  std::size_t addConstant(Eval::Value value);
+  std::size_t emit(Code::Opcode op,
+                   std::initializer_list<std::uint32_t> operands = {});
+  bool lastInstructionIs(Code::Opcode op) const;
+  void removeLastPop();
+  void replaceLastPopWithReturn();
+  void changeOperand(std::size_t position, std::uint32_t operand);
+  // Jump operands are 16 bits, so a target past the end of that range is a
+  // compile error rather than a jump somewhere else.
+  std::uint32_t jumpTarget(std::size_t position);
+  void loadSymbol(const Symbol &symbol);
+  void compileBlock(AST::BlockStatement &block);
+  // Emits the value ConstantFolder left on `node`, if there is one.
+  bool compileConstant(AST::Expression &node);
+
+  void enterScope();
+  Code::Instructions leaveScope();
+  CompilationScope &currentScope() { return this->scopes.back(); }
+
+  void addError(std::string message) {
+    this->_errors.push_back(std::move(message));
+  }
+
+ public:
+  // Functions compiled by an earlier program refer to its constants by index,
+  // so a REPL session hands the previous pool back in.
+  explicit Compiler(std::shared_ptr<SymbolTable> globals,
+                    std::vector<Eval::Value> constants = {});
+
+  virtual void dispatch(AST::Node &node) override;
+  virtual void dispatch(AST::Statement &node) override;
+  virtual void dispatch(AST::Expression &node) override;
+  virtual void dispatch(AST::Program &node) override;
+  virtual void dispatch(AST::Identifier &node) override;
+  virtual void dispatch(AST::Boolean &node) override;
+  virtual void dispatch(AST::HashLiteral &node) override;
+  virtual void dispatch(AST::StringLiteral &node) override;
+  virtual void dispatch(AST::ArrayLiteral &node) override;
+  virtual void dispatch(AST::IntegerLiteral &node) override;
+  virtual void dispatch(AST::IndexExpression &node) override;
+  virtual void dispatch(AST::PrefixExpression &node) override;
+  virtual void dispatch(AST::InfixExpression &node) override;
+  virtual void dispatch(AST::IfExpression &node) override;
+  virtual void dispatch(AST::WhileExpression &node) override;
+  virtual void dispatch(AST::FunctionLiteral &node) override;
+  virtual void dispatch(AST::CallExpression &node) override;
+  virtual void dispatch(AST::ReturnStatement &node) override;
+  virtual void dispatch(AST::ExpressionStatement &node) override;
+  virtual void dispatch(AST::LetStatement &node) override;
+  virtual void dispatch(AST::BlockStatement &node) override;
+
+  void compile(AST::Node &node) { node.visit(*this); }
+  Bytecode bytecode() const;
+  const std::vector<std::string> &errors() const { return this->_errors; }
+
+  // A global symbol table with the builtins already defined.
+  static std::shared_ptr<SymbolTable> makeGlobals();
+};
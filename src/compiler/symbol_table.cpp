@@ -0,0 +1,48 @@
+#include "symbol_table.hpp"
+
+const Symbol &SymbolTable::define(const std::string &name) {
+  auto existing = this->_store.find(name);
+  if (existing != this->_store.end() &&
+      (existing->second.scope == SymbolScope::GLOBAL ||
+       existing->second.scope == SymbolScope::LOCAL)) {
+    return existing->second;
+  }
+  auto scope = this->_outer ? SymbolScope::LOCAL : SymbolScope::GLOBAL;
+  Symbol symbol{name, scope, static_cast<std::uint32_t>(this->_names.size())};
+  this->_names.push_back(name);
+  return this->_store[name] = symbol;
+}
+
+const Symbol &SymbolTable::defineBuiltin(std::uint32_t index,
+                                         const std::string &name) {
+  Symbol symbol{name, SymbolScope::BUILTIN, index};
+  return this->_store[name] = symbol;
+}
+
+const Symbol &SymbolTable::defineFunctionName(const std::string &name) {
+  Symbol symbol{name, SymbolScope::FUNCTION, 0};
+  return this->_store[name] = symbol;
+}
+
+const Symbol &SymbolTable::defineFree(const Symbol &original) {
+  this->_freeSymbols.push_back(original);
+  Symbol symbol{original.name, SymbolScope::FREE,
+                static_cast<std::uint32_t>(this->_freeSymbols.size() - 1)};
+  return this->_store[original.name] = symbol;
+}
+
+const Symbol *SymbolTable::resolve(const std::string &name) {
+  auto symbol = this->_store.find(name);
+  if (symbol != this->_store.end()) {
+    return &symbol->second;
+  }
+  if (!this->_outer) {
+    return nullptr;
+  }
+  auto outer = this->_outer->resolve(name);
+  if (!outer || outer->scope == SymbolScope::GLOBAL ||
+      outer->scope == SymbolScope::BUILTIN) {
+    return outer;
+  }
+  return &this->defineFree(*outer);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class SymbolScope : std::uint8_t {
+  GLOBAL,
+  LOCAL,
+  BUILTIN,
+  FREE,
+  FUNCTION,
+};
+
+struct Symbol {
+  std::string name;
+  SymbolScope scope;
+  std::uint32_t index;
+};
+
+class SymbolTable {
+ private:
+  std::shared_ptr<SymbolTable> _outer;
+  std::map<std::string, Symbol> _store;
+  std::vector<Symbol> _freeSymbols;
+  std::vector<std::string> _names;
+
+ public:
+  SymbolTable() : _outer(nullptr){};
+  explicit SymbolTable(std::shared_ptr<SymbolTable> outer) : _outer(outer){};
+
+  const Symbol &define(const std::string &name);
+  const Symbol &defineBuiltin(std::uint32_t index, const std::string &name);
+  const Symbol &defineFunctionName(const std::string &name);
+  const Symbol *resolve(const std::string &name);
+
+  std::shared_ptr<SymbolTable> outer() const { return _outer; }
+  const std::vector<Symbol> &freeSymbols() const { return _freeSymbols; }
+  std::uint32_t size() const { return _names.size(); }
+  const std::string &nameAt(std::uint32_t index) const {
+    return _names.at(index);
+  }
+
+ private:
+  const Symbol &defineFree(const Symbol &original);
+};
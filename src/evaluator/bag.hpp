@@ -3,167 +3,79 @@
 #include <ast.hpp>
 #include <env.hpp>
 #include <functional>
+#include <hash_table.hpp>
+#include <persistent_vector.hpp>
 #include <print_dispatcher.hpp>
 #include <sstream>
 #include <string>
+#include <value.hpp>
 
 namespace Eval {
-/*
-
-  Bag types
-
-*/
-enum class Type {
-  BASE_OBJ,
-  // basic
-  INTEGER_OBJ,
-  STRING_OBJ,
-  BOOLEAN_OBJ,
-  NULL_OBJ,
-  HASH_OBJ,
-  ERROR_OBJ,
-  // complex
-  FUNC_OBJ,
-  RETURN_OBJ,
-  BUILTIN_OBJ,
-  ARRAY_OBJ,
-};
-
-class Bag;
-
-class HashKey {
- private:
-  Type type;
-  uint64_t value;
-
- public:
-  HashKey(Type type, uint64_t value) : type(type), value(value) {}
-  bool operator==(HashKey& other) const {
-    return (other.type == type && other.value == value);
-  }
-  bool operator<(const HashKey& other) const {
-    if (other.type == type) {
-      return other.value < value;
-    }
-    return other.type < type;
-  }
-};
-
 class HashPair {
  private:
-  std::shared_ptr<Bag> _key;
-  std::shared_ptr<Bag> _value;
+  Value _key;
+  Value _value;
 
  public:
-  HashPair(std::shared_ptr<Bag> key, std::shared_ptr<Bag> value)
-      : _key(key), _value(value) {}
-  const std::shared_ptr<Bag> key() const { return _key; }
-  const std::shared_ptr<Bag> value() const { return _value; }
+  HashPair() = default;
+  HashPair(Value key, Value value)
+      : _key(std::move(key)), _value(std::move(value)) {}
+  const Value& key() const { return _key; }
+  const Value& value() const { return _value; }
 };
 
-inline std::string typeToString(Type type) {
-  switch (type) {
-    case Type::BASE_OBJ:
-      return "BASE";
-    case Type::INTEGER_OBJ:
-      return "INTEGER";
-    case Type::STRING_OBJ:
-      return "STRING";
-    case Type::BOOLEAN_OBJ:
-      return "BOOLEAN";
-    case Type::NULL_OBJ:
-      return "NULL";
-    case Type::RETURN_OBJ:
-      return "RETURN";
-    case Type::HASH_OBJ:
-      return "HASH";
-    case Type::ERROR_OBJ:
-      return "ERROR";
-    case Type::FUNC_OBJ:
-      return "FUNCTION";
-    case Type::BUILTIN_OBJ:
-      return "BUILTIN";
-    case Type::ARRAY_OBJ:
-      return "ARRAY";
+template <class Iterator>
+std::string inspectFunction(Iterator begin, Iterator end,
+                            AST::BlockStatement* body) {
+  std::stringstream ss;
+  ss << "fn(";
+  for (auto arg = begin; arg != end; ++arg) {
+    if (arg != begin) {
+      ss << ", ";
+    }
+    ASTPrinter::write([&](std::string message) { ss << message; }, **arg);
   }
+  ss << ") ";
+  if (body) {
+    ASTPrinter::write([&](std::string message) { ss << message; }, *body);
+  } else {
+    // A deferred body with syntax errors.
+    ss << "{ }";
+  }
+  return ss.str();
 }
 
-/*
-
-  Base bag
-
-*/
-class Bag {
- public:
-  virtual std::string inspect() const = 0;
-  virtual Type type() const = 0;
-  virtual const std::shared_ptr<HashKey> hash() const { return nullptr; };
-};
-
-typedef std::function<std::shared_ptr<Bag>(
-    const std::string& name,
-    const std::vector<std::shared_ptr<Bag>>& arguments)>
+typedef std::function<Value(const std::string& name,
+                            const std::vector<Value>& arguments)>
     BuiltinFunction;
 
 /*
 
   Basic bag classes
 
-*/
-class IntegerBag : public Bag {
- private:
-  int64_t _value;
-  std::shared_ptr<HashKey> _hash;
-
- public:
-  explicit IntegerBag(int64_t value) : _value(value) {
-    this->_hash = std::make_shared<HashKey>(Type::INTEGER_OBJ, _value);
-  };
-  virtual std::string inspect() const override {
-    return fmt::format("{}", _value);
-  };
-  virtual Type type() const override { return Type::INTEGER_OBJ; };
-  virtual const std::shared_ptr<HashKey> hash() const override { return _hash; }
-  int64_t value() const { return _value; }
-};
+  Integers, booleans and null are immediates held in a Value, only the
+  remaining types are heap allocated.
 
+*/
 class StringBag : public Bag {
  private:
   std::string _value;
-  std::shared_ptr<HashKey> _hash;
+  // Hashed on first use, most strings never become a key.
+  mutable std::optional<uint64_t> _hash;
 
  public:
-  explicit StringBag(const std::string& value) : _value(value) {
-    std::hash<std::string> hasher;
-    this->_hash = std::make_shared<HashKey>(Type::STRING_OBJ, hasher(_value));
-  };
+  explicit StringBag(std::string value) : _value(std::move(value)){};
   virtual std::string inspect() const override {
     return fmt::format("{}", _value);
   };
   virtual Type type() const override { return Type::STRING_OBJ; };
-  virtual const std::shared_ptr<HashKey> hash() const override { return _hash; }
-  std::string value() const { return _value; }
-};
-
-class BooleanBag : public Bag {
- private:
-  bool _value;
-  std::shared_ptr<HashKey> _hash;
-
- public:
-  explicit BooleanBag(bool value) : _value(value) {
-    uint64_t val = 0;
-    if (value) {
-      val = 1;
+  virtual std::optional<HashKey> hash() const override {
+    if (!_hash) {
+      _hash = std::hash<std::string>()(_value);
     }
-    this->_hash = std::make_shared<HashKey>(Type::BOOLEAN_OBJ, val);
-  };
-  virtual std::string inspect() const override {
-    return fmt::format("{}", _value);
-  };
-  virtual Type type() const override { return Type::BOOLEAN_OBJ; };
-  virtual const std::shared_ptr<HashKey> hash() const override { return _hash; }
-  bool value() const { return _value; }
+    return HashKey(Type::STRING_OBJ, *_hash);
+  }
+  const std::string& value() const { return _value; }
 };
 
 class ErrorBag : public Bag {
@@ -179,13 +91,6 @@ class ErrorBag : public Bag {
   std::string message() const { return _message; }
 };
 
-class NullBag : public Bag {
- public:
-  NullBag(){};
-  virtual std::string inspect() const override { return "null"; };
-  virtual Type type() const override { return Type::NULL_OBJ; };
-};
-
 /*
 
   Complex bag classes
@@ -193,39 +98,49 @@ class NullBag : public Bag {
 */
 class ReturnBag : public Bag {
  private:
-  std::shared_ptr<Bag> _value;
+  Value _value;
 
  public:
-  explicit ReturnBag(std::shared_ptr<Bag> value) : _value(value){};
+  explicit ReturnBag(Value value) : _value(std::move(value)){};
   virtual std::string inspect() const override {
-    return fmt::format("{}", _value->inspect());
+    return fmt::format("{}", _value.inspect());
   };
   virtual Type type() const override { return Type::RETURN_OBJ; };
-  std::shared_ptr<Bag> value() const { return _value; }
+  virtual void trace(GC::Tracer& tracer) const override {
+    _value.trace(tracer);
+  }
+  virtual void clear() override { _value = Value(); }
+  const Value& value() const { return _value; }
 };
 
 class ArrayBag : public Bag {
  private:
-  std::vector<std::shared_ptr<Bag>> _values;
+  PersistentVector<Value> _values;
 
  public:
-  explicit ArrayBag(const std::vector<std::shared_ptr<Bag>>& values)
-      : _values(values){};
+  explicit ArrayBag(std::vector<Value> values)
+      : _values(std::move(values)){};
+  explicit ArrayBag(PersistentVector<Value> values)
+      : _values(std::move(values)){};
   virtual std::string inspect() const override {
     std::stringstream ss;
     ss << "[";
     for (auto val = _values.begin(); val != _values.end(); ++val) {
       if (val == _values.begin()) {
-        ss << val->get()->inspect();
+        ss << val->inspect();
       } else {
-        ss << ", " << val->get()->inspect();
+        ss << ", " << val->inspect();
       }
     }
     ss << "]";
     return ss.str();
   };
   virtual Type type() const override { return Type::ARRAY_OBJ; };
-  std::vector<std::shared_ptr<Bag>>& values() { return _values; }
+  virtual void trace(GC::Tracer& tracer) const override {
+    _values.trace(tracer);
+  }
+  virtual void clear() override { _values.clear(); }
+  const PersistentVector<Value>& values() const { return _values; }
 };
 
 class BuiltinBag : public Bag {
@@ -238,8 +153,7 @@ class BuiltinBag : public Bag {
       : _name(name), _fn(fn){};
   virtual std::string inspect() const override { return _name; };
   virtual Type type() const override { return Type::BUILTIN_OBJ; };
-  std::shared_ptr<Bag> exec(
-      const std::vector<std::shared_ptr<Bag>>& arguments) const {
+  Value exec(const std::vector<Value>& arguments) const {
     return _fn(_name, arguments);
   }
 };
@@ -247,45 +161,105 @@ class BuiltinBag : public Bag {
 class FunctionBag : public Bag {
  private:
   std::shared_ptr<Env::Environment> _env;
-  std::vector<std::shared_ptr<AST::Identifier>> _arguments;
-  std::shared_ptr<AST::BlockStatement> _body;
+  // Keeps the arguments and body alive after their program is gone.
+  std::shared_ptr<const AST::Arena> _arena;
+  AST::Span<AST::Identifier*> _arguments;
+  // Where the body and locals come from, so a deferred body is only parsed
+  // and resolved when the function is first called.
+  AST::FunctionLiteral* _literal;
+  std::vector<Value> _bound;
 
  public:
   FunctionBag(std::shared_ptr<Env::Environment> env,
-              const std::vector<std::shared_ptr<AST::Identifier>>& arguments,
-              std::shared_ptr<AST::BlockStatement> body)
-      : _env(env), _arguments(arguments), _body(body){};
+              std::shared_ptr<const AST::Arena> arena,
+              AST::Span<AST::Identifier*> arguments,
+              AST::FunctionLiteral* literal, std::vector<Value> bound = {})
+      : _env(env),
+        _arena(std::move(arena)),
+        _arguments(arguments),
+        _literal(literal),
+        _bound(std::move(bound)){};
   virtual std::string inspect() const override {
-    std::stringstream ss;
-    ss << "fn(";
-    for (auto arg = _arguments.begin(); arg != _arguments.end(); ++arg) {
-      if (arg == _arguments.begin()) {
-        ASTPrinter::write([&](std::string message) { ss << message; },
-                          *arg->get());
-      } else {
-        ss << ", ";
-        ASTPrinter::write([&](std::string message) { ss << message; },
-                          *arg->get());
-      }
-    }
-    ss << ") ";
-    ASTPrinter::write([&](std::string message) { ss << message; }, *_body);
-    return ss.str();
+    return inspectFunction(_arguments.begin(), _arguments.end(),
+                           _literal->getBody());
   };
   virtual Type type() const override { return Type::FUNC_OBJ; };
-  std::vector<std::shared_ptr<AST::Identifier>>& arguments() {
-    return _arguments;
+  virtual void trace(GC::Tracer& tracer) const override {
+    if (_env) {
+      tracer.visit(_env.get());
+    }
+    for (const auto& value : _bound) {
+      value.trace(tracer);
+    }
   }
-  std::shared_ptr<AST::BlockStatement> body() { return _body; }
+  virtual void clear() override {
+    _env.reset();
+    _bound.clear();
+  }
+  AST::Span<AST::Identifier*> arguments() const { return _arguments; }
+  AST::FunctionLiteral* literal() const { return _literal; }
+  AST::BlockStatement* body() const { return _literal->getBody(); }
+  const std::shared_ptr<const AST::Arena>& arena() const { return _arena; }
   std::shared_ptr<Env::Environment> env() { return _env; }
+  const std::shared_ptr<const std::vector<Intern::Symbol>>& locals() const {
+    return _literal->getLocals();
+  }
+  // Leading arguments already supplied by partial application; they fill the
+  // first slots of every call.
+  const std::vector<Value>& bound() const { return _bound; }
 };
 
+// A call in tail position of a function body, handed back to applyFunction
+// instead of being evaluated so it can reuse the caller's native frame.
+class TailCallBag : public Bag {
+ private:
+  std::shared_ptr<FunctionBag> _function;
+  std::vector<Value> _arguments;
+
+ public:
+  TailCallBag(std::shared_ptr<FunctionBag> function,
+              std::vector<Value> arguments)
+      : _function(function), _arguments(std::move(arguments)){};
+  virtual std::string inspect() const override { return "tail call"; };
+  virtual Type type() const override { return Type::TAIL_CALL_OBJ; };
+  virtual void trace(GC::Tracer& tracer) const override {
+    if (_function) {
+      tracer.visit(_function.get());
+    }
+    for (const auto& value : _arguments) {
+      value.trace(tracer);
+    }
+  }
+  virtual void clear() override {
+    _function.reset();
+    _arguments.clear();
+  }
+  std::shared_ptr<FunctionBag> function() const { return _function; }
+  std::vector<Value>& arguments() { return _arguments; }
+};
+
+// Keys are equal when they hold the same integer, boolean or string. Other
+// heap values only equal themselves.
+inline bool hashKeysEqual(const Value& left, const Value& right) {
+  if (left.type() != right.type()) {
+    return false;
+  }
+  if (!left.isHeap()) {
+    return left.integer() == right.integer();
+  }
+  if (left.type() == Type::STRING_OBJ) {
+    return static_cast<const StringBag*>(left.bag().get())->value() ==
+           static_cast<const StringBag*>(right.bag().get())->value();
+  }
+  return left.bag() == right.bag();
+}
+
 class HashBag : public Bag {
  private:
-  std::map<HashKey, HashPair> _pairs;
+  HashTable<HashPair> _pairs;
 
  public:
-  explicit HashBag(const std::map<HashKey, HashPair>& pairs) : _pairs(pairs){};
+  HashBag() = default;
   virtual std::string inspect() const override {
     std::stringstream ss;
     ss << "{";
@@ -293,14 +267,34 @@ class HashBag : public Bag {
       if (pair != _pairs.begin()) {
         ss << ", ";
       }
-      ss << pair->second.key()->inspect() << ": "
-         << pair->second.value()->inspect();
+      ss << pair->key().inspect() << ": " << pair->value().inspect();
     }
     ss << "}";
     return ss.str();
   };
   virtual Type type() const override { return Type::HASH_OBJ; };
-  std::map<HashKey, HashPair>& pairs() { return _pairs; }
+  virtual void trace(GC::Tracer& tracer) const override {
+    for (const auto& pair : _pairs) {
+      pair.key().trace(tracer);
+      pair.value().trace(tracer);
+    }
+  }
+  virtual void clear() override { _pairs.clear(); }
+  const HashTable<HashPair>& pairs() const { return _pairs; }
+  void reserve(std::size_t pairs) { _pairs.reserve(pairs); }
+  // Adds the pair unless its key is already present, in which case the first
+  // value stays and false is returned.
+  bool insert(const HashKey& hash, HashPair pair) {
+    auto key = pair.key();
+    return _pairs.insert(hash.mix(), std::move(pair), [&](const HashPair& p) {
+      return hashKeysEqual(p.key(), key);
+    });
+  }
+  const HashPair* find(const HashKey& hash, const Value& key) const {
+    return _pairs.find(hash.mix(), [&](const HashPair& pair) {
+      return hashKeysEqual(pair.key(), key);
+    });
+  }
 };
 
 /*
@@ -309,57 +303,44 @@ class HashBag : public Bag {
 
 */
 template <class T>
-std::shared_ptr<T> convertType(std::shared_ptr<Bag> bag, Type type) {
-  if (bag->type() == type) {
-    return std::static_pointer_cast<T>(bag);
+std::shared_ptr<T> convertType(const Value& value, Type type) {
+  if (value.type() == type) {
+    return std::static_pointer_cast<T>(value.bag());
   }
   return nullptr;
 }
 
-inline std::shared_ptr<BooleanBag> convertToBoolean(std::shared_ptr<Bag> bag) {
-  return convertType<BooleanBag>(bag, Type::BOOLEAN_OBJ);
+inline std::shared_ptr<ReturnBag> convertToReturn(const Value& value) {
+  return convertType<ReturnBag>(value, Type::RETURN_OBJ);
 }
 
-inline std::shared_ptr<IntegerBag> convertToInteger(std::shared_ptr<Bag> bag) {
-  return convertType<IntegerBag>(bag, Type::INTEGER_OBJ);
+inline std::shared_ptr<ErrorBag> convertToError(const Value& value) {
+  return convertType<ErrorBag>(value, Type::ERROR_OBJ);
 }
 
-inline std::shared_ptr<NullBag> convertToNull(std::shared_ptr<Bag> bag) {
-  return convertType<NullBag>(bag, Type::NULL_OBJ);
+inline std::shared_ptr<StringBag> convertToString(const Value& value) {
+  return convertType<StringBag>(value, Type::STRING_OBJ);
 }
-
-inline std::shared_ptr<ReturnBag> convertToReturn(std::shared_ptr<Bag> bag) {
-  return convertType<ReturnBag>(bag, Type::RETURN_OBJ);
-}
-
-inline std::shared_ptr<ErrorBag> convertToError(std::shared_ptr<Bag> bag) {
-  return convertType<ErrorBag>(bag, Type::ERROR_OBJ);
-}
-
-inline std::shared_ptr<StringBag> convertToString(std::shared_ptr<Bag> bag) {
-  return convertType<StringBag>(bag, Type::STRING_OBJ);
+inline std::shared_ptr<BuiltinBag> convertToBuiltin(const Value& value) {
+  return convertType<BuiltinBag>(value, Type::BUILTIN_OBJ);
 }
-inline std::shared_ptr<BuiltinBag> convertToBuiltin(std::shared_ptr<Bag> bag) {
-  return convertType<BuiltinBag>(bag, Type::BUILTIN_OBJ);
+inline std::shared_ptr<FunctionBag> convertToFunction(const Value& value) {
+  return convertType<FunctionBag>(value, Type::FUNC_OBJ);
 }
-inline std::shared_ptr<FunctionBag> convertToFunction(
-    std::shared_ptr<Bag> bag) {
-  return convertType<FunctionBag>(bag, Type::FUNC_OBJ);
+inline std::shared_ptr<ArrayBag> convertToArray(const Value& value) {
+  return convertType<ArrayBag>(value, Type::ARRAY_OBJ);
 }
-inline std::shared_ptr<ArrayBag> convertToArray(std::shared_ptr<Bag> bag) {
-  return convertType<ArrayBag>(bag, Type::ARRAY_OBJ);
+inline std::shared_ptr<HashBag> convertToHash(const Value& value) {
+  return convertType<HashBag>(value, Type::HASH_OBJ);
 }
-inline std::shared_ptr<HashBag> convertToHash(std::shared_ptr<Bag> bag) {
-  return convertType<HashBag>(bag, Type::HASH_OBJ);
+inline std::shared_ptr<TailCallBag> convertToTailCall(const Value& value) {
+  return convertType<TailCallBag>(value, Type::TAIL_CALL_OBJ);
 }
 
-static const std::shared_ptr<Eval::BooleanBag> TRUE_BAG =
-    std::make_shared<Eval::BooleanBag>(true);
+static const Value TRUE_VALUE = Value::fromBoolean(true);
 
-static const std::shared_ptr<Eval::BooleanBag> FALSE_BAG =
-    std::make_shared<Eval::BooleanBag>(false);
+static const Value FALSE_VALUE = Value::fromBoolean(false);
 
-static const std::shared_ptr<Eval::NullBag> NULL_BAG =
-    std::make_shared<Eval::NullBag>();
+static const Value NULL_VALUE = Value::null();
 
 }  // namespace Eval
\ No newline at end of file
@@ -1,117 +1,136 @@
 #include "builtin.hpp"
+#include <algorithm>
 #include "bag.hpp"
 #include "eval_errors.hpp"
 #include "output.hpp"
 
-std::shared_ptr<Eval::Bag> evalLenBuiltin(
+Eval::Value evalLenBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   if (arguments.size() != 1) {
     return makeBuiltinInvalidNumberOfArguments(name, 1, arguments.size());
   }
-  auto arg = arguments.begin()->get();
+  const auto& arg = arguments.front();
 
-  switch (arg->type()) {
+  switch (arg.type()) {
     case (Eval::Type::STRING_OBJ): {
-      return std::make_shared<Eval::IntegerBag>(
-          ((Eval::StringBag*)arg)->value().size());
+      return Eval::Value::fromInteger(
+          Eval::convertToString(arg)->value().size());
     }
     case (Eval::Type::ARRAY_OBJ): {
-      return std::make_shared<Eval::IntegerBag>(
-          ((Eval::ArrayBag*)arg)->values().size());
+      return Eval::Value::fromInteger(
+          Eval::convertToArray(arg)->values().size());
     }
     default:
-      return makeBuiltinInvalidArgument(name, arg->type());
+      return makeBuiltinInvalidArgument(name, arg.type());
   }
 }
 
-std::shared_ptr<Eval::Bag> evalHeadBuiltin(
+Eval::Value evalHeadBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   if (arguments.size() != 1) {
     return makeBuiltinInvalidNumberOfArguments(name, 1, arguments.size());
   }
-  auto arg = arguments.begin()->get();
-  if (arg->type() == Eval::Type::ARRAY_OBJ) {
-    auto vec = ((Eval::ArrayBag*)arg)->values();
+  const auto& arg = arguments.front();
+  if (arg.type() == Eval::Type::ARRAY_OBJ) {
+    const auto& vec = Eval::convertToArray(arg)->values();
     if (vec.empty()) {
-      return Eval::NULL_BAG;
+      return Eval::NULL_VALUE;
     }
-    return vec.at(0);
+    return vec.front();
   }
-  return makeBuiltinInvalidArgument(name, arg->type());
+  return makeBuiltinInvalidArgument(name, arg.type());
 }
 
-std::shared_ptr<Eval::Bag> evalTailBuiltin(
+Eval::Value evalTailBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   if (arguments.size() != 1) {
     return makeBuiltinInvalidNumberOfArguments(name, 1, arguments.size());
   }
-  auto arg = arguments.begin()->get();
-  if (arg->type() == Eval::Type::ARRAY_OBJ) {
-    auto vec = ((Eval::ArrayBag*)arg)->values();
+  const auto& arg = arguments.front();
+  if (arg.type() == Eval::Type::ARRAY_OBJ) {
+    const auto& vec = Eval::convertToArray(arg)->values();
     if (vec.empty()) {
-      return Eval::NULL_BAG;
+      return Eval::NULL_VALUE;
     }
-    std::vector<std::shared_ptr<Eval::Bag>> sub(vec.begin() + 1, vec.end());
-    return std::make_shared<Eval::ArrayBag>(sub);
+    return std::make_shared<Eval::ArrayBag>(vec.drop_front());
   }
-  return makeBuiltinInvalidArgument(name, arg->type());
+  return makeBuiltinInvalidArgument(name, arg.type());
 }
 
-std::shared_ptr<Eval::Bag> evalPushBuiltin(
+Eval::Value evalPushBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   if (arguments.size() != 2) {
     return makeBuiltinInvalidNumberOfArguments(name, 2, arguments.size());
   }
-  auto arg = arguments.at(0);
-  auto elem = arguments.at(1);
-  if (arg->type() == Eval::Type::ARRAY_OBJ) {
-    auto vec = convertToArray(arg)->values();
-    std::vector<std::shared_ptr<Eval::Bag>> newVec(vec.begin(), vec.end());
-    newVec.push_back(elem);
-    return std::make_shared<Eval::ArrayBag>(newVec);
+  const auto& arg = arguments.at(0);
+  const auto& elem = arguments.at(1);
+  if (arg.type() == Eval::Type::ARRAY_OBJ) {
+    const auto& vec = convertToArray(arg)->values();
+    return std::make_shared<Eval::ArrayBag>(vec.push_back(elem));
   }
-  return makeBuiltinInvalidArgument(name, arg->type());
+  return makeBuiltinInvalidArgument(name, arg.type());
 }
 
-std::shared_ptr<Eval::Bag> evalPrintBuiltin(
+Eval::Value evalPrintBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   for (const auto& arg : arguments) {
-    spdlog::get(EVAL_OUTPUT)->info("{}", arg.get()->inspect());
+    spdlog::get(EVAL_OUTPUT)->info("{}", arg.inspect());
   }
-  return Eval::NULL_BAG;
+  return Eval::NULL_VALUE;
 }
 
-std::shared_ptr<Eval::Bag> evalSPrintBuiltin(
+Eval::Value evalSPrintBuiltin(
     const std::string& name,
-    const std::vector<std::shared_ptr<Eval::Bag>>& arguments) {
+    const std::vector<Eval::Value>& arguments) {
   std::stringstream ss;
   for (const auto& arg : arguments) {
-    ss << arg.get()->inspect();
+    ss << arg.inspect();
   }
   return std::make_shared<Eval::StringBag>(ss.str());
 }
 
-std::map<std::string, std::shared_ptr<Eval::BuiltinBag>> Builtin::_builtins = {
-    {"len", std::make_shared<Eval::BuiltinBag>("len", evalLenBuiltin)},
-    {"head", std::make_shared<Eval::BuiltinBag>("head", evalHeadBuiltin)},
-    {"tail", std::make_shared<Eval::BuiltinBag>("tail", evalTailBuiltin)},
-    {"push", std::make_shared<Eval::BuiltinBag>("push", evalPushBuiltin)},
-    {"print", std::make_shared<Eval::BuiltinBag>("print", evalPrintBuiltin)},
-    {"sprint", std::make_shared<Eval::BuiltinBag>("sprint", evalSPrintBuiltin)},
+typedef std::map<Intern::Symbol, std::shared_ptr<Eval::BuiltinBag>> Builtins;
+
+static Builtins::value_type builtin(const std::string& name,
+                                    Eval::BuiltinFunction function) {
+  return {Intern::Symbol::intern(name),
+          std::make_shared<Eval::BuiltinBag>(name, function)};
+}
+
+Builtins Builtin::_builtins = {
+    builtin("len", evalLenBuiltin),     builtin("head", evalHeadBuiltin),
+    builtin("tail", evalTailBuiltin),   builtin("push", evalPushBuiltin),
+    builtin("print", evalPrintBuiltin), builtin("sprint", evalSPrintBuiltin),
 };
 
-std::shared_ptr<Eval::BuiltinBag> Builtin::get(const std::string& name) {
-  if (Builtin::_builtins.find(name) != Builtin::_builtins.end()) {
-    return Builtin::_builtins.at(name);
+std::shared_ptr<Eval::BuiltinBag> Builtin::get(Intern::Symbol name) {
+  auto builtin = Builtin::_builtins.find(name);
+  if (builtin != Builtin::_builtins.end()) {
+    return builtin->second;
   }
   return nullptr;
 }
 
-bool Builtin::contains(const std::string& name) {
+bool Builtin::contains(Intern::Symbol name) {
   return Builtin::_builtins.find(name) != Builtin::_builtins.end();
+}
+
+const std::vector<std::shared_ptr<Eval::BuiltinBag>>& Builtin::list() {
+  static const std::vector<std::shared_ptr<Eval::BuiltinBag>> builtins = [] {
+    std::vector<std::shared_ptr<Eval::BuiltinBag>> list;
+    for (const auto& builtin : Builtin::_builtins) {
+      list.push_back(builtin.second);
+    }
+    // Symbol IDs depend on interning order, so sort by name instead.
+    std::sort(list.begin(), list.end(), [](const auto& a, const auto& b) {
+      return a->inspect() < b->inspect();
+    });
+    return list;
+  }();
+  return builtins;
 }
\ No newline at end of file
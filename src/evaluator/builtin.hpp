@@ -3,9 +3,11 @@
 #include "bag.hpp"
 class Builtin {
  private:
-  static std::map<std::string, std::shared_ptr<Eval::BuiltinBag>> _builtins;
+  static std::map<Intern::Symbol, std::shared_ptr<Eval::BuiltinBag>> _builtins;
 
  public:
-  static std::shared_ptr<Eval::BuiltinBag> get(const std::string& name);
-  static bool contains(const std::string& name);
+  static std::shared_ptr<Eval::BuiltinBag> get(Intern::Symbol name);
+  static bool contains(Intern::Symbol name);
+  // Builtins in a stable order so bytecode can refer to them by index.
+  static const std::vector<std::shared_ptr<Eval::BuiltinBag>>& list();
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "constant_folder.hpp"
+#include "eval_ops.hpp"
+
+Eval::Value ConstantFolder::fold(AST::Node *node) {
+  this->folded = Eval::Value();
+  if (node) {
+    node->visit(*this);
+  }
+  return std::move(this->folded);
+}
+
+void ConstantFolder::attach(AST::Expression &node, Eval::Value value) {
+  if (!value || isError(value)) {
+    return;
+  }
+  node.setConstant(this->arena.make<Eval::Value>(value));
+  this->folded = std::move(value);
+}
+
+void ConstantFolder::dispatch(AST::Node &) {}
+void ConstantFolder::dispatch(AST::Statement &) {}
+void ConstantFolder::dispatch(AST::Expression &) {}
+
+void ConstantFolder::dispatch(AST::Program &node) {
+  for (const auto &statement : node.getStatements()) {
+    this->fold(statement);
+  }
+}
+
+void ConstantFolder::dispatch(AST::Identifier &) {}
+
+// Integers and booleans are stored in the Value itself, so their literals
+// cost nothing to evaluate and aren't given one.
+void ConstantFolder::dispatch(AST::Boolean &node) {
+  this->folded = Eval::Value::fromBoolean(node.getValue());
+}
+void ConstantFolder::dispatch(AST::IntegerLiteral &node) {
+  this->folded = Eval::Value::fromInteger(node.getValue());
+}
+
+void ConstantFolder::dispatch(AST::StringLiteral &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  this->attach(node, makeStringBag(std::string(node.getValue())));
+}
+
+void ConstantFolder::dispatch(AST::ArrayLiteral &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  std::vector<Eval::Value> values;
+  bool constant = true;
+  for (const auto &value : node.getValues()) {
+    values.push_back(this->fold(value));
+    constant = constant && values.back();
+  }
+  if (constant) {
+    this->attach(node, makeArrayBag(std::move(values)));
+  }
+}
+
+void ConstantFolder::dispatch(AST::HashLiteral &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  auto hash = std::make_shared<Eval::HashBag>();
+  hash->reserve(node.getPairs().size());
+  bool constant = true;
+  for (const auto &pair : node.getPairs()) {
+    auto key = this->fold(pair.first);
+    auto value = this->fold(pair.second);
+    auto keyHash = key ? key.hash() : std::nullopt;
+    constant = constant && keyHash && value;
+    if (constant) {
+      hash->insert(*keyHash, Eval::HashPair(std::move(key), std::move(value)));
+    }
+  }
+  if (constant) {
+    this->attach(node, hash);
+  }
+}
+
+void ConstantFolder::dispatch(AST::IndexExpression &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  auto left = this->fold(node.getLeft());
+  auto index = this->fold(node.getIndex());
+  if (left && index) {
+    this->attach(node, evalIndexExpression(left, index));
+  }
+}
+
+void ConstantFolder::dispatch(AST::PrefixExpression &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  auto right = this->fold(node.getRight());
+  if (!right) {
+    return;
+  }
+  if (node.getOp() == "!") {
+    this->attach(node, evalBangOperator(right));
+  } else if (node.getOp() == "-") {
+    this->attach(node, evalNegateOperator(right));
+  }
+}
+
+void ConstantFolder::dispatch(AST::InfixExpression &node) {
+  if (node.getConstant()) {
+    this->folded = *node.getConstant();
+    return;
+  }
+  auto left = this->fold(node.getLeft());
+  auto right = this->fold(node.getRight());
+  if (left && right) {
+    this->attach(node, evalInfixExpression(node.getOp(), left, right));
+  }
+}
+
+void ConstantFolder::dispatch(AST::IfExpression &node) {
+  this->fold(node.getCondition());
+  this->fold(node.getWhenTrue());
+  this->fold(node.getWhenFalse());
+  this->folded = Eval::Value();
+}
+
+void ConstantFolder::dispatch(AST::WhileExpression &node) {
+  this->fold(node.getBody());
+  this->folded = Eval::Value();
+}
+
+void ConstantFolder::dispatch(AST::FunctionLiteral &node) {
+  if (!node.isDeferred()) {
+    this->fold(node.getBody());
+  }
+  this->folded = Eval::Value();
+}
+
+void ConstantFolder::dispatch(AST::CallExpression &node) {
+  this->fold(node.getFunction());
+  for (const auto &argument : node.getArguments()) {
+    this->fold(argument);
+  }
+  this->folded = Eval::Value();
+}
+
+void ConstantFolder::dispatch(AST::ReturnStatement &node) {
+  this->fold(node.getReturnValue());
+}
+
+void ConstantFolder::dispatch(AST::ExpressionStatement &node) {
+  this->fold(node.getExpression());
+}
+
+void ConstantFolder::dispatch(AST::LetStatement &node) {
+  this->fold(node.getValue());
+}
+
+void ConstantFolder::dispatch(AST::BlockStatement &node) {
+  for (const auto &statement : node.getStatements()) {
+    this->fold(statement);
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <ast.hpp>
+#include <value.hpp>
+
+// Works out the value of every expression that doesn't depend on anything
+// evaluated at run time and attaches it to the expression, so the evaluator
+// and the compiler use it instead of evaluating the subtree.
+//
+// String literals get their StringBag built once. Prefix, infix and index
+// expressions over constants are folded with the same operations the
+// evaluator uses, unless that would produce an error, which is left for run
+// time to report. Array and hash literals whose elements are all constant
+// are built once and shared by every evaluation; bags are never changed
+// after they are built, so handing out the same one is safe.
+//
+// The values are kept in the program's arena and live as long as its nodes.
+// Bodies the parser deferred are skipped until they are parsed.
+class ConstantFolder : public AST::AbstractDispatcher {
+ private:
+  AST::Arena &arena;
+  // The value of the expression just visited, empty if it isn't constant.
+  Eval::Value folded;
+
+  explicit ConstantFolder(AST::Arena &arena) : arena(arena) {}
+
+  Eval::Value fold(AST::Node *node);
+  void attach(AST::Expression &node, Eval::Value value);
+
+ public:
+  virtual void dispatch(AST::Node &node) override;
+  virtual void dispatch(AST::Statement &node) override;
+  virtual void dispatch(AST::Expression &node) override;
+  virtual void dispatch(AST::Program &node) override;
+  virtual void dispatch(AST::Identifier &node) override;
+  virtual void dispatch(AST::Boolean &node) override;
+  virtual void dispatch(AST::HashLiteral &node) override;
+  virtual void dispatch(AST::StringLiteral &node) override;
+  virtual void dispatch(AST::ArrayLiteral &node) override;
+  virtual void dispatch(AST::IntegerLiteral &node) override;
+  virtual void dispatch(AST::IndexExpression &node) override;
+  virtual void dispatch(AST::PrefixExpression &node) override;
+  virtual void dispatch(AST::InfixExpression &node) override;
+  virtual void dispatch(AST::IfExpression &node) override;
+  virtual void dispatch(AST::WhileExpression &node) override;
+  virtual void dispatch(AST::FunctionLiteral &node) override;
+  virtual void dispatch(AST::CallExpression &node) override;
+  virtual void dispatch(AST::ReturnStatement &node) override;
+  virtual void dispatch(AST::ExpressionStatement &node) override;
+  virtual void dispatch(AST::LetStatement &node) override;
+  virtual void dispatch(AST::BlockStatement &node) override;
+
+  static void fold(AST::Program &program) {
+    ConstantFolder folder(program.getArena());
+    program.visit(folder);
+  }
+  // Folds `node`, which was parsed into `arena`.
+  static void fold(AST::Arena &arena, AST::Node &node) {
+    ConstantFolder folder(arena);
+    node.visit(folder);
+  }
+};
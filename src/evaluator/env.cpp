@@ -1,15 +1,51 @@
 #include "env.hpp"
 using namespace Env;
 
-void Environment::set(std::string identifier, std::shared_ptr<Eval::Bag> bag) {
-  this->_table[identifier] = bag;
+void Environment::set(Intern::Symbol identifier, Eval::Value value) {
+  if (this->_names) {
+    for (auto i = this->_names->size(); i > 0; i--) {
+      if ((*this->_names)[i - 1] == identifier) {
+        this->_slots[i - 1] = std::move(value);
+        return;
+      }
+    }
+  }
+  if (identifier.id() >= this->_table.size()) {
+    this->_table.resize(identifier.id() + 1);
+  }
+  this->_table[identifier.id()] = std::move(value);
 }
-std::shared_ptr<Eval::Bag> Environment::get(std::string identifier) {
-  if (this->_table.find(identifier) != this->_table.end()) {
-    return this->_table.at(identifier);
+Eval::Value Environment::get(Intern::Symbol identifier) {
+  if (this->_names) {
+    for (auto i = this->_names->size(); i > 0; i--) {
+      if ((*this->_names)[i - 1] == identifier && this->_slots[i - 1]) {
+        return this->_slots[i - 1];
+      }
+    }
+  }
+  if (identifier.id() < this->_table.size() &&
+      this->_table[identifier.id()]) {
+    return this->_table[identifier.id()];
   }
   if (this->_env) {
     return _env->get(identifier);
   }
-  return nullptr;
+  return Eval::Value();
+}
+
+void Environment::trace(GC::Tracer &tracer) const {
+  for (const auto &value : this->_table) {
+    value.trace(tracer);
+  }
+  for (const auto &value : this->_slots) {
+    value.trace(tracer);
+  }
+  if (this->_env) {
+    tracer.visit(this->_env.get());
+  }
+}
+void Environment::clear() {
+  this->_table.clear();
+  this->_slots.clear();
+  this->_env.reset();
 }
@@ -1,26 +1,48 @@
 #pragma once
+#include <gc.hpp>
 #include <iostream>
-#include <map>
 #include <memory>
 #include <string>
-namespace Eval {
-class Bag;
-}
+#include <symbol.hpp>
+#include <value.hpp>
+#include <vector>
 namespace Env {
-class Environment {
+class Environment : public GC::Object {
  private:
-  std::map<std::string, std::shared_ptr<Eval::Bag>> _table;
+  // Bindings made by name, indexed by Intern::Symbol::id().
+  std::vector<Eval::Value> _table;
+  // Function scopes keep their bindings in the slots handed out by the
+  // resolver; `_names` says which name each slot holds.
+  std::vector<Eval::Value> _slots;
+  std::shared_ptr<const std::vector<Intern::Symbol>> _names;
   std::shared_ptr<Environment> _env;
 
  public:
   Environment() : _env(nullptr){};
   explicit Environment(std::shared_ptr<Environment> env) : _env(env){};
   Environment(std::shared_ptr<Environment> env,
-              std::map<std::string, std::shared_ptr<Eval::Bag>> &refs)
-      : _env(env) {
-    _table.insert(refs.begin(), refs.end());
-  };
-  void set(std::string identifier, std::shared_ptr<Eval::Bag> bag);
-  std::shared_ptr<Eval::Bag> get(std::string identifier);
+              std::shared_ptr<const std::vector<Intern::Symbol>> names)
+      : _slots(names->size()), _names(names), _env(env){};
+  virtual void trace(GC::Tracer &tracer) const override;
+  virtual void clear() override;
+  void set(Intern::Symbol identifier, Eval::Value value);
+  Eval::Value get(Intern::Symbol identifier);
+
+  Eval::Value &slot(std::size_t index) { return this->_slots[index]; }
+  Environment *outer() { return this->_env.get(); }
+  Environment *ancestor(std::size_t depth) {
+    auto env = this;
+    for (; depth > 0; depth--) {
+      env = env->_env.get();
+    }
+    return env;
+  }
+  Environment *global() {
+    auto env = this;
+    while (env->_env) {
+      env = env->_env.get();
+    }
+    return env;
+  }
 };
-};  // namespace Env
\ No newline at end of file
+};  // namespace Env};
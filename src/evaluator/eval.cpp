@@ -2,342 +2,191 @@
 #include <bag.hpp>
 #include <eval.hpp>
 #include <eval_errors.hpp>
+#include <gc.hpp>
 #include <sstream>
 #include <string>
 #include <vector>
 #include "ast.hpp"
 #include "builtin.hpp"
+#include "constant_folder.hpp"
+#include "eval_ops.hpp"
+#include "resolver.hpp"
 #include "spdlog/sinks/null_sink.h"
 
-const std::shared_ptr<Eval::BooleanBag> TRUE_BAG = Eval::TRUE_BAG;
-
-const std::shared_ptr<Eval::BooleanBag> FALSE_BAG = Eval::FALSE_BAG;
-
-const std::shared_ptr<Eval::NullBag> NULL_BAG = Eval::NULL_BAG;
-
-std::shared_ptr<Eval::IntegerBag> makeIntegerBag(int64_t value) {
-  return std::make_shared<Eval::IntegerBag>(value);
-}
-
-std::shared_ptr<Eval::ReturnBag> makeReturnBag(
-    std::shared_ptr<Eval::Bag> value) {
-  return std::make_shared<Eval::ReturnBag>(value);
-}
-
-std::shared_ptr<Eval::StringBag> makeStringBag(std::string value) {
-  return std::make_shared<Eval::StringBag>(value);
-}
-
-std::shared_ptr<Eval::FunctionBag> makeFunctionBag(
-    std::shared_ptr<Env::Environment> env,
-    std::vector<std::shared_ptr<AST::Identifier>> arguments,
-    std::shared_ptr<AST::BlockStatement> body) {
-  return std::make_shared<Eval::FunctionBag>(env, arguments, body);
+Eval::Value ASTEvaluator::evaluate(
+    AST::Node &node, std::shared_ptr<Env::Environment> env, TailMode mode) {
+  auto outerEnv = std::move(this->env);
+  auto outerMode = this->mode;
+  this->env = std::move(env);
+  this->mode = mode;
+  node.visit(*this);
+  this->env = std::move(outerEnv);
+  this->mode = outerMode;
+  return std::move(this->bag);
 }
 
-std::shared_ptr<Eval::ArrayBag> makeArrayBag(
-    std::vector<std::shared_ptr<Eval::Bag>> values) {
-  return std::make_shared<Eval::ArrayBag>(values);
-}
-
-std::shared_ptr<Eval::BooleanBag> getBooleanBag(bool val) {
-  if (val) {
-    return TRUE_BAG;
-  }
-  return FALSE_BAG;
-}
-
-bool isError(std::shared_ptr<Eval::Bag> bag) {
-  if (bag) {
-    return bag->type() == Eval::Type::ERROR_OBJ;
-  }
-  return false;
-}
-
-std::shared_ptr<Eval::Bag> evalBangOperator(std::shared_ptr<Eval::Bag> right) {
-  switch (right->type()) {
-    case Eval::Type::BOOLEAN_OBJ: {
-      auto bag = Eval::convertToBoolean(right);
-      if (bag->value()) {
-        return FALSE_BAG;
-      }
-      return TRUE_BAG;
-    }
-    case Eval::Type::NULL_OBJ:
-      return TRUE_BAG;
-    default:
-      return FALSE_BAG;
-  };
-  return makePrefixOperatorError(right->type(), "!");
-}
-
-std::shared_ptr<Eval::Bag> evalNegateOperator(
-    std::shared_ptr<Eval::Bag> right) {
-  if (right->type() != Eval::Type::INTEGER_OBJ) {
-    return makePrefixOperatorError(right->type(), "-");
-  }
-  return std::make_shared<Eval::IntegerBag>(convertToInteger(right)->value() *
-                                            -1);
-}
-
-std::shared_ptr<Eval::Bag> evalIntegerInfixExpression(
-    const std::string &op, std::shared_ptr<Eval::IntegerBag> left,
-    std::shared_ptr<Eval::IntegerBag> right) {
-  if (op == "+") {
-    return makeIntegerBag(left->value() + right->value());
-  } else if (op == "-") {
-    return makeIntegerBag(left->value() - right->value());
-  } else if (op == "*") {
-    return makeIntegerBag(left->value() * right->value());
-  } else if (op == "/") {
-    if (right->value() == 0) {
-      return makeDivideByZeroError(left->value(), right->value());
-    }
-    return makeIntegerBag(left->value() / right->value());
-  } else if (op == "<") {
-    return getBooleanBag(left->value() < right->value());
-  } else if (op == ">") {
-    return getBooleanBag(left->value() > right->value());
-  } else if (op == "==") {
-    return getBooleanBag(left->value() == right->value());
-  } else if (op == "!=") {
-    return getBooleanBag(left->value() != right->value());
-  }
-  return makeInfixUnknownOperatorError(left->type(), right->type(), op);
-}
-
-std::shared_ptr<Eval::Bag> evalBooleanInfixExpression(
-    const std::string &op, std::shared_ptr<Eval::BooleanBag> left,
-    std::shared_ptr<Eval::BooleanBag> right) {
-  if (op == "==") {
-    return getBooleanBag(left->value() == right->value());
-  } else if (op == "!=") {
-    return getBooleanBag(left->value() != right->value());
-  }
-  return makeInfixUnknownOperatorError(left->type(), right->type(), op);
-}
-
-std::shared_ptr<Eval::Bag> evalStringInfixExpression(
-    const std::string &op, std::shared_ptr<Eval::StringBag> left,
-    std::shared_ptr<Eval::StringBag> right) {
-  if (op == "+") {
-    return makeStringBag(left->value() + right->value());
-  } else if (op == "==") {
-    return getBooleanBag(left->value() == right->value());
-  } else if (op == "!=") {
-    return getBooleanBag(left->value() != right->value());
-  }
-  return makeInfixUnknownOperatorError(left->type(), right->type(), op);
-}
-
-std::shared_ptr<Eval::Bag> evalArrayIndexExpression(
-    std::shared_ptr<Eval::ArrayBag> left,
-    std::shared_ptr<Eval::IntegerBag> index) {
-  if (index->value() > left->values().size() - 1) {
-    return NULL_BAG;
-  }
-  return left->values().at(index->value());
-}
-
-std::shared_ptr<Eval::Bag> evalHashIndexExpression(
-    std::shared_ptr<Eval::HashBag> left, std::shared_ptr<Eval::Bag> index) {
-  auto hash = index->hash();
-  if (!hash) {
-    return makeInvalidHashKeyType(index->type());
-  }
-  auto pair = left->pairs().find(*hash);
-  if (pair == left->pairs().end()) {
-    return NULL_BAG;
-  }
-  return pair->second.value();
-}
-
-std::shared_ptr<Eval::Bag> evalIndexExpression(
-    std::shared_ptr<Eval::Bag> left, std::shared_ptr<Eval::Bag> index) {
-  if (left->type() == Eval::Type::ARRAY_OBJ &&
-      index->type() == Eval::Type::INTEGER_OBJ) {
-    return evalArrayIndexExpression(convertToArray(left),
-                                    convertToInteger(index));
-  }
-  if (left->type() == Eval::Type::HASH_OBJ) {
-    return evalHashIndexExpression(convertToHash(left), index);
-  }
-  return makeInvalidIndexException(left->type(), index->type());
-}
+Eval::Value ASTEvaluator::evalIfExpression(AST::IfExpression &node) {
+  Eval::Value bag = NULL_VALUE;
+  TRACE_INFO(this->logger, "Evaluating {} expression",
+             Eval::typeToString(bag.type()));
 
-std::shared_ptr<Eval::Bag> evalInfixExpression(
-    const std::string &op, std::shared_ptr<Eval::Bag> left,
-    std::shared_ptr<Eval::Bag> right) {
-  switch (left->type()) {
-    case Eval::Type::INTEGER_OBJ: {
-      if (right->type() == Eval::Type::INTEGER_OBJ) {
-        return evalIntegerInfixExpression(op, convertToInteger(left),
-                                          convertToInteger(right));
-      }
-      break;
-    }
-    case Eval::Type::BOOLEAN_OBJ: {
-      if (right->type() == Eval::Type::BOOLEAN_OBJ) {
-        return evalBooleanInfixExpression(op, convertToBoolean(left),
-                                          convertToBoolean(right));
-      }
-      break;
-    }
-    case Eval::Type::STRING_OBJ: {
-      if (right->type() == Eval::Type::STRING_OBJ) {
-        return evalStringInfixExpression(op, convertToString(left),
-                                         convertToString(right));
-      }
-      break;
-    }
-    default:
-      // continue..
-      break;
-  }
-  if (left->type() != right->type()) {
-    return makeInfixTypeMismatchError(left->type(), right->type(), op);
-  } else {
-    return makeInfixUnknownOperatorError(left->type(), right->type(), op);
-  }
-}
-
-bool isTruthy(Eval::Bag &bag) {
-  switch (bag.type()) {
-    case Eval::Type::BOOLEAN_OBJ: {
-      return static_cast<Eval::BooleanBag &>(bag).value();
-    }
-    case Eval::Type::NULL_OBJ:
-      return false;
-    default:
-      return true;
-  }
-}
-
-std::shared_ptr<Eval::Bag> evalIfExpression(
-    AST::IfExpression &node, std::shared_ptr<Env::Environment> env) {
-  std::shared_ptr<Eval::Bag> bag = NULL_BAG;
-  spdlog::get(EVAL_LOGGER)
-      ->info("Evaluating {} expression", Eval::typeToString(bag->type()));
-
-  auto condition = ASTEvaluator::eval(*node.getCondition(), env);
+  auto condition = this->evaluate(*node.getCondition(), this->env);
   if (isError(condition)) {
     return condition;
   }
-  if (isTruthy(*condition)) {
-    spdlog::get(EVAL_LOGGER)->info("Evaluating when true expression");
-    bag = ASTEvaluator::eval(*node.getWhenTrue(), env);
+  if (isTruthy(condition)) {
+    TRACE_INFO(this->logger, "Evaluating when true expression");
+    bag = this->evaluate(*node.getWhenTrue(), this->env, this->mode);
   } else if (node.getWhenFalse()) {
-    spdlog::get(EVAL_LOGGER)->info("Evaluating when false expression");
-    bag = ASTEvaluator::eval(*node.getWhenFalse(), env);
+    TRACE_INFO(this->logger, "Evaluating when false expression");
+    bag = this->evaluate(*node.getWhenFalse(), this->env, this->mode);
   }
   return bag;
 }
 
-std::shared_ptr<Eval::Bag> evalWhileExpression(
-    AST::WhileExpression &node, std::shared_ptr<Env::Environment> env) {
-  std::shared_ptr<Eval::Bag> bag = NULL_BAG;
-  spdlog::get(EVAL_LOGGER)->info("Evaluating while expression");
-  auto wrappedEnv = std::make_shared<Env::Environment>(env);
-  while (bag->type() != Eval::Type::RETURN_OBJ) {
-    bag = ASTEvaluator::eval(*node.getBody(), env);
+Eval::Value ASTEvaluator::evalWhileExpression(AST::WhileExpression &node) {
+  Eval::Value bag = NULL_VALUE;
+  TRACE_INFO(this->logger, "Evaluating while expression");
+  while (bag.type() != Eval::Type::RETURN_OBJ) {
+    bag = this->evaluate(*node.getBody(), this->env);
   }
   return convertToReturn(bag)->value();
 }
 
-std::shared_ptr<Eval::Bag> evalHashLiteral(
-    AST::HashLiteral &node, std::shared_ptr<Env::Environment> env) {
-  std::shared_ptr<Eval::Bag> bag = NULL_BAG;
-  spdlog::get(EVAL_LOGGER)
-      ->info("Evaluating hash {} expression", Eval::typeToString(bag->type()));
-  std::map<Eval::HashKey, Eval::HashPair> hashMap;
-  for (auto pair : node.getPairs()) {
-    auto key = ASTEvaluator::eval(*pair.first, env);
+Eval::Value ASTEvaluator::evalHashLiteral(AST::HashLiteral &node) {
+  Eval::Value bag = NULL_VALUE;
+  TRACE_INFO(this->logger, "Evaluating hash {} expression",
+             Eval::typeToString(bag.type()));
+  auto hash = std::make_shared<Eval::HashBag>();
+  hash->reserve(node.getPairs().size());
+  for (const auto &pair : node.getPairs()) {
+    auto key = this->evaluate(*pair.first, this->env);
     if (isError(key)) {
       return key;
     }
-    auto keyHash = key->hash();
+    auto keyHash = key.hash();
     if (!keyHash) {
-      return makeInvalidHashKeyType(key->type());
+      return makeInvalidHashKeyType(key.type());
     }
-    auto value = ASTEvaluator::eval(*pair.second, env);
+    auto value = this->evaluate(*pair.second, this->env);
     if (isError(value)) {
       return value;
     }
-    Eval::HashPair hashPair(key, value);
-    hashMap.insert(std::make_pair(*keyHash, std::move(hashPair)));
+    hash->insert(*keyHash, Eval::HashPair(std::move(key), std::move(value)));
   }
-  return std::make_shared<Eval::HashBag>(hashMap);
+  return hash;
 }
 
-std::shared_ptr<Eval::Bag> evalProgram(
-    std::vector<std::shared_ptr<AST::Statement>> &statements,
-    std::shared_ptr<Env::Environment> env) {
-  std::shared_ptr<Eval::Bag> bag = NULL_BAG;
+Eval::Value ASTEvaluator::evalProgram(
+    const std::vector<AST::Statement *> &statements) {
+  Eval::Value bag = NULL_VALUE;
   for (const auto &statement : statements) {
-    bag = ASTEvaluator::eval(*statement.get(), env);
+    GC::Heap::collectIfNeeded();
+    bag = this->evaluate(*statement, this->env);
     if (!bag) {
       continue;
     }
-    if (bag->type() == Eval::Type::RETURN_OBJ) {
+    if (bag.type() == Eval::Type::RETURN_OBJ) {
       return convertToReturn(bag)->value();
     }
-    if (bag->type() == Eval::Type::ERROR_OBJ) {
+    if (bag.type() == Eval::Type::ERROR_OBJ) {
       return bag;
     }
   }
   return bag;
 }
 
-std::shared_ptr<Eval::Bag> evalBlockStatement(
-    std::vector<std::shared_ptr<AST::Statement>> &statements,
-    std::shared_ptr<Env::Environment> env) {
-  std::shared_ptr<Eval::Bag> bag = NULL_BAG;
-  for (const auto &statement : statements) {
-    bag = ASTEvaluator::eval(*statement.get(), env);
-    if (bag && ((bag->type() == Eval::Type::RETURN_OBJ) ||
-                (bag->type() == Eval::Type::ERROR_OBJ))) {
+Eval::Value ASTEvaluator::evalBlockStatement(
+    AST::Span<AST::Statement *> statements) {
+  Eval::Value bag = NULL_VALUE;
+  auto mode = this->mode;
+  auto innerMode = mode == TailMode::NONE ? TailMode::NONE
+                                          : TailMode::RETURN_ONLY;
+  for (auto statement = statements.begin(); statement != statements.end();
+       ++statement) {
+    auto isLast = statement + 1 == statements.end();
+    bag = this->evaluate(**statement, this->env, isLast ? mode : innerMode);
+    if (bag && ((bag.type() == Eval::Type::RETURN_OBJ) ||
+                (bag.type() == Eval::Type::ERROR_OBJ))) {
       return bag;
     }
   }
   return bag;
 }
 
-std::shared_ptr<Eval::Bag> applyFunction(
-    AST::CallExpression &node, std::shared_ptr<Eval::Bag> val,
-    std::shared_ptr<Env::Environment> env) {
-  if (val->type() == Eval::Type::FUNC_OBJ) {
+Eval::Value ASTEvaluator::callFunction(std::shared_ptr<Eval::FunctionBag> func,
+                                       std::vector<Eval::Value> args) {
+  // Calls in tail position come back as TailCallBags and are run here, so
+  // self-recursive helpers iterate without growing the native stack.
+  while (true) {
+    // Everything live is held by a shared_ptr here, so a collection can't
+    // sweep a value this call still needs.
+    GC::Heap::collectIfNeeded();
+    // The first call of a function whose body was deferred parses it.
+    auto literal = func->literal();
+    if (Resolver::resolveDeferred(*literal) && literal->getBody()) {
+      ConstantFolder::fold(literal->getBodyArena(), *literal->getBody());
+    }
+    auto body = func->body();
+    if (!body) {
+      return makeFunctionBodyError(func->literal()->getBodyError());
+    }
+    auto wrappedEnv =
+        std::make_shared<Env::Environment>(func->env(), func->locals());
+    for (std::size_t slot = 0; slot < args.size(); slot++) {
+      wrappedEnv->slot(slot) = std::move(args[slot]);
+    }
+    auto ret = this->evaluate(*body, wrappedEnv, TailMode::TAIL);
+    if (ret.type() == Eval::Type::RETURN_OBJ) {
+      ret = convertToReturn(ret)->value();
+    }
+    auto tailCall = Eval::convertToTailCall(ret);
+    if (!tailCall) {
+      return ret;
+    }
+    func = tailCall->function();
+    args = std::move(tailCall->arguments());
+  }
+}
+
+Eval::Value ASTEvaluator::applyFunction(AST::CallExpression &node,
+                                        Eval::Value val) {
+  if (val.type() == Eval::Type::FUNC_OBJ) {
     auto func = Eval::convertToFunction(val);
-    std::map<std::string, std::shared_ptr<Eval::Bag>> args;
-    auto identIter = func->arguments().begin();
+    if (node.getArguments().size() > func->arguments().size()) {
+      return makeWrongNumberOfArgumentsError(func->arguments().size(),
+                                             node.getArguments().size());
+    }
+    std::vector<Eval::Value> args(func->bound());
     for (const auto &arg : node.getArguments()) {
-      auto evalArg = ASTEvaluator::eval(*arg, env);
+      auto evalArg = this->evaluate(*arg, this->env);
       if (isError(evalArg)) {
         return evalArg;
       }
-      args[identIter->get()->getValue()] = evalArg;
-      identIter++;
+      args.push_back(std::move(evalArg));
     }
-    auto wrappedEnv = std::make_shared<Env::Environment>(func->env(), args);
-    if (args.size() < func->arguments().size()) {
+    if (node.getArguments().size() < func->arguments().size()) {
       // We have a partial function
-      std::vector<std::shared_ptr<AST::Identifier>> remainingArgs(
-          func->arguments().cbegin() + args.size(), func->arguments().cend());
-      return makeFunctionBag(wrappedEnv, remainingArgs, func->body());
+      auto supplied = node.getArguments().size();
+      AST::Span<AST::Identifier *> remainingArgs(
+          func->arguments().begin() + supplied,
+          func->arguments().size() - supplied);
+      return makeFunctionBag(func->env(), func->arena(), remainingArgs,
+                             func->literal(), std::move(args));
     }
-    auto ret = ASTEvaluator::eval(*func->body(), wrappedEnv);
-    if (ret->type() == Eval::Type::RETURN_OBJ) {
-      return convertToReturn(ret)->value();
+    if (this->mode == TailMode::TAIL) {
+      return std::make_shared<Eval::TailCallBag>(func, std::move(args));
     }
-    return ret;
-  } else if (val->type() == Eval::Type::BUILTIN_OBJ) {
+    return this->callFunction(func, std::move(args));
+  } else if (val.type() == Eval::Type::BUILTIN_OBJ) {
     auto func = Eval::convertToBuiltin(val);
-    std::vector<std::shared_ptr<Eval::Bag>> args;
+    std::vector<Eval::Value> args;
     for (const auto &arg : node.getArguments()) {
-      auto evalArg = ASTEvaluator::eval(*arg, env);
+      auto evalArg = this->evaluate(*arg, this->env);
       if (isError(evalArg)) {
         return evalArg;
       }
-      args.push_back(evalArg);
+      args.push_back(std::move(evalArg));
     }
     return func->exec(args);
   }
@@ -354,57 +203,80 @@ void ASTEvaluator::dispatch(AST::Expression &node){
 
 };
 void ASTEvaluator::dispatch(AST::Program &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating program");
-  auto statements = node.getStatements();
-  bag = evalProgram(statements, env);
-  spdlog::get(EVAL_LOGGER)->info("Finished evaulating program");
+  TRACE_INFO(this->logger, "Evaluating program");
+  Resolver::resolve(node);
+  ConstantFolder::fold(node);
+  const auto &statements = node.getStatements();
+  bag = this->evalProgram(statements);
+  TRACE_INFO(this->logger, "Finished evaulating program");
 };
 void ASTEvaluator::dispatch(AST::Identifier &node) {
-  spdlog::get(EVAL_LOGGER)->info("Fetching identifier {}", node.getValue());
-  auto val = env->get(node.getValue());
+  TRACE_INFO(this->logger, "Fetching identifier {}", node.getValue());
+  Eval::Value val;
+  if (node.isResolved()) {
+    auto scope = this->env->ancestor(node.getDepth());
+    val = scope->slot(node.getSlot());
+    if (!val && scope->outer()) {
+      // Read before its `let` ran, fall back to the enclosing scopes.
+      val = scope->outer()->get(node.getSymbol());
+    }
+  } else {
+    val = this->env->global()->get(node.getSymbol());
+  }
   if (val) {
-    bag = val;
+    bag = std::move(val);
   } else {
-    if (Builtin::contains(node.getValue())) {
-      bag = Builtin::get(node.getValue());
+    if (auto builtin = Builtin::get(node.getSymbol())) {
+      bag = std::move(builtin);
       return;
     }
     bag = makeIdentifierNotFoundError(node.getValue());
   }
 };
 void ASTEvaluator::dispatch(AST::Boolean &node) {
-  spdlog::get(EVAL_LOGGER)->info("Fetching boolean {}", node.getValue());
-  bag = std::make_shared<Eval::BooleanBag>(node.getValue());
+  TRACE_INFO(this->logger, "Fetching boolean {}", node.getValue());
+  bag = Eval::Value::fromBoolean(node.getValue());
 };
 void ASTEvaluator::dispatch(AST::IntegerLiteral &node) {
-  spdlog::get(EVAL_LOGGER)
-      ->info("Creating integer literal {}", node.getValue());
-  bag = std::make_shared<Eval::IntegerBag>(node.getValue());
+  TRACE_INFO(this->logger, "Creating integer literal {}", node.getValue());
+  bag = Eval::Value::fromInteger(node.getValue());
 };
 void ASTEvaluator::dispatch(AST::StringLiteral &node) {
-  spdlog::get(EVAL_LOGGER)->info("Creating string literal {}", node.getValue());
-  bag = std::make_shared<Eval::StringBag>(node.getValue());
+  TRACE_INFO(this->logger, "Creating string literal {}", node.getValue());
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
+  bag = std::make_shared<Eval::StringBag>(std::string(node.getValue()));
 };
 void ASTEvaluator::dispatch(AST::ArrayLiteral &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating array literal");
-  std::vector<std::shared_ptr<Eval::Bag>> args;
+  TRACE_INFO(this->logger, "Evaluating array literal");
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
+  std::vector<Eval::Value> args;
   for (const auto &val : node.getValues()) {
-    auto evalVal = ASTEvaluator::eval(*val, env);
+    auto evalVal = this->evaluate(*val, this->env);
     if (isError(evalVal)) {
       bag = evalVal;
       return;
     }
-    args.push_back(evalVal);
+    args.push_back(std::move(evalVal));
   }
-  bag = makeArrayBag(args);
+  bag = makeArrayBag(std::move(args));
 };
 void ASTEvaluator::dispatch(AST::IndexExpression &node) {
-  auto left = eval(*node.getLeft(), env);
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
+  auto left = this->evaluate(*node.getLeft(), this->env);
   if (isError(left)) {
     bag = left;
     return;
   }
-  auto index = eval(*node.getIndex(), env);
+  auto index = this->evaluate(*node.getIndex(), this->env);
   if (isError(index)) {
     bag = index;
     return;
@@ -412,17 +284,20 @@ void ASTEvaluator::dispatch(AST::IndexExpression &node) {
   bag = evalIndexExpression(left, index);
 };
 void ASTEvaluator::dispatch(AST::PrefixExpression &node) {
-  spdlog::get(EVAL_LOGGER)
-      ->info("Evaluating prefix expression {}", node.getOp());
+  TRACE_INFO(this->logger, "Evaluating prefix expression {}", node.getOp());
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
   if (node.getOp() == "!") {
-    auto right = eval(*node.getRight(), env);
+    auto right = this->evaluate(*node.getRight(), this->env);
     if (isError(right)) {
       bag = right;
       return;
     }
     bag = evalBangOperator(right);
   } else if (node.getOp() == "-") {
-    auto right = eval(*node.getRight(), env);
+    auto right = this->evaluate(*node.getRight(), this->env);
     if (isError(right)) {
       bag = right;
       return;
@@ -431,54 +306,64 @@ void ASTEvaluator::dispatch(AST::PrefixExpression &node) {
   }
 };
 void ASTEvaluator::dispatch(AST::InfixExpression &node) {
-  spdlog::get(EVAL_LOGGER)
-      ->info("Evaluating infix expression {}", node.getOp());
-  auto left = eval(*node.getLeft(), env);
+  TRACE_INFO(this->logger, "Evaluating infix expression {}", node.getOp());
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
+  auto left = this->evaluate(*node.getLeft(), this->env);
   if (isError(left)) {
     bag = left;
     return;
   }
-  auto right = eval(*node.getRight(), env);
+  auto right = this->evaluate(*node.getRight(), this->env);
   if (isError(right)) {
     bag = right;
     return;
   }
 
   bag = evalInfixExpression(node.getOp(), left, right);
-  spdlog::get(EVAL_LOGGER)
-      ->info("Returning infix statement {}", bag->inspect());
+  TRACE_INFO(this->logger, "Returning infix statement {}", bag.inspect());
 };
 void ASTEvaluator::dispatch(AST::IfExpression &node) {
-  bag = evalIfExpression(node, env);
-  spdlog::get(EVAL_LOGGER)
-      ->info("Returning if of type {}", Eval::typeToString(bag->type()));
+  bag = this->evalIfExpression(node);
+  TRACE_INFO(this->logger, "Returning if of type {}",
+             Eval::typeToString(bag.type()));
 };
 
 void ASTEvaluator::dispatch(AST::WhileExpression &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating while expression");
-  bag = evalWhileExpression(node, env);
+  TRACE_INFO(this->logger, "Evaluating while expression");
+  bag = this->evalWhileExpression(node);
 };
 void ASTEvaluator::dispatch(AST::FunctionLiteral &node) {
-  bag = makeFunctionBag(env, node.getArguments(), node.getBody());
+  bag = makeFunctionBag(this->env, node.getArena(), node.getArguments(),
+                        &node);
 }
 void ASTEvaluator::dispatch(AST::HashLiteral &node) {
-  bag = evalHashLiteral(node, env);
+  if (auto constant = node.getConstant()) {
+    bag = *constant;
+    return;
+  }
+  bag = this->evalHashLiteral(node);
 }
 void ASTEvaluator::dispatch(AST::CallExpression &node) {
-  auto val = eval(*node.getFunction(), env);
+  auto val = this->evaluate(*node.getFunction(), this->env);
   if (isError(val)) {
     bag = val;
     return;
   }
-  bag = applyFunction(node, val, env);
+  bag = this->applyFunction(node, val);
 }
 void ASTEvaluator::dispatch(AST::ReturnStatement &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating return statement");
+  TRACE_INFO(this->logger, "Evaluating return statement");
   if (!node.getReturnValue()) {
-    bag = makeReturnBag(NULL_BAG);
+    bag = makeReturnBag(NULL_VALUE);
     return;
   }
-  auto ret = eval(*node.getReturnValue(), env);
+  auto ret =
+      this->evaluate(*node.getReturnValue(), this->env,
+                     this->mode == TailMode::NONE ? TailMode::NONE
+                                                  : TailMode::TAIL);
   if (isError(ret)) {
     bag = ret;
     return;
@@ -486,32 +371,36 @@ void ASTEvaluator::dispatch(AST::ReturnStatement &node) {
   bag = makeReturnBag(ret);
 };
 void ASTEvaluator::dispatch(AST::ExpressionStatement &node) {
-  spdlog::get(EVAL_LOGGER)
-      ->info("Evaluating expression statement {}", node.tokenLiteral());
-  bag = eval(*node.getExpression(), env);
+  TRACE_INFO(this->logger, "Evaluating expression statement {}",
+             node.tokenLiteral());
+  bag = this->evaluate(*node.getExpression(), this->env, this->mode);
 };
 void ASTEvaluator::dispatch(AST::LetStatement &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating let statement");
-  if (Builtin::contains(node.getName()->getValue())) {
-    bag = Builtin::get(node.getName()->getValue());
+  TRACE_INFO(this->logger, "Evaluating let statement");
+  if (auto builtin = Builtin::get(node.getName()->getSymbol())) {
+    bag = std::move(builtin);
     return;
   }
-  auto val = eval(*node.getValue(), env);
+  auto val = this->evaluate(*node.getValue(), this->env);
   if (isError(val)) {
     bag = val;
     return;
   }
 
-  spdlog::get(EVAL_LOGGER)
-      ->info("Setting let statement {} {}", node.getName()->getValue(),
-             val->inspect());
-  env->set(node.getName()->getValue(), val);
-  spdlog::get(EVAL_LOGGER)->info("Set let statement");
+  TRACE_INFO(this->logger, "Setting let statement {} {}",
+             node.getName()->getValue(), val.inspect());
+  auto name = node.getName();
+  if (name->isResolved()) {
+    this->env->slot(name->getSlot()) = val;
+  } else {
+    this->env->set(name->getSymbol(), val);
+  }
+  TRACE_INFO(this->logger, "Set let statement");
 
-  bag = NULL_BAG;
+  bag = NULL_VALUE;
 };
 void ASTEvaluator::dispatch(AST::BlockStatement &node) {
-  spdlog::get(EVAL_LOGGER)->info("Evaluating block expression");
-  auto statements = node.getStatements();
-  bag = evalBlockStatement(statements, env);
+  TRACE_INFO(this->logger, "Evaluating block expression");
+  const auto &statements = node.getStatements();
+  bag = this->evalBlockStatement(statements);
 };
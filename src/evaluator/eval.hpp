@@ -6,25 +6,45 @@
 #include "ast.hpp"
 #include "env.hpp"
 #include "output.hpp"
-#include "spdlog/sinks/null_sink.h"
+#include "trace.hpp"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 const std::string EVAL_LOGGER = "eval";
 
+// Where a node sits relative to the function body being evaluated. TAIL means
+// its value is the function's result, so a call there may be handed back to
+// applyFunction as a TailCallBag; RETURN_ONLY means only `return` statements
+// below it leave the function.
+enum class TailMode { NONE, RETURN_ONLY, TAIL };
+
 class ASTEvaluator : public AST::AbstractDispatcher {
  private:
-  explicit ASTEvaluator(std::shared_ptr<Env::Environment> env) : env(env) {
-    if (!spdlog::get(EVAL_LOGGER)) {
-      spdlog::create<spdlog::sinks::null_sink_st>(EVAL_LOGGER);
-    }
+  ASTEvaluator() : logger(Trace::logger(EVAL_LOGGER)) {
     if (!spdlog::get(EVAL_OUTPUT)) {
       auto output = spdlog::stdout_color_mt(EVAL_OUTPUT);
       output->set_pattern("%v");
       output->flush_on(spdlog::level::info);
     }
   };
-  std::shared_ptr<Eval::Bag> bag = nullptr;
+  // Looked up once per run; spdlog::get locks the registry.
+  std::shared_ptr<spdlog::logger> logger;
+  Eval::Value bag;
   std::shared_ptr<Env::Environment> env;
+  TailMode mode = TailMode::NONE;
+
+  // Visits `node` in `env` and hands back its result, restoring the caller's
+  // environment and mode afterwards.
+  Eval::Value evaluate(AST::Node &node, std::shared_ptr<Env::Environment> env,
+                       TailMode mode = TailMode::NONE);
+
+  Eval::Value evalIfExpression(AST::IfExpression &node);
+  Eval::Value evalWhileExpression(AST::WhileExpression &node);
+  Eval::Value evalHashLiteral(AST::HashLiteral &node);
+  Eval::Value evalProgram(const std::vector<AST::Statement *> &statements);
+  Eval::Value evalBlockStatement(AST::Span<AST::Statement *> statements);
+  Eval::Value callFunction(std::shared_ptr<Eval::FunctionBag> func,
+                           std::vector<Eval::Value> args);
+  Eval::Value applyFunction(AST::CallExpression &node, Eval::Value val);
 
  public:
   virtual void dispatch(AST::Node &node) override;
@@ -49,12 +69,9 @@ class ASTEvaluator : public AST::AbstractDispatcher {
   virtual void dispatch(AST::LetStatement &node) override;
   virtual void dispatch(AST::BlockStatement &node) override;
 
-  static std::shared_ptr<Eval::Bag> eval(
-      AST::Node &n, std::shared_ptr<Env::Environment> env) {
-    auto eval = new ASTEvaluator(env);
-    n.visit(*eval);
-    auto bag = eval->bag;
-    delete eval;
-    return (bag);
+  static Eval::Value eval(AST::Node &n,
+                          std::shared_ptr<Env::Environment> env) {
+    ASTEvaluator evaluator;
+    return evaluator.evaluate(n, env);
   }
 };
@@ -8,21 +8,21 @@ inline std::shared_ptr<Eval::ErrorBag> makeErrorWithMessage(
 }
 
 inline std::shared_ptr<Eval::ErrorBag> makeInfixTypeMismatchError(
-    Eval::Type leftType, Eval::Type rightType, std::string op) {
+    Eval::Type leftType, Eval::Type rightType, std::string_view op) {
   return makeErrorWithMessage(fmt::format("type mismatch: {} {} {}",
                                           Eval::typeToString(leftType), op,
                                           Eval::typeToString(rightType)));
 }
 
 inline std::shared_ptr<Eval::ErrorBag> makeInfixUnknownOperatorError(
-    Eval::Type leftType, Eval::Type rightType, std::string op) {
+    Eval::Type leftType, Eval::Type rightType, std::string_view op) {
   return makeErrorWithMessage(fmt::format("unknown operator: {} {} {}",
                                           Eval::typeToString(leftType), op,
                                           Eval::typeToString(rightType)));
 }
 
 inline std::shared_ptr<Eval::ErrorBag> makePrefixOperatorError(
-    Eval::Type leftType, std::string op) {
+    Eval::Type leftType, std::string_view op) {
   return makeErrorWithMessage(
       fmt::format("unknown operator: {}{}", op, Eval::typeToString(leftType)));
 }
@@ -33,6 +33,12 @@ inline std::shared_ptr<Eval::ErrorBag> makeIdentifierNotFoundError(
       fmt::format("identifier not found: {}", identifier));
 }
 
+inline std::shared_ptr<Eval::ErrorBag> makeFunctionBodyError(
+    std::string error) {
+  return makeErrorWithMessage(
+      fmt::format("syntax error in function body: {}", error));
+}
+
 inline std::shared_ptr<Eval::ErrorBag> makeNotAFunctionError(
     std::string identifier) {
   return makeErrorWithMessage(fmt::format("not a function: {}", identifier));
@@ -76,3 +82,10 @@ inline std::shared_ptr<Eval::ErrorBag> makeDivideByZeroError(int64_t numer,
   return makeErrorWithMessage(
       fmt::format("divide by zero exception: {}/{}", numer, denom));
 }
+
+inline std::shared_ptr<Eval::ErrorBag> makeWrongNumberOfArgumentsError(
+    int expected, int actual) {
+  return makeErrorWithMessage(
+      fmt::format("wrong number of arguments: expected {}, found {}",
+                  expected, actual));
+}
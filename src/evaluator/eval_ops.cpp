@@ -0,0 +1,157 @@
+#include "eval_ops.hpp"
+#include <eval_errors.hpp>
+
+std::shared_ptr<Eval::ReturnBag> makeReturnBag(Eval::Value value) {
+  return std::make_shared<Eval::ReturnBag>(std::move(value));
+}
+
+std::shared_ptr<Eval::StringBag> makeStringBag(std::string value) {
+  return std::make_shared<Eval::StringBag>(std::move(value));
+}
+
+std::shared_ptr<Eval::FunctionBag> makeFunctionBag(
+    std::shared_ptr<Env::Environment> env,
+    std::shared_ptr<const AST::Arena> arena,
+    AST::Span<AST::Identifier *> arguments, AST::FunctionLiteral *literal,
+    std::vector<Eval::Value> bound) {
+  return std::make_shared<Eval::FunctionBag>(env, std::move(arena), arguments,
+                                             literal, std::move(bound));
+}
+
+std::shared_ptr<Eval::ArrayBag> makeArrayBag(std::vector<Eval::Value> values) {
+  return std::make_shared<Eval::ArrayBag>(std::move(values));
+}
+
+Eval::Value evalBangOperator(const Eval::Value &right) {
+  switch (right.type()) {
+    case Eval::Type::BOOLEAN_OBJ:
+      return Eval::Value::fromBoolean(!right.boolean());
+    case Eval::Type::NULL_OBJ:
+      return TRUE_VALUE;
+    default:
+      return FALSE_VALUE;
+  };
+}
+
+Eval::Value evalNegateOperator(const Eval::Value &right) {
+  if (right.type() != Eval::Type::INTEGER_OBJ) {
+    return makePrefixOperatorError(right.type(), "-");
+  }
+  return Eval::Value::fromInteger(right.integer() * -1);
+}
+
+Eval::Value evalIntegerInfixExpression(std::string_view op, int64_t left,
+                                       int64_t right) {
+  if (op == "+") {
+    return Eval::Value::fromInteger(left + right);
+  } else if (op == "-") {
+    return Eval::Value::fromInteger(left - right);
+  } else if (op == "*") {
+    return Eval::Value::fromInteger(left * right);
+  } else if (op == "/") {
+    if (right == 0) {
+      return makeDivideByZeroError(left, right);
+    }
+    return Eval::Value::fromInteger(left / right);
+  } else if (op == "<") {
+    return Eval::Value::fromBoolean(left < right);
+  } else if (op == ">") {
+    return Eval::Value::fromBoolean(left > right);
+  } else if (op == "==") {
+    return Eval::Value::fromBoolean(left == right);
+  } else if (op == "!=") {
+    return Eval::Value::fromBoolean(left != right);
+  }
+  return makeInfixUnknownOperatorError(Eval::Type::INTEGER_OBJ,
+                                       Eval::Type::INTEGER_OBJ, op);
+}
+
+Eval::Value evalBooleanInfixExpression(std::string_view op, bool left,
+                                       bool right) {
+  if (op == "==") {
+    return Eval::Value::fromBoolean(left == right);
+  } else if (op == "!=") {
+    return Eval::Value::fromBoolean(left != right);
+  }
+  return makeInfixUnknownOperatorError(Eval::Type::BOOLEAN_OBJ,
+                                       Eval::Type::BOOLEAN_OBJ, op);
+}
+
+Eval::Value evalStringInfixExpression(std::string_view op,
+                                      std::shared_ptr<Eval::StringBag> left,
+                                      std::shared_ptr<Eval::StringBag> right) {
+  if (op == "+") {
+    return makeStringBag(left->value() + right->value());
+  } else if (op == "==") {
+    return Eval::Value::fromBoolean(left->value() == right->value());
+  } else if (op == "!=") {
+    return Eval::Value::fromBoolean(left->value() != right->value());
+  }
+  return makeInfixUnknownOperatorError(left->type(), right->type(), op);
+}
+
+Eval::Value evalArrayIndexExpression(std::shared_ptr<Eval::ArrayBag> left,
+                                     int64_t index) {
+  if (index > left->values().size() - 1) {
+    return NULL_VALUE;
+  }
+  return left->values().at(index);
+}
+
+Eval::Value evalHashIndexExpression(std::shared_ptr<Eval::HashBag> left,
+                                    const Eval::Value &index) {
+  auto hash = index.hash();
+  if (!hash) {
+    return makeInvalidHashKeyType(index.type());
+  }
+  auto pair = left->find(*hash, index);
+  if (!pair) {
+    return NULL_VALUE;
+  }
+  return pair->value();
+}
+
+Eval::Value evalIndexExpression(const Eval::Value &left,
+                                const Eval::Value &index) {
+  if (left.type() == Eval::Type::ARRAY_OBJ &&
+      index.type() == Eval::Type::INTEGER_OBJ) {
+    return evalArrayIndexExpression(convertToArray(left), index.integer());
+  }
+  if (left.type() == Eval::Type::HASH_OBJ) {
+    return evalHashIndexExpression(convertToHash(left), index);
+  }
+  return makeInvalidIndexException(left.type(), index.type());
+}
+
+Eval::Value evalInfixExpression(std::string_view op, const Eval::Value &left,
+                                const Eval::Value &right) {
+  switch (left.type()) {
+    case Eval::Type::INTEGER_OBJ: {
+      if (right.type() == Eval::Type::INTEGER_OBJ) {
+        return evalIntegerInfixExpression(op, left.integer(), right.integer());
+      }
+      break;
+    }
+    case Eval::Type::BOOLEAN_OBJ: {
+      if (right.type() == Eval::Type::BOOLEAN_OBJ) {
+        return evalBooleanInfixExpression(op, left.boolean(), right.boolean());
+      }
+      break;
+    }
+    case Eval::Type::STRING_OBJ: {
+      if (right.type() == Eval::Type::STRING_OBJ) {
+        return evalStringInfixExpression(op, convertToString(left),
+                                         convertToString(right));
+      }
+      break;
+    }
+    default:
+      // continue..
+      break;
+  }
+  if (left.type() != right.type()) {
+    return makeInfixTypeMismatchError(left.type(), right.type(), op);
+  } else {
+    return makeInfixUnknownOperatorError(left.type(), right.type(), op);
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <bag.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+
+  Bag operations shared by the tree-walking evaluator and the VM
+
+*/
+using Eval::FALSE_VALUE;
+using Eval::NULL_VALUE;
+using Eval::TRUE_VALUE;
+
+std::shared_ptr<Eval::ReturnBag> makeReturnBag(Eval::Value value);
+
+std::shared_ptr<Eval::StringBag> makeStringBag(std::string value);
+
+std::shared_ptr<Eval::FunctionBag> makeFunctionBag(
+    std::shared_ptr<Env::Environment> env,
+    std::shared_ptr<const AST::Arena> arena,
+    AST::Span<AST::Identifier *> arguments, AST::FunctionLiteral *literal,
+    std::vector<Eval::Value> bound = {});
+
+std::shared_ptr<Eval::ArrayBag> makeArrayBag(std::vector<Eval::Value> values);
+
+inline bool isError(const Eval::Value &value) {
+  return value.type() == Eval::Type::ERROR_OBJ;
+}
+
+inline bool isTruthy(const Eval::Value &value) {
+  switch (value.type()) {
+    case Eval::Type::BOOLEAN_OBJ:
+      return value.boolean();
+    case Eval::Type::NULL_OBJ:
+      return false;
+    default:
+      return true;
+  }
+}
+
+Eval::Value evalBangOperator(const Eval::Value &right);
+
+Eval::Value evalNegateOperator(const Eval::Value &right);
+
+Eval::Value evalInfixExpression(std::string_view op, const Eval::Value &left,
+                                const Eval::Value &right);
+
+Eval::Value evalIndexExpression(const Eval::Value &left,
+                                const Eval::Value &index);
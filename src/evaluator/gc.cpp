@@ -0,0 +1,70 @@
+#include "gc.hpp"
+#include <limits>
+#include <vector>
+using namespace GC;
+
+namespace GC {
+class ReferenceCounter : public Tracer {
+ public:
+  virtual void visit(const Object *object) override {
+    const_cast<Object *>(object)->_refs--;
+  }
+};
+
+class Marker : public Tracer {
+ public:
+  std::vector<const Object *> pending;
+  virtual void visit(const Object *object) override {
+    auto tracked = const_cast<Object *>(object);
+    if (!tracked->_reached) {
+      tracked->_reached = true;
+      this->pending.push_back(tracked);
+    }
+  }
+};
+}  // namespace GC
+
+std::size_t Heap::collect() {
+  // Objects that aren't owned by a shared_ptr can't be part of a cycle, they
+  // are always roots.
+  for (auto object = _head; object; object = object->_next) {
+    auto owners = object->weak_from_this().use_count();
+    object->_refs =
+        owners > 0 ? owners : std::numeric_limits<std::ptrdiff_t>::max();
+    object->_reached = false;
+  }
+  ReferenceCounter counter;
+  for (auto object = _head; object; object = object->_next) {
+    object->trace(counter);
+  }
+
+  Marker marker;
+  for (auto object = _head; object; object = object->_next) {
+    if (object->_refs > 0) {
+      marker.visit(object);
+    }
+  }
+  while (!marker.pending.empty()) {
+    auto object = marker.pending.back();
+    marker.pending.pop_back();
+    object->trace(marker);
+  }
+
+  // Hold on to the garbage while clearing it so no object is freed before
+  // its own references are dropped.
+  std::vector<std::shared_ptr<Object>> garbage;
+  for (auto object = _head; object; object = object->_next) {
+    if (!object->_reached) {
+      garbage.push_back(object->shared_from_this());
+    }
+  }
+  for (const auto &object : garbage) {
+    object->clear();
+  }
+  auto swept = garbage.size();
+  garbage.clear();
+
+  _allocated = 0;
+  _threshold = _live;
+  return swept;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace GC {
+class Object;
+
+// Handed each tracked object that another one references, see Object::trace.
+class Tracer {
+ public:
+  virtual void visit(const Object *object) = 0;
+};
+
+/*
+
+  Heap
+
+  Bags and environments still own each other through shared_ptr, which leaves
+  every function stored in the environment it closes over in a cycle that
+  reference counting never frees. Each Object links itself into the heap so
+  collect() can find those cycles.
+
+  collect() is a mark-sweep over the tracked objects. Its roots are the
+  objects referenced from outside the heap: the environments a REPL or test
+  holds on to, and the values on the evaluator's native stack or the VM's
+  value stack. They are found by subtracting the references the heap holds
+  on each object from its use count, so only objects kept alive by nothing
+  but each other are swept. Sweeping clears their references and the cycle
+  falls apart.
+
+*/
+class Heap {
+  friend class Object;
+
+ private:
+  static inline Object *_head = nullptr;
+  static inline std::size_t _live = 0;
+  static inline std::size_t _allocated = 0;
+  static inline std::size_t _threshold = 0;
+
+ public:
+  static constexpr std::size_t MIN_THRESHOLD = 1 << 16;
+
+  // Tracked objects currently alive.
+  static std::size_t live() { return _live; }
+  // Frees every object that is only kept alive by a cycle and returns how
+  // many were swept.
+  static std::size_t collect();
+  // Collects once the heap has grown enough since the last collection to be
+  // worth a full pass. Callers must not hold tracked objects through raw
+  // pointers alone.
+  static void collectIfNeeded() {
+    if (_allocated >= std::max(_threshold, MIN_THRESHOLD)) {
+      collect();
+    }
+  }
+};
+
+class Object : public std::enable_shared_from_this<Object> {
+  friend class Heap;
+  friend class ReferenceCounter;
+  friend class Marker;
+
+ private:
+  Object *_prev = nullptr;
+  Object *_next = nullptr;
+  std::ptrdiff_t _refs = 0;
+  bool _reached = false;
+
+ public:
+  Object() : _next(Heap::_head) {
+    if (_next) {
+      _next->_prev = this;
+    }
+    Heap::_head = this;
+    Heap::_live++;
+    Heap::_allocated++;
+  }
+  Object(const Object &) : Object() {}
+  Object &operator=(const Object &) { return *this; }
+  virtual ~Object() {
+    if (_prev) {
+      _prev->_next = _next;
+    } else {
+      Heap::_head = _next;
+    }
+    if (_next) {
+      _next->_prev = _prev;
+    }
+    Heap::_live--;
+  }
+
+  // Reports every tracked object this one holds a reference to.
+  virtual void trace(Tracer &) const {}
+  // Drops the references reported by trace.
+  virtual void clear() {}
+};
+}  // namespace GC
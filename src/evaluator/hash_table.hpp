@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Eval {
+/*
+
+  Hash table
+
+  Open addressing in the style of a Swiss table. Every slot has a control
+  byte holding the low 7 bits of its hash, or EMPTY. Lookups scan a group of
+  16 control bytes at once, with SSE2 where it's available, and only compare
+  keys in slots whose control byte matched. Groups are probed triangularly,
+  which visits each of them once because the group count is a power of two.
+
+  The table stores each entry's full hash next to it and leaves key
+  equality to the caller, so colliding hashes never merge two keys. Entries
+  are never removed, hence no tombstones.
+
+*/
+template <class Entry>
+class HashTable {
+ private:
+  static constexpr std::size_t GROUP_WIDTH = 16;
+  static constexpr std::int8_t EMPTY = -128;
+
+  struct Slot {
+    std::uint64_t hash;
+    Entry entry;
+  };
+
+  std::vector<std::int8_t> _control;
+  std::vector<Slot> _slots;
+  std::size_t _size = 0;
+
+  static std::int8_t control(std::uint64_t hash) { return hash & 0x7F; }
+
+  // Bit i is set when control byte i of the group equals `value`.
+  static std::uint32_t match(const std::int8_t *group, std::int8_t value) {
+#if defined(__SSE2__)
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value)));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_WIDTH; i++) {
+      mask |= static_cast<std::uint32_t>(group[i] == value) << i;
+    }
+    return mask;
+#endif
+  }
+
+  static int lowestBit(std::uint32_t mask) { return __builtin_ctz(mask); }
+
+  // Visits candidate slots for `hash` until `visit` returns true or a group
+  // with an empty slot ends the probe. Returns that empty slot's index, or
+  // the index of the slot `visit` stopped at.
+  template <class Visit>
+  std::size_t probe(std::uint64_t hash, Visit visit) const {
+    auto groupMask = this->_control.size() / GROUP_WIDTH - 1;
+    auto group = (hash >> 7) & groupMask;
+    for (std::size_t step = 1;; step++) {
+      auto base = group * GROUP_WIDTH;
+      const auto *controls = this->_control.data() + base;
+      for (auto candidates = match(controls, control(hash)); candidates;
+           candidates &= candidates - 1) {
+        auto index = base + lowestBit(candidates);
+        if (this->_slots[index].hash == hash && visit(this->_slots[index])) {
+          return index;
+        }
+      }
+      auto empty = match(controls, EMPTY);
+      if (empty) {
+        return base + lowestBit(empty);
+      }
+      group = (group + step) & groupMask;
+    }
+  }
+
+  void place(std::uint64_t hash, Entry entry, std::size_t index) {
+    this->_control[index] = control(hash);
+    this->_slots[index].hash = hash;
+    this->_slots[index].entry = std::move(entry);
+    this->_size++;
+  }
+
+  void grow() {
+    auto capacity = std::max(GROUP_WIDTH, this->_control.size() * 2);
+    auto oldControl = std::move(this->_control);
+    auto oldSlots = std::move(this->_slots);
+    this->_control.assign(capacity, EMPTY);
+    this->_slots.resize(capacity);
+    this->_size = 0;
+    for (std::size_t i = 0; i < oldControl.size(); i++) {
+      if (oldControl[i] != EMPTY) {
+        auto &slot = oldSlots[i];
+        auto index = this->probe(slot.hash, [](const Slot &) {
+          return false;
+        });
+        this->place(slot.hash, std::move(slot.entry), index);
+      }
+    }
+  }
+
+ public:
+  class const_iterator {
+   private:
+    const HashTable *_table;
+    std::size_t _index;
+
+    void skipEmpty() {
+      while (_index < _table->_control.size() &&
+             _table->_control[_index] == EMPTY) {
+        _index++;
+      }
+    }
+
+   public:
+    const_iterator(const HashTable *table, std::size_t index)
+        : _table(table), _index(index) {
+      this->skipEmpty();
+    }
+    const Entry &operator*() const { return _table->_slots[_index].entry; }
+    const Entry *operator->() const { return &_table->_slots[_index].entry; }
+    const_iterator &operator++() {
+      _index++;
+      this->skipEmpty();
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return _index == other._index;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return _index != other._index;
+    }
+  };
+
+  std::size_t size() const { return this->_size; }
+  bool empty() const { return this->_size == 0; }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const {
+    return const_iterator(this, this->_control.size());
+  }
+
+  void reserve(std::size_t entries) {
+    while (entries > this->_control.size() * 7 / 8) {
+      this->grow();
+    }
+  }
+
+  // The entry with `hash` for which `equal` holds, or nullptr.
+  template <class Equal>
+  const Entry *find(std::uint64_t hash, Equal equal) const {
+    if (this->_size == 0) {
+      return nullptr;
+    }
+    auto index = this->probe(hash, [&](const Slot &slot) {
+      return equal(slot.entry);
+    });
+    if (this->_control[index] == EMPTY) {
+      return nullptr;
+    }
+    return &this->_slots[index].entry;
+  }
+
+  // Adds `entry` unless an entry equal to it is already present, in which
+  // case the existing one is kept and false is returned.
+  template <class Equal>
+  bool insert(std::uint64_t hash, Entry entry, Equal equal) {
+    this->reserve(this->_size + 1);
+    auto index = this->probe(hash, [&](const Slot &slot) {
+      return equal(slot.entry);
+    });
+    if (this->_control[index] != EMPTY) {
+      return false;
+    }
+    this->place(hash, std::move(entry), index);
+    return true;
+  }
+
+  void clear() {
+    this->_control.clear();
+    this->_slots.clear();
+    this->_size = 0;
+  }
+};
+}  // namespace Eval
@@ -0,0 +1,216 @@
+#pragma once
+#include <cstddef>
+#include <gc.hpp>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace Eval {
+/*
+
+  Persistent vector
+
+  An immutable vector that shares structure between versions: a 32-way trie
+  of full leaves plus a tail buffer for the last, partly filled, leaf.
+  push_back copies at most one path through the trie, drop_front only moves
+  the offset of the first element, and indexing walks log32(n) levels.
+
+  The tail is appended to in place as long as no other version has already
+  grown past this one's end, so building a vector one element at a time
+  doesn't copy the tail either. Nodes are tracked by the collector, which
+  keeps the reference counts it sees exact when versions share them.
+
+*/
+template <class T>
+class VectorNode : public GC::Object {
+ public:
+  std::vector<std::shared_ptr<VectorNode>> children;
+  std::vector<T> values;
+
+  virtual void trace(GC::Tracer &tracer) const override {
+    for (const auto &child : children) {
+      tracer.visit(child.get());
+    }
+    for (const auto &value : values) {
+      value.trace(tracer);
+    }
+  }
+  virtual void clear() override {
+    children.clear();
+    values.clear();
+  }
+};
+
+template <class T>
+class PersistentVector {
+ private:
+  using Node = VectorNode<T>;
+  static constexpr std::size_t BITS = 5;
+  static constexpr std::size_t WIDTH = 1 << BITS;
+  static constexpr std::size_t MASK = WIDTH - 1;
+
+  std::shared_ptr<Node> _root;
+  std::shared_ptr<Node> _tail;
+  // Elements stored, including the ones dropped from the front.
+  std::size_t _count = 0;
+  std::size_t _offset = 0;
+  std::size_t _shift = BITS;
+
+  std::size_t tailOffset() const {
+    return _count < WIDTH ? 0 : ((_count - 1) >> BITS) << BITS;
+  }
+
+  const T &lookup(std::size_t index) const {
+    auto tailOffset = this->tailOffset();
+    if (index >= tailOffset) {
+      return _tail->values[index - tailOffset];
+    }
+    const Node *node = _root.get();
+    for (auto level = _shift; level > 0; level -= BITS) {
+      node = node->children[(index >> level) & MASK].get();
+    }
+    return node->values[index & MASK];
+  }
+
+  static std::shared_ptr<Node> newPath(std::size_t level,
+                                       std::shared_ptr<Node> leaf) {
+    if (level == 0) {
+      return leaf;
+    }
+    auto node = std::make_shared<Node>();
+    node->children.push_back(newPath(level - BITS, std::move(leaf)));
+    return node;
+  }
+
+  std::shared_ptr<Node> pushTail(std::size_t level, const Node *parent,
+                                 std::shared_ptr<Node> leaf) const {
+    auto node = parent ? std::make_shared<Node>(*parent)
+                       : std::make_shared<Node>();
+    auto index = ((_count - 1) >> level) & MASK;
+    std::shared_ptr<Node> child;
+    if (level == BITS) {
+      child = std::move(leaf);
+    } else if (index < node->children.size()) {
+      child = pushTail(level - BITS, node->children[index].get(),
+                       std::move(leaf));
+    } else {
+      child = newPath(level - BITS, std::move(leaf));
+    }
+    if (index < node->children.size()) {
+      node->children[index] = std::move(child);
+    } else {
+      node->children.push_back(std::move(child));
+    }
+    return node;
+  }
+
+ public:
+  class const_iterator {
+   private:
+    const PersistentVector *_vector;
+    std::size_t _index;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const_iterator(const PersistentVector *vector, std::size_t index)
+        : _vector(vector), _index(index) {}
+    reference operator*() const { return (*_vector)[_index]; }
+    pointer operator->() const { return &(*_vector)[_index]; }
+    const_iterator &operator++() {
+      _index++;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto previous = *this;
+      _index++;
+      return previous;
+    }
+    bool operator==(const const_iterator &other) const {
+      return _index == other._index && _vector == other._vector;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return !(*this == other);
+    }
+  };
+
+  PersistentVector() = default;
+  explicit PersistentVector(std::vector<T> values) {
+    for (auto &value : values) {
+      *this = this->push_back(std::move(value));
+    }
+  }
+
+  std::size_t size() const { return _count - _offset; }
+  bool empty() const { return _count == _offset; }
+  const T &operator[](std::size_t index) const {
+    return this->lookup(index + _offset);
+  }
+  const T &at(std::size_t index) const {
+    if (index >= this->size()) {
+      throw std::out_of_range("PersistentVector::at");
+    }
+    return (*this)[index];
+  }
+  const T &front() const { return (*this)[0]; }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, this->size()); }
+
+  // A copy with `value` appended.
+  PersistentVector push_back(T value) const {
+    auto result = *this;
+    auto tailSize = _count - this->tailOffset();
+    if (_tail && tailSize < WIDTH) {
+      if (_tail->values.size() != tailSize) {
+        // Another version already appended here, so this one branches off.
+        result._tail = std::make_shared<Node>();
+        result._tail->values.reserve(WIDTH);
+        result._tail->values.assign(_tail->values.begin(),
+                                    _tail->values.begin() + tailSize);
+      }
+    } else {
+      if (_tail) {
+        if ((_count >> BITS) > (std::size_t(1) << _shift)) {
+          result._root = std::make_shared<Node>();
+          result._root->children.push_back(_root);
+          result._root->children.push_back(newPath(_shift, _tail));
+          result._shift += BITS;
+        } else {
+          result._root = this->pushTail(_shift, _root.get(), _tail);
+        }
+      }
+      result._tail = std::make_shared<Node>();
+      result._tail->values.reserve(WIDTH);
+    }
+    result._tail->values.push_back(std::move(value));
+    result._count++;
+    return result;
+  }
+
+  // A copy without its first `count` elements. The dropped elements stay in
+  // the shared nodes until every version using them is gone.
+  PersistentVector drop_front(std::size_t count = 1) const {
+    if (count >= this->size()) {
+      return PersistentVector();
+    }
+    auto result = *this;
+    result._offset += count;
+    return result;
+  }
+
+  void trace(GC::Tracer &tracer) const {
+    if (_root) {
+      tracer.visit(_root.get());
+    }
+    if (_tail) {
+      tracer.visit(_tail.get());
+    }
+  }
+  void clear() { *this = PersistentVector(); }
+};
+}  // namespace Eval
@@ -0,0 +1,168 @@
+#include "resolver.hpp"
+#include "builtin.hpp"
+
+void Resolver::declare(Intern::Symbol name) {
+  // `let` of a builtin name never binds anything.
+  if (Builtin::contains(name)) {
+    return;
+  }
+  auto &scope = this->scopes.back();
+  if (scope.slots.find(name) == scope.slots.end()) {
+    scope.slots[name] = scope.names.size();
+    scope.names.push_back(name);
+  }
+}
+
+const std::shared_ptr<const AST::Scopes> &Resolver::enclosingScopes() {
+  if (!this->enclosing) {
+    auto scopes = std::make_shared<AST::Scopes>();
+    scopes->reserve(this->scopes.size());
+    for (const auto &scope : this->scopes) {
+      scopes->push_back(scope.names);
+    }
+    this->enclosing = std::move(scopes);
+  }
+  return this->enclosing;
+}
+
+bool Resolver::resolveDeferred(AST::FunctionLiteral &node) {
+  auto enclosing = node.getEnclosingScopes();
+  if (!enclosing) {
+    return false;
+  }
+  node.setEnclosingScopes(nullptr);
+  node.getBody();
+  Resolver resolver;
+  for (const auto &names : *enclosing) {
+    auto &scope = resolver.scopes.emplace_back();
+    for (const auto &name : names) {
+      scope.slots[name] = scope.names.size();
+      scope.names.push_back(name);
+    }
+  }
+  node.visit(resolver);
+  return true;
+}
+
+void Resolver::dispatch(AST::Node &) {}
+void Resolver::dispatch(AST::Statement &) {}
+void Resolver::dispatch(AST::Expression &) {}
+
+void Resolver::dispatch(AST::Program &node) {
+  for (const auto &statement : node.getStatements()) {
+    this->visit(statement);
+  }
+}
+
+void Resolver::dispatch(AST::Identifier &node) {
+  if (this->declaring) {
+    return;
+  }
+  for (auto scope = this->scopes.rbegin(); scope != this->scopes.rend();
+       ++scope) {
+    auto slot = scope->slots.find(node.getSymbol());
+    if (slot != scope->slots.end()) {
+      node.resolve(scope - this->scopes.rbegin(), slot->second);
+      return;
+    }
+  }
+}
+
+void Resolver::dispatch(AST::Boolean &) {}
+void Resolver::dispatch(AST::IntegerLiteral &) {}
+void Resolver::dispatch(AST::StringLiteral &) {}
+
+void Resolver::dispatch(AST::ArrayLiteral &node) {
+  for (const auto &value : node.getValues()) {
+    this->visit(value);
+  }
+}
+
+void Resolver::dispatch(AST::HashLiteral &node) {
+  for (const auto &pair : node.getPairs()) {
+    this->visit(pair.first);
+    this->visit(pair.second);
+  }
+}
+
+void Resolver::dispatch(AST::IndexExpression &node) {
+  this->visit(node.getLeft());
+  this->visit(node.getIndex());
+}
+
+void Resolver::dispatch(AST::PrefixExpression &node) {
+  this->visit(node.getRight());
+}
+
+void Resolver::dispatch(AST::InfixExpression &node) {
+  this->visit(node.getLeft());
+  this->visit(node.getRight());
+}
+
+void Resolver::dispatch(AST::IfExpression &node) {
+  this->visit(node.getCondition());
+  this->visit(node.getWhenTrue());
+  this->visit(node.getWhenFalse());
+}
+
+void Resolver::dispatch(AST::WhileExpression &node) {
+  this->visit(node.getBody());
+}
+
+void Resolver::dispatch(AST::FunctionLiteral &node) {
+  if (this->declaring) {
+    return;
+  }
+  if (node.isDeferred()) {
+    node.setEnclosingScopes(this->enclosingScopes());
+    return;
+  }
+  this->enclosing.reset();
+  this->scopes.emplace_back();
+  for (const auto &argument : node.getArguments()) {
+    auto &scope = this->scopes.back();
+    scope.slots[argument->getSymbol()] = scope.names.size();
+    scope.names.push_back(argument->getSymbol());
+  }
+  this->declaring = true;
+  this->visit(node.getBody());
+  this->declaring = false;
+
+  for (const auto &argument : node.getArguments()) {
+    this->visit(argument);
+  }
+  this->visit(node.getBody());
+  node.setLocals(std::make_shared<const std::vector<Intern::Symbol>>(
+      std::move(this->scopes.back().names)));
+  this->scopes.pop_back();
+  this->enclosing.reset();
+}
+
+void Resolver::dispatch(AST::CallExpression &node) {
+  this->visit(node.getFunction());
+  for (const auto &argument : node.getArguments()) {
+    this->visit(argument);
+  }
+}
+
+void Resolver::dispatch(AST::ReturnStatement &node) {
+  this->visit(node.getReturnValue());
+}
+
+void Resolver::dispatch(AST::ExpressionStatement &node) {
+  this->visit(node.getExpression());
+}
+
+void Resolver::dispatch(AST::LetStatement &node) {
+  if (this->declaring && !this->scopes.empty()) {
+    this->declare(node.getName()->getSymbol());
+  }
+  this->visit(node.getValue());
+  this->visit(node.getName());
+}
+
+void Resolver::dispatch(AST::BlockStatement &node) {
+  for (const auto &statement : node.getStatements()) {
+    this->visit(statement);
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <ast.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Annotates identifiers with their lexical address so the evaluator can read
+// function-scope bindings from slots instead of searching maps by name.
+//
+// Every function literal is one scope: its arguments take the first slots and
+// each name bound with `let` anywhere in its body (blocks do not open scopes)
+// gets the next one. Identifiers that are not found in an enclosing function
+// scope are left unresolved and looked up by name among the globals and the
+// builtins.
+//
+// A literal whose body the parser deferred can't be resolved yet. It keeps
+// the names of the scopes it was found in instead, and resolveDeferred picks
+// up from there once the body is parsed.
+class Resolver : public AST::AbstractDispatcher {
+ private:
+  struct Scope {
+    std::map<Intern::Symbol, std::size_t> slots;
+    std::vector<Intern::Symbol> names;
+  };
+
+  std::vector<Scope> scopes;
+  // While true the visit only collects the `let` names of the current function
+  // body so that later bindings are visible to earlier closures.
+  bool declaring = false;
+  // What deferred literals are handed, shared until the scopes change.
+  std::shared_ptr<const AST::Scopes> enclosing;
+
+  const std::shared_ptr<const AST::Scopes> &enclosingScopes();
+
+  void declare(Intern::Symbol name);
+  void visit(AST::Node *node) {
+    if (node) {
+      node->visit(*this);
+    }
+  }
+
+ public:
+  virtual void dispatch(AST::Node &node) override;
+  virtual void dispatch(AST::Statement &node) override;
+  virtual void dispatch(AST::Expression &node) override;
+  virtual void dispatch(AST::Program &node) override;
+  virtual void dispatch(AST::Identifier &node) override;
+  virtual void dispatch(AST::Boolean &node) override;
+  virtual void dispatch(AST::HashLiteral &node) override;
+  virtual void dispatch(AST::StringLiteral &node) override;
+  virtual void dispatch(AST::ArrayLiteral &node) override;
+  virtual void dispatch(AST::IntegerLiteral &node) override;
+  virtual void dispatch(AST::IndexExpression &node) override;
+  virtual void dispatch(AST::PrefixExpression &node) override;
+  virtual void dispatch(AST::InfixExpression &node) override;
+  virtual void dispatch(AST::IfExpression &node) override;
+  virtual void dispatch(AST::WhileExpression &node) override;
+  virtual void dispatch(AST::FunctionLiteral &node) override;
+  virtual void dispatch(AST::CallExpression &node) override;
+  virtual void dispatch(AST::ReturnStatement &node) override;
+  virtual void dispatch(AST::ExpressionStatement &node) override;
+  virtual void dispatch(AST::LetStatement &node) override;
+  virtual void dispatch(AST::BlockStatement &node) override;
+
+  static void resolve(AST::Node &node) {
+    Resolver resolver;
+    node.visit(resolver);
+  }
+  // Parses and resolves the body of a literal that was deferred when it was
+  // resolved, returning false for any other literal.
+  static bool resolveDeferred(AST::FunctionLiteral &node);
+};
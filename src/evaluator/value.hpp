@@ -0,0 +1,197 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <cstdint>
+#include <gc.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace Eval {
+/*
+
+  Bag types
+
+*/
+enum class Type {
+  BASE_OBJ,
+  // basic
+  INTEGER_OBJ,
+  STRING_OBJ,
+  BOOLEAN_OBJ,
+  NULL_OBJ,
+  HASH_OBJ,
+  ERROR_OBJ,
+  // complex
+  FUNC_OBJ,
+  RETURN_OBJ,
+  BUILTIN_OBJ,
+  ARRAY_OBJ,
+  COMPILED_FUNC_OBJ,
+  CLOSURE_OBJ,
+  TAIL_CALL_OBJ,
+};
+
+
+class HashKey {
+ private:
+  Type type;
+  uint64_t value;
+
+ public:
+  HashKey(Type type, uint64_t value) : type(type), value(value) {}
+  bool operator==(HashKey& other) const {
+    return (other.type == type && other.value == value);
+  }
+  bool operator<(const HashKey& other) const {
+    if (other.type == type) {
+      return other.value < value;
+    }
+    return other.type < type;
+  }
+  // Spreads type and value over all 64 bits. HashTable probes with the high
+  // bits and keeps the low ones as a control byte.
+  uint64_t mix() const {
+    auto h = value + static_cast<uint64_t>(type) * 0x9E3779B97F4A7C15;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCD;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53;
+    h ^= h >> 33;
+    return h;
+  }
+};
+
+inline std::string typeToString(Type type) {
+  switch (type) {
+    case Type::BASE_OBJ:
+      return "BASE";
+    case Type::INTEGER_OBJ:
+      return "INTEGER";
+    case Type::STRING_OBJ:
+      return "STRING";
+    case Type::BOOLEAN_OBJ:
+      return "BOOLEAN";
+    case Type::NULL_OBJ:
+      return "NULL";
+    case Type::RETURN_OBJ:
+      return "RETURN";
+    case Type::HASH_OBJ:
+      return "HASH";
+    case Type::ERROR_OBJ:
+      return "ERROR";
+    case Type::FUNC_OBJ:
+      return "FUNCTION";
+    case Type::BUILTIN_OBJ:
+      return "BUILTIN";
+    case Type::ARRAY_OBJ:
+      return "ARRAY";
+    case Type::COMPILED_FUNC_OBJ:
+      return "COMPILED_FUNCTION";
+    case Type::CLOSURE_OBJ:
+      return "FUNCTION";
+    case Type::TAIL_CALL_OBJ:
+      return "TAIL_CALL";
+  }
+}
+
+/*
+
+  Base bag
+
+*/
+class Bag : public GC::Object {
+ public:
+  virtual std::string inspect() const = 0;
+  virtual Type type() const = 0;
+  // The key this bag is stored under in a hash, or nullopt when it can't be
+  // used as one.
+  virtual std::optional<HashKey> hash() const { return std::nullopt; };
+};
+
+/*
+
+  Values
+
+*/
+// Integers, booleans and null are stored inline with their tag; everything
+// else is a heap Bag. A default constructed Value is empty, which is how
+// environments and the VM mark a binding that hasn't been set.
+class Value {
+ private:
+  Type _type;
+  int64_t _immediate;
+  std::shared_ptr<Bag> _bag;
+
+  Value(Type type, int64_t immediate) : _type(type), _immediate(immediate) {}
+
+ public:
+  Value() : _type(Type::BASE_OBJ), _immediate(0) {}
+  template <class T>
+  Value(std::shared_ptr<T> bag)
+      : _type(bag ? bag->type() : Type::BASE_OBJ),
+        _immediate(0),
+        _bag(std::move(bag)) {}
+  Value(const Value& other) = default;
+  Value(Value&& other) noexcept
+      : _type(other._type),
+        _immediate(other._immediate),
+        _bag(std::move(other._bag)) {
+    other._type = Type::BASE_OBJ;
+  }
+  Value& operator=(const Value& other) = default;
+  Value& operator=(Value&& other) noexcept {
+    _type = other._type;
+    _immediate = other._immediate;
+    _bag = std::move(other._bag);
+    other._type = Type::BASE_OBJ;
+    return *this;
+  }
+
+  static Value fromInteger(int64_t value) {
+    return Value(Type::INTEGER_OBJ, value);
+  }
+  static Value fromBoolean(bool value) {
+    return Value(Type::BOOLEAN_OBJ, value ? 1 : 0);
+  }
+  static Value null() { return Value(Type::NULL_OBJ, 0); }
+
+  explicit operator bool() const { return _type != Type::BASE_OBJ; }
+  Type type() const { return _type; }
+  bool isHeap() const { return static_cast<bool>(_bag); }
+  int64_t integer() const { return _immediate; }
+  bool boolean() const { return _immediate != 0; }
+  const std::shared_ptr<Bag>& bag() const { return _bag; }
+  void trace(GC::Tracer& tracer) const {
+    if (_bag) {
+      tracer.visit(_bag.get());
+    }
+  }
+
+  std::string inspect() const {
+    switch (_type) {
+      case Type::INTEGER_OBJ:
+        return fmt::format("{}", _immediate);
+      case Type::BOOLEAN_OBJ:
+        return boolean() ? "true" : "false";
+      case Type::NULL_OBJ:
+        return "null";
+      case Type::BASE_OBJ:
+        return "";
+      default:
+        return _bag->inspect();
+    }
+  }
+  std::optional<HashKey> hash() const {
+    switch (_type) {
+      case Type::INTEGER_OBJ:
+      case Type::BOOLEAN_OBJ:
+        return HashKey(_type, _immediate);
+      case Type::NULL_OBJ:
+      case Type::BASE_OBJ:
+        return std::nullopt;
+      default:
+        return _bag->hash();
+    }
+  }
+};
+}  // namespace Eval
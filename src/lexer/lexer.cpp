@@ -1,22 +1,23 @@
 #include "lexer.hpp"
-#include "spdlog/sinks/null_sink.h"
 
 #include <spdlog/spdlog.h>
 #include <catch2/catch.hpp>
-#include <cctype>
-#include <functional>
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 
-Lexer::Lexer(const std::string& input)
-    : input(std::move(input)),
-      position(0),
-      readPosition(0),
-      currentLine(1),
+Lexer::Lexer(std::string input)
+    : Lexer(SourceText::fromString(std::move(input))) {}
+
+Lexer::Lexer(Source source) : Lexer(source, 0, source->text().size()) {}
+
+Lexer::Lexer(Source source, std::size_t begin, std::size_t end)
+    : source(std::move(source)),
+      input(this->source->text().substr(0, end)),
+      position(begin),
+      readPosition(begin),
       tok('\0'),
-      columnOffset(0) {
-  if (!spdlog::get(LEXER_LOGGER)) {
-    spdlog::create<spdlog::sinks::null_sink_st>(LEXER_LOGGER);
-  }
+      logger(Trace::logger(LEXER_LOGGER)) {
   this->readChar();
 };
 
@@ -28,24 +29,25 @@ void Lexer::readChar() {
   }
   this->position = this->readPosition;
   this->readPosition += 1;
-  spdlog::get(LEXER_LOGGER)->info("Reading character: '{}'", this->tok);
+  TRACE_INFO(this->logger, "Reading character: '{}'", this->tok);
+}
+
+void Lexer::advanceTo(std::uint64_t position) {
+  this->readPosition = position;
+  this->readChar();
 }
 
 void Lexer::skipWhitespace() {
-  while (isspace(this->tok)) {
-    auto tok = this->tok;
-    this->readChar();
-    if (tok == '\n') {
-      this->currentLine++;
-      this->columnOffset = this->position;
-    }
+  if (!Scan::is(this->tok, Scan::WHITESPACE)) {
+    return;
   }
+  this->advanceTo(Scan::skip(this->input, this->position, Scan::WHITESPACE));
 }
 
 void Lexer::skipLine() {
-  while (this->tok != '\n' && this->tok != '\0') {
-    this->readChar();
-  }
+  auto end = std::min(this->input.find('\n', this->position),
+                      this->input.size());
+  this->advanceTo(end);
   this->skipWhitespace();
 }
 
@@ -57,45 +59,51 @@ char Lexer::peek() {
   }
 }
 
-std::string Lexer::readIdentifier() {
-  auto sub = this->extactWhile(
-      [](char tok) { return isalpha(tok) || tok == '_' || isdigit(tok); });
-  spdlog::get(LEXER_LOGGER)->info("Found identifier '{}'", sub);
-  return std::move(sub);
+std::string_view Lexer::extactWhile(Scan::CharClass cls) {
+  auto position = this->position;
+  auto end = Scan::skip(this->input, position, cls);
+  this->advanceTo(end);
+  return this->input.substr(position, end - position);
 }
 
-std::string Lexer::readNumber() {
-  auto sub = this->extactWhile([](char tok) { return isdigit(tok); });
-  spdlog::get(LEXER_LOGGER)->info("Found number '{}'", sub);
-  return std::move(sub);
+std::string_view Lexer::readIdentifier() {
+  auto sub = this->extactWhile(Scan::IDENTIFIER);
+  TRACE_INFO(this->logger, "Found identifier '{}'", sub);
+  return sub;
 }
 
-std::string Lexer::readString() {
-  auto sub =
-      this->extactWhile([](char tok) { return (tok != '\0' && tok != '"'); });
-  spdlog::get(LEXER_LOGGER)->info("Found string '{}'", sub);
-  return std::move(sub);
+std::string_view Lexer::readNumber() {
+  auto sub = this->extactWhile(Scan::DIGIT);
+  TRACE_INFO(this->logger, "Found number '{}'", sub);
+  return sub;
 }
 
-std::shared_ptr<Token> Lexer::nextToken() {
-  spdlog::get(LEXER_LOGGER)->info("Getting next token '{}'", this->tok);
-  this->skipWhitespace();
+std::string_view Lexer::readString() {
+  auto sub = this->extactWhile(Scan::STRING_BODY);
+  TRACE_INFO(this->logger, "Found string '{}'", sub);
+  return sub;
+}
 
-  TokenType type = TokenType::ILLEGAL;
-  std::string literal = std::string(1, this->tok);
-  auto position = this->position;
+Token Lexer::nextToken() {
+  TRACE_INFO(this->logger, "Getting next token '{}'", this->tok);
+  this->skipWhitespace();
 
   while (this->tok == '/' && this->peek() == '/') {
-    spdlog::get(LEXER_LOGGER)
-        ->info("Found comment skipping line '{}'", this->tok);
+    TRACE_INFO(this->logger, "Found comment skipping line '{}'", this->tok);
     this->skipLine();
   }
 
+  TokenType type = TokenType::ILLEGAL;
+  auto position = this->position;
+  auto literal = position < this->input.size()
+                     ? this->input.substr(position, 1)
+                     : END_OF_FILE_LITERAL;
+
   switch (this->tok) {
     case '=':
       if (this->peek() == '=') {
         this->readChar();
-        literal = "==";
+        literal = this->input.substr(position, 2);
         type = TokenType::EQ;
       } else {
         type = TokenType::ASSIGN;
@@ -137,7 +145,7 @@ std::shared_ptr<Token> Lexer::nextToken() {
     case '!':
       if (this->peek() == '=') {
         this->readChar();
-        literal = "!=";
+        literal = this->input.substr(position, 2);
         type = TokenType::NE;
       } else {
         type = TokenType::BANG;
@@ -166,32 +174,25 @@ std::shared_ptr<Token> Lexer::nextToken() {
   }
 
   if (type == TokenType::ILLEGAL) {
-    if (isalpha(this->tok)) {
+    if (Scan::is(this->tok, Scan::LETTER)) {
       auto identifier = this->readIdentifier();
-      return std::make_shared<Token>(this->getLocation(position),
-                                     lookupIdentity(identifier), identifier);
-    } else if (isdigit(this->tok)) {
+      auto type = lookupIdentity(identifier);
+      if (type != TokenType::IDENT) {
+        return Token(position, type, identifier);
+      }
+      return Token(position, type, identifier,
+                   this->symbols.intern(identifier));
+    } else if (Scan::is(this->tok, Scan::DIGIT)) {
       auto number = this->readNumber();
-      return std::make_shared<Token>(this->getLocation(position),
-                                     TokenType::INTEGER, number);
+      Token token(position, TokenType::INTEGER, number);
+      auto end = number.data() + number.size();
+      auto result = std::from_chars(number.data(), end, token.integer);
+      token.overflow = result.ec == std::errc::result_out_of_range;
+      return token;
     }
   }
-  spdlog::get(LEXER_LOGGER)->info("Token type '{}'", tokenTypeToString(type));
-  auto token =
-      std::make_shared<Token>(this->getLocation(position), type, literal);
+  TRACE_INFO(this->logger, "Token type '{}'", tokenTypeToString(type));
+  Token token(position, type, literal);
   this->readChar();
   return token;
 }
-
-std::string Lexer::extactWhile(std::function<bool(char)> condition) {
-  auto position = this->position;
-  while (condition(this->tok)) {
-    this->readChar();
-  }
-  return std::move(this->input.substr(position, this->position - position));
-}
-
-std::unique_ptr<Location> Lexer::getLocation(std::uint64_t startPosition) {
-  return std::make_unique<Location>(this->currentLine,
-                                    startPosition - this->columnOffset);
-}
@@ -1,30 +1,46 @@
 #pragma once
-#include <functional>
+#include <scan.hpp>
 #include <string>
+#include <string_view>
 #include <token.hpp>
+#include <trace.hpp>
 
 const std::string LEXER_LOGGER = "lexer";
 
+// The lexer reports end of input as a token holding a single NUL.
+inline constexpr std::string_view END_OF_FILE_LITERAL("\0", 1);
+
 class Lexer {
-  std::string input;
+  Source source;
+  std::string_view input;
   std::uint64_t position;
   std::uint64_t readPosition;
-  std::uint64_t currentLine;
-  std::uint64_t columnOffset;
   char tok;
+  std::shared_ptr<spdlog::logger> logger;
+  Intern::Cache symbols;
 
  private:
   void readChar();
+  // Moves straight to `position`, the way readChar moves to the next one.
+  void advanceTo(std::uint64_t position);
   void skipWhitespace();
   void skipLine();
   char peek();
-  std::string readIdentifier();
-  std::string readNumber();
-  std::string readString();
-  std::unique_ptr<Location> getLocation(std::uint64_t startPosition);
-  std::string extactWhile(std::function<bool(char)> condition);
+  std::string_view readIdentifier();
+  std::string_view readNumber();
+  std::string_view readString();
+  std::string_view extactWhile(Scan::CharClass cls);
 
  public:
-  explicit Lexer(const std::string &input);
-  std::shared_ptr<Token> nextToken();
+  explicit Lexer(std::string input);
+  explicit Lexer(Source source);
+  // Lexes only the bytes in [begin, end) of `source`, with offsets still
+  // counted from its start. `begin` and `end` must be places where the whole
+  // source would be between tokens, like those TokenBuffer::splitPoints
+  // picks.
+  Lexer(Source source, std::size_t begin, std::size_t end);
+  // Token literals point into this, which outlives the lexer as long as
+  // someone holds on to it.
+  const Source &getSource() const { return this->source; }
+  Token nextToken();
 };
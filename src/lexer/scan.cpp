@@ -0,0 +1,64 @@
+#include "scan.hpp"
+#include "scan_kernel.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Scan {
+#if defined(__SSE2__)
+namespace {
+struct SSE2 {
+  using Vec = __m128i;
+  static constexpr std::size_t WIDTH = 16;
+  static Vec load(const char *p) {
+    return _mm_loadu_si128(reinterpret_cast<const Vec *>(p));
+  }
+  static Vec splat(char c) { return _mm_set1_epi8(c); }
+  static Vec equal(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+  static Vec greater(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+  static Vec bitAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+  static Vec bitOr(Vec a, Vec b) { return _mm_or_si128(a, b); }
+  static Vec bitXor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+  // Bits past the vector width are set so they never look like a stop.
+  static std::uint64_t mask(Vec v) {
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(v)) |
+           0xFFFFFFFFFFFF0000ull;
+  }
+};
+}  // namespace
+#endif
+
+#if defined(CMONKEY_SCAN_AVX2)
+// Defined in scan_avx2.cpp, which is the only file built with -mavx2.
+std::size_t skipAVX2(const char *data, std::size_t size, std::size_t from,
+                     CharClass cls);
+#endif
+
+using Kernel = std::size_t (*)(const char *, std::size_t, std::size_t,
+                               CharClass);
+
+static Kernel selectKernel() {
+#if defined(CMONKEY_SCAN_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return skipAVX2;
+  }
+#endif
+#if defined(__SSE2__)
+  return skipVector<SSE2>;
+#else
+  return skipTable;
+#endif
+}
+
+static const Kernel kernel = selectKernel();
+
+std::size_t skip(std::string_view input, std::size_t from, CharClass cls) {
+  return kernel(input.data(), input.size(), from, cls);
+}
+
+std::size_t skipScalar(std::string_view input, std::size_t from,
+                       CharClass cls) {
+  return skipTable(input.data(), input.size(), from, cls);
+}
+}  // namespace Scan
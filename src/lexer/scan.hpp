@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Scan {
+/*
+
+  Character classes
+
+  The lexer classifies bytes through one 256-entry table instead of the
+  locale-aware <cctype> calls, and skips whole runs of a class with skip(),
+  which compares 16 or 32 bytes at a time where the CPU allows it. The SIMD
+  kernel is picked once at startup: AVX2 when the running CPU has it, SSE2 on
+  any other x86-64, and a table-driven loop everywhere else.
+
+*/
+enum CharClass : std::uint8_t {
+  WHITESPACE = 1 << 0,
+  LETTER = 1 << 1,
+  DIGIT = 1 << 2,
+  // Letters, digits and underscores.
+  IDENTIFIER = 1 << 3,
+  // Anything that can appear between the quotes of a string literal.
+  STRING_BODY = 1 << 4,
+  // Anything that can't start a string, a comment or the end of the input.
+  CODE = 1 << 5,
+};
+
+constexpr std::array<std::uint8_t, 256> makeClassTable() {
+  std::array<std::uint8_t, 256> table = {};
+  for (int c = 0; c < 256; c++) {
+    std::uint8_t classes = 0;
+    if (c == ' ' || (c >= '\t' && c <= '\r')) {
+      classes |= WHITESPACE;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      classes |= LETTER | IDENTIFIER;
+    }
+    if (c >= '0' && c <= '9') {
+      classes |= DIGIT | IDENTIFIER;
+    }
+    if (c == '_') {
+      classes |= IDENTIFIER;
+    }
+    if (c != '\0' && c != '"') {
+      classes |= STRING_BODY;
+      if (c != '/') {
+        classes |= CODE;
+      }
+    }
+    table[c] = classes;
+  }
+  return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> CLASSES = makeClassTable();
+
+inline bool is(char c, CharClass cls) {
+  return CLASSES[static_cast<unsigned char>(c)] & cls;
+}
+
+// Index of the first character at or after `from` that isn't in `cls`, or
+// input.size() if the run reaches the end.
+std::size_t skip(std::string_view input, std::size_t from, CharClass cls);
+
+// The scalar loop behind skip, exposed so tests can compare it with the
+// vectorised kernels.
+std::size_t skipScalar(std::string_view input, std::size_t from, CharClass cls);
+}  // namespace Scan
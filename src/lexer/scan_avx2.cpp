@@ -0,0 +1,29 @@
+#include <immintrin.h>
+#include "scan_kernel.hpp"
+
+namespace Scan {
+namespace {
+struct AVX2 {
+  using Vec = __m256i;
+  static constexpr std::size_t WIDTH = 32;
+  static Vec load(const char *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const Vec *>(p));
+  }
+  static Vec splat(char c) { return _mm256_set1_epi8(c); }
+  static Vec equal(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+  static Vec greater(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+  static Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+  static Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static Vec bitXor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+  static std::uint64_t mask(Vec v) {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(v)) |
+           0xFFFFFFFF00000000ull;
+  }
+};
+}  // namespace
+
+std::size_t skipAVX2(const char *data, std::size_t size, std::size_t from,
+                     CharClass cls) {
+  return skipVector<AVX2>(data, size, from, cls);
+}
+}  // namespace Scan
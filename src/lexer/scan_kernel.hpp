@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "scan.hpp"
+
+// Shared by scan.cpp and scan_avx2.cpp, which is built with -mavx2. Keep
+// everything here in the unnamed namespace so each file gets its own copy and
+// the linker never hands AVX2 code to the baseline path.
+namespace Scan {
+namespace {
+std::size_t skipTable(const char *data, std::size_t size, std::size_t from,
+                      CharClass cls) {
+  while (from < size &&
+         (CLASSES[static_cast<unsigned char>(data[from])] & cls)) {
+    from++;
+  }
+  return from;
+}
+
+// Skips a run of `cls` a vector at a time with the operations in Ops, then
+// finishes the last partial vector from the table. Comparisons are signed, so
+// bytes above 0x7F fall outside every range, as they do in the table.
+template <class Ops>
+std::size_t skipVector(const char *data, std::size_t size, std::size_t from,
+                       CharClass cls) {
+  using Vec = typename Ops::Vec;
+  auto inRange = [](Vec bytes, char low, char high) {
+    return Ops::bitAnd(Ops::greater(bytes, Ops::splat(low - 1)),
+                       Ops::greater(Ops::splat(high + 1), bytes));
+  };
+  auto isLetter = [&](Vec bytes) {
+    return inRange(Ops::bitOr(bytes, Ops::splat(0x20)), 'a', 'z');
+  };
+  while (from + Ops::WIDTH <= size) {
+    auto bytes = Ops::load(data + from);
+    Vec in;
+    switch (cls) {
+      case WHITESPACE:
+        in = Ops::bitOr(Ops::equal(bytes, Ops::splat(' ')),
+                        inRange(bytes, '\t', '\r'));
+        break;
+      case LETTER:
+        in = isLetter(bytes);
+        break;
+      case DIGIT:
+        in = inRange(bytes, '0', '9');
+        break;
+      case IDENTIFIER:
+        in = Ops::bitOr(Ops::bitOr(isLetter(bytes), inRange(bytes, '0', '9')),
+                        Ops::equal(bytes, Ops::splat('_')));
+        break;
+      case STRING_BODY:
+        in = Ops::bitOr(Ops::equal(bytes, Ops::splat('\0')),
+                        Ops::equal(bytes, Ops::splat('"')));
+        in = Ops::bitXor(in, Ops::splat(-1));
+        break;
+      case CODE:
+        in = Ops::bitOr(Ops::bitOr(Ops::equal(bytes, Ops::splat('\0')),
+                                   Ops::equal(bytes, Ops::splat('"'))),
+                        Ops::equal(bytes, Ops::splat('/')));
+        in = Ops::bitXor(in, Ops::splat(-1));
+        break;
+      default:
+        return skipTable(data, size, from, cls);
+    }
+    auto outside = ~Ops::mask(in);
+    if (outside) {
+      return from + __builtin_ctzll(outside);
+    }
+    from += Ops::WIDTH;
+  }
+  return skipTable(data, size, from, cls);
+}
+}  // namespace
+}  // namespace Scan
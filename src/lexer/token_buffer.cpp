@@ -0,0 +1,158 @@
+#include "token_buffer.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include "lexer.hpp"
+#include "scan.hpp"
+
+TokenBuffer::TokenBuffer(Source source)
+    : TokenBuffer(source, 0, source->text().size()) {}
+
+// Lexes [begin, end), keeping the END_OF_FILE token only when the range
+// reaches the end of the source.
+TokenBuffer::TokenBuffer(Source source, std::size_t begin, std::size_t end)
+    : source(source) {
+  if (source->text().size() >= NO_PAYLOAD) {
+    throw std::length_error("TokenBuffer: source is larger than 4GB");
+  }
+  // A rough guess that avoids most regrowth on typical scripts.
+  auto expected = (end - begin) / 4 + 1;
+  this->_types.reserve(expected);
+  this->_offsets.reserve(expected);
+  this->_lengths.reserve(expected);
+  this->_payloads.reserve(expected);
+
+  auto last = end == source->text().size();
+  Lexer lexer(std::move(source), begin, end);
+  while (true) {
+    auto token = lexer.nextToken();
+    if (token.type == TokenType::END_OF_FILE && !last) {
+      break;
+    }
+    this->push(token);
+    if (token.type == TokenType::END_OF_FILE) {
+      break;
+    }
+  }
+}
+
+TokenBuffer TokenBuffer::parallel(Source source, std::size_t chunks) {
+  auto text = source->text();
+  auto splits = TokenBuffer::splitPoints(text, chunks);
+  splits.insert(splits.begin(), 0);
+  splits.push_back(text.size());
+
+  std::vector<std::unique_ptr<TokenBuffer>> pieces(splits.size() - 1);
+  auto lex = [&](std::size_t i) {
+    pieces[i].reset(new TokenBuffer(source, splits[i], splits[i + 1]));
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < pieces.size(); i++) {
+    threads.emplace_back(lex, i);
+  }
+  lex(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto &result = *pieces.front();
+  for (std::size_t i = 1; i < pieces.size(); i++) {
+    result.append(*pieces[i]);
+  }
+  return std::move(result);
+}
+
+std::vector<std::size_t> TokenBuffer::splitPoints(std::string_view text,
+                                                  std::size_t chunks) {
+  std::vector<std::size_t> splits;
+  chunks = std::max<std::size_t>(chunks, 1);
+  auto target = [&]() {
+    return text.size() / chunks * (splits.size() + 1);
+  };
+  std::size_t position = 0;
+  while (splits.size() + 1 < chunks && position < text.size()) {
+    // Everything in [position, end) is outside strings and comments.
+    auto end = Scan::skip(text, position, Scan::CODE);
+    for (auto from = std::max(position, target()); from < end;) {
+      if (!Scan::is(text[from], Scan::WHITESPACE)) {
+        from++;
+        continue;
+      }
+      splits.push_back(from);
+      if (splits.size() + 1 == chunks) {
+        return splits;
+      }
+      from = std::max(from + 1, target());
+    }
+    if (end >= text.size() || text[end] == '\0') {
+      break;
+    }
+    if (text[end] == '"') {
+      // The lexer consumes whatever ends the string, quote or NUL.
+      position = Scan::skip(text, end + 1, Scan::STRING_BODY) + 1;
+    } else if (end + 1 < text.size() && text[end + 1] == '/') {
+      position = std::min(text.find('\n', end), text.size());
+    } else {
+      position = end + 1;
+    }
+  }
+  return splits;
+}
+
+void TokenBuffer::append(const TokenBuffer &other) {
+  auto symbols = this->_symbols.size();
+  auto integers = this->_integers.size();
+  for (std::size_t i = 0; i < other.size(); i++) {
+    auto payload = other._payloads[i];
+    if (payload != NO_PAYLOAD) {
+      payload += other._types[i] == TokenType::IDENT ? symbols : integers;
+    }
+    this->_payloads.push_back(payload);
+  }
+  auto extend = [](auto &to, const auto &from) {
+    to.insert(to.end(), from.begin(), from.end());
+  };
+  extend(this->_types, other._types);
+  extend(this->_offsets, other._offsets);
+  extend(this->_lengths, other._lengths);
+  extend(this->_symbols, other._symbols);
+  extend(this->_integers, other._integers);
+}
+
+void TokenBuffer::push(const Token &token) {
+  auto payload = NO_PAYLOAD;
+  if (token.type == TokenType::IDENT) {
+    payload = this->_symbols.size();
+    this->_symbols.push_back(token.symbol);
+  } else if (token.type == TokenType::INTEGER && !token.overflow) {
+    payload = this->_integers.size();
+    this->_integers.push_back(token.integer);
+  }
+  this->_types.push_back(token.type);
+  this->_offsets.push_back(token.offset);
+  this->_lengths.push_back(token.literal.size());
+  this->_payloads.push_back(payload);
+}
+
+Token TokenBuffer::at(std::size_t index) const {
+  auto type = this->_types[index];
+  auto offset = this->_offsets[index];
+  if (type == TokenType::END_OF_FILE) {
+    return Token(offset, type, END_OF_FILE_LITERAL);
+  }
+  // A string's literal starts after its opening quote.
+  auto start = type == TokenType::STRING ? offset + 1 : offset;
+  Token token(offset, type,
+              this->source->text().substr(start, this->_lengths[index]));
+  auto payload = this->_payloads[index];
+  if (type == TokenType::IDENT) {
+    token.symbol = this->_symbols[payload];
+  } else if (type == TokenType::INTEGER) {
+    if (payload == NO_PAYLOAD) {
+      token.overflow = true;
+    } else {
+      token.integer = this->_integers[payload];
+    }
+  }
+  return token;
+}
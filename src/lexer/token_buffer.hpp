@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <token.hpp>
+#include <vector>
+
+/*
+
+  Token buffer
+
+  Lexes a whole Source up front and keeps the tokens as parallel arrays
+  instead of an array of Tokens: a byte of type, and 32-bit offsets,
+  lengths and payload indices. Payloads live in side tables of their own,
+  so a walk over the types, which is most of what a parser's lookahead
+  does, stays within a few cache lines.
+
+  at() reassembles a Token, which makes any position cheap to peek at, and
+  the last token is always END_OF_FILE.
+
+  Large sources can be lexed in parallel. A quick pre-scan that only tracks
+  whether it's inside a string or a comment finds split points between
+  tokens, each chunk is lexed on its own thread, and the chunks are joined
+  in order. Offsets are counted from the start of the whole source, so the
+  result is the same as lexing sequentially, locations included.
+
+*/
+class TokenBuffer {
+ private:
+  Source source;
+  std::vector<TokenType> _types;
+  std::vector<std::uint32_t> _offsets;
+  std::vector<std::uint32_t> _lengths;
+  // An index into _symbols for identifiers and into _integers for integers,
+  // or NO_PAYLOAD.
+  std::vector<std::uint32_t> _payloads;
+  std::vector<Intern::Symbol> _symbols;
+  std::vector<std::int64_t> _integers;
+
+  TokenBuffer(Source source, std::size_t begin, std::size_t end);
+  void push(const Token &token);
+  void append(const TokenBuffer &other);
+
+ public:
+  // Also marks integers that overflowed.
+  static constexpr std::uint32_t NO_PAYLOAD = UINT32_MAX;
+
+  // Throws std::length_error for sources whose offsets don't fit 32 bits.
+  explicit TokenBuffer(Source source);
+  // Lexes in `chunks` pieces on as many threads. Fewer are used when the
+  // pre-scan can't find enough split points.
+  static TokenBuffer parallel(Source source, std::size_t chunks);
+  // Up to `chunks - 1` increasing offsets, each on whitespace outside any
+  // string or comment and before any NUL that ends the input, near where
+  // `text` divides evenly.
+  static std::vector<std::size_t> splitPoints(std::string_view text,
+                                              std::size_t chunks);
+
+  const Source &getSource() const { return this->source; }
+  std::size_t size() const { return this->_types.size(); }
+  TokenType type(std::size_t index) const { return this->_types[index]; }
+  Token at(std::size_t index) const;
+};
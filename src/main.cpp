@@ -6,6 +6,7 @@
 #include <parser.hpp>
 #include <random>
 #include <repl.hpp>
+#include <vm.hpp>
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 void registerLogger(std::string name, uint suffix) {
@@ -15,7 +16,7 @@ void registerLogger(std::string name, uint suffix) {
   logger->flush_on(spdlog::level::info);
 }
 
-int main() {
+int main(int argc, char **argv) {
   std::random_device rd;
   std::mt19937 mt(rd());
   std::uniform_int_distribution<uint> dist(1, 4294967295);
@@ -24,6 +25,13 @@ int main() {
   registerLogger(LEXER_LOGGER, suffix);
   registerLogger(PARSER_LOGGER, suffix);
   registerLogger(EVAL_LOGGER, suffix);
+  registerLogger(COMPILER_LOGGER, suffix);
 
-  Repl::run();
+  auto engine = Repl::Engine::AST;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--vm") {
+      engine = Repl::Engine::VM;
+    }
+  }
+  Repl::run(engine);
 }
\ No newline at end of file
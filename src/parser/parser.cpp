@@ -2,17 +2,55 @@
 #include <iostream>
 #include <parser.hpp>
 
-std::map<TokenType, Precedence> precedences = {
-    {TokenType::EQ, Precedence::EQUALS},
-    {TokenType::NE, Precedence::EQUALS},
-    {TokenType::LT, Precedence::LESSGREATER},
-    {TokenType::GT, Precedence::LESSGREATER},
-    {TokenType::PLUS, Precedence::SUM},
-    {TokenType::MINUS, Precedence::SUM},
-    {TokenType::SLASH, Precedence::PRODUCT},
-    {TokenType::ASTERISK, Precedence::PRODUCT},
-    {TokenType::LPAREN, Precedence::CALL},
-    {TokenType::LBRACKET, Precedence::INDEX}};
+/*
+
+  Pratt tables
+
+  The prefix and infix parse functions and the binding precedence of every
+  token type live in one table indexed by the type's byte value. It's built
+  at compile time and shared by every Parser, so constructing a parser
+  allocates nothing and each step of parseExpression is a single load.
+
+*/
+constexpr Parser::PrattTable Parser::makePrattTable() {
+  PrattTable table = {};
+  auto prefix = [&](TokenType type, PrefixParseFunction fn) {
+    table[static_cast<std::uint8_t>(type)].prefix = fn;
+  };
+  auto infix = [&](TokenType type, InfixParseFunction fn, Precedence prec) {
+    table[static_cast<std::uint8_t>(type)].infix = fn;
+    table[static_cast<std::uint8_t>(type)].precedence = prec;
+  };
+  prefix(TokenType::IDENT, &Parser::parseIdentifier);
+  prefix(TokenType::INTEGER, &Parser::parseIntegerLiteral);
+  prefix(TokenType::BANG, &Parser::parsePrefixExpression);
+  prefix(TokenType::MINUS, &Parser::parsePrefixExpression);
+  prefix(TokenType::TRUE, &Parser::parseBoolean);
+  prefix(TokenType::FALSE, &Parser::parseBoolean);
+  prefix(TokenType::LPAREN, &Parser::parseGroupedExpression);
+  prefix(TokenType::IF, &Parser::parseIfExpression);
+  prefix(TokenType::WHILE, &Parser::parseWhileExpression);
+  prefix(TokenType::FUNCTION, &Parser::parseFunctionLiteral);
+  prefix(TokenType::STRING, &Parser::parseString);
+  prefix(TokenType::LBRACKET, &Parser::parseArrayLiteral);
+  prefix(TokenType::LBRACE, &Parser::parseHashLiteral);
+
+  infix(TokenType::EQ, &Parser::parseInfixExpression, Precedence::EQUALS);
+  infix(TokenType::NE, &Parser::parseInfixExpression, Precedence::EQUALS);
+  infix(TokenType::LT, &Parser::parseInfixExpression, Precedence::LESSGREATER);
+  infix(TokenType::GT, &Parser::parseInfixExpression, Precedence::LESSGREATER);
+  infix(TokenType::PLUS, &Parser::parseInfixExpression, Precedence::SUM);
+  infix(TokenType::MINUS, &Parser::parseInfixExpression, Precedence::SUM);
+  infix(TokenType::SLASH, &Parser::parseInfixExpression, Precedence::PRODUCT);
+  infix(TokenType::ASTERISK, &Parser::parseInfixExpression,
+        Precedence::PRODUCT);
+  infix(TokenType::LPAREN, &Parser::parseCallExpression, Precedence::CALL);
+  infix(TokenType::LBRACKET, &Parser::parseIndexExpression,
+        Precedence::INDEX);
+  return table;
+}
+
+constexpr Parser::PrattTable Parser::PRATT_TABLE = Parser::makePrattTable();
 
 std::string precedenceToString(Precedence prec) {
   switch (prec) {
@@ -38,47 +76,114 @@ std::string precedenceToString(Precedence prec) {
 
 void Parser::nextToken() {
   this->currentToken = this->peekToken;
-  this->peekToken = this->lexer->nextToken();
-}
-
-Precedence lookupPrecedence(TokenType type) {
-  auto pair = precedences.find(type);
-  if (pair == precedences.end()) {
-    return Precedence::BOTTOM;
+  if (this->tokens) {
+    // The buffer ends with END_OF_FILE, which repeats like the lexer's does.
+    this->peekToken = this->tokens->at(this->cursor);
+    if (this->cursor + 1 < this->tokens->size()) {
+      this->cursor++;
+    }
+  } else {
+    this->peekToken = this->lexer->nextToken();
   }
-  return pair->second;
 }
 
 Precedence Parser::peekPrecedence() {
-  return lookupPrecedence(this->peekToken->type);
+  return Parser::rule(this->peekToken.type).precedence;
 }
 
 Precedence Parser::currentPrecedence() {
-  return lookupPrecedence(this->currentToken->type);
+  return Parser::rule(this->currentToken.type).precedence;
 }
 
 std::unique_ptr<AST::Program> Parser::parseProgram() {
-  auto program = std::make_unique<AST::Program>();
-  while (this->currentToken->type != TokenType::END_OF_FILE) {
-    spdlog::get(PARSER_LOGGER)->info("Current token {}", *this->currentToken);
+  this->arena = std::make_shared<AST::Arena>(this->source);
+  this->arena->setBodyParser(&Parser::parseDeferredBody);
+  auto program = std::make_unique<AST::Program>(this->arena);
+  while (this->currentToken.type != TokenType::END_OF_FILE) {
+    TRACE_INFO(this->logger, "Current token {}", this->currentToken);
 
     auto stmt = this->parseStatement();
 
     if (stmt) {
-      spdlog::get(PARSER_LOGGER)
-          ->info("Adding statement {}", stmt->toDebugString());
+      TRACE_INFO(this->logger, "Adding statement {}", stmt->toDebugString());
       program->addStatement(stmt);
     } else {
-      spdlog::get(PARSER_LOGGER)
-          ->info("Null statement found for {}", this->currentToken);
+      TRACE_INFO(this->logger, "Null statement found for {}",
+                 this->currentToken);
     }
     this->nextToken();
   };
+  this->arena->defer(this->deferred);
   return std::move(program);
 }
 
-std::shared_ptr<AST::Statement> Parser::parseStatement() {
-  switch (this->currentToken->type) {
+/*
+
+  Deferred bodies
+
+  A deferred body is parsed by a parser of its own over just the body's
+  bytes, into the arena its literal lives in. Literals nested in it are
+  deferred in turn, and only join the arena's list if the body parsed, so
+  a body that failed doesn't leave orphans behind for validate to report.
+
+*/
+AST::BlockStatement *Parser::parseBody(AST::Arena &arena,
+                                       const AST::FunctionLiteral &literal,
+                                       std::vector<ParserError> &errors) {
+  auto parser = Parser(
+      std::make_unique<Lexer>(arena.getSource(), literal.getBodyBegin(),
+                              literal.getBodyEnd()),
+      FunctionBodies::LAZY);
+  parser.arena = arena.shared_from_this();
+  auto body = parser.parseBlockStatement();
+  if (!parser._errors.empty()) {
+    errors.insert(errors.end(), parser._errors.begin(), parser._errors.end());
+    return nullptr;
+  }
+  arena.defer(parser.deferred);
+  return body;
+}
+
+AST::BlockStatement *Parser::parseDeferredBody(
+    AST::Arena &arena, const AST::FunctionLiteral &literal,
+    std::string &error) {
+  std::vector<ParserError> errors;
+  auto body = Parser::parseBody(arena, literal, errors);
+  if (!errors.empty()) {
+    const auto &first = errors.front();
+    error = fmt::format("{} ({}, {})", first.message,
+                        first.location.lineNumber,
+                        first.location.columnNumber);
+  }
+  return body;
+}
+
+std::vector<ParserError> Parser::validate(AST::Program &program) {
+  std::vector<ParserError> errors;
+  auto &arena = program.getArena();
+  // Parsing a body can defer more literals, which land at the end.
+  for (std::size_t i = 0; i < arena.deferred().size(); i++) {
+    const auto *literal = arena.deferred()[i];
+    if (literal->getBody()) {
+      continue;
+    }
+    const auto &token = literal->getToken();
+    if (arena.getBodySource()) {
+      // A cached body has no bytes of its own to parse again.
+      errors.push_back(ParserError(token,
+                                   arena.getSource()->locate(token.offset),
+                                   literal->getBodyError()));
+      continue;
+    }
+    // Failures are rare, so parse again for the full errors rather than keep
+    // them on every literal.
+    Parser::parseBody(arena, *literal, errors);
+  }
+  return errors;
+}
+
+AST::Statement *Parser::parseStatement() {
+  switch (this->currentToken.type) {
     case TokenType::LET:
       return this->parseLetStatement();
     case TokenType::RETURN:
@@ -88,29 +193,24 @@ std::shared_ptr<AST::Statement> Parser::parseStatement() {
   }
 }
 
-std::shared_ptr<AST::Expression> Parser::parseArrayLiteral() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing array literal for {} ", *this->currentToken);
+AST::Expression *Parser::parseArrayLiteral() {
+  TRACE_INFO(this->logger, "Parsing array literal for {} ",
+             this->currentToken);
 
   auto tok = this->currentToken;
-  std::vector<std::shared_ptr<AST::Expression>> args;
+  std::vector<AST::Expression *> args;
   auto foundElements =
       this->parseParameters(std::back_inserter(args), TokenType::RBRACKET);
   if (!foundElements) {
     return nullptr;
   }
-  auto array = std::make_shared<AST::ArrayLiteral>(tok);
-  for (auto arg : args) {
-    array->addValue(arg);
-  };
-  return array;
+  return this->make<AST::ArrayLiteral>(tok, this->arena->copy(args));
 }
 
-std::shared_ptr<AST::Expression> Parser::parseHashLiteral() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing hash literal for {} ", *this->currentToken);
-  auto hash = std::make_shared<AST::HashLiteral>(this->currentToken);
-
+AST::Expression *Parser::parseHashLiteral() {
+  TRACE_INFO(this->logger, "Parsing hash literal for {} ", this->currentToken);
+  auto tok = this->currentToken;
+  std::vector<AST::HashLiteral::Pair> pairs;
   while (!this->peekTokenIs(TokenType::RBRACE)) {
     this->nextToken();
     auto key = this->parseExpression(Precedence::BOTTOM);
@@ -120,7 +220,7 @@ std::shared_ptr<AST::Expression> Parser::parseHashLiteral() {
     this->nextToken();
 
     auto value = this->parseExpression(Precedence::BOTTOM);
-    hash->addPair(key, value);
+    pairs.emplace_back(key, value);
     if (!this->peekTokenIs(TokenType::RBRACE) &&
         !this->expectPeek(TokenType::COMMA)) {
       return nullptr;
@@ -129,13 +229,12 @@ std::shared_ptr<AST::Expression> Parser::parseHashLiteral() {
   if (!this->expectPeek(TokenType::RBRACE)) {
     return nullptr;
   }
-  return hash;
+  return this->make<AST::HashLiteral>(tok, this->arena->copy(pairs));
 }
 
-std::shared_ptr<AST::Expression> Parser::parseIndexExpression(
-    std::shared_ptr<AST::Expression> left) {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing index expression for {} ", *this->currentToken);
+AST::Expression *Parser::parseIndexExpression(AST::Expression *left) {
+  TRACE_INFO(this->logger, "Parsing index expression for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
   this->nextToken();
   auto index = parseExpression(Precedence::BOTTOM);
@@ -143,14 +242,14 @@ std::shared_ptr<AST::Expression> Parser::parseIndexExpression(
   if (!this->expectPeek(TokenType::RBRACKET)) {
     return nullptr;
   }
-  return std::make_shared<AST::IndexExpression>(tok, left, index);
+  return this->make<AST::IndexExpression>(tok, left, index);
 }
 
-std::shared_ptr<AST::Statement> Parser::parseExpressionStatement() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing expression statement for {} ", *this->currentToken);
+AST::Statement *Parser::parseExpressionStatement() {
+  TRACE_INFO(this->logger, "Parsing expression statement for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
-  auto stmt = std::make_shared<AST::ExpressionStatement>(
+  auto stmt = this->make<AST::ExpressionStatement>(
       tok, this->parseExpression(Precedence::BOTTOM));
   if (this->peekTokenIs(TokenType::SEMICOLON)) {
     this->nextToken();
@@ -158,104 +257,89 @@ std::shared_ptr<AST::Statement> Parser::parseExpressionStatement() {
   return stmt;
 }
 
-std::shared_ptr<AST::Expression> Parser::parseExpression(Precedence prec) {
-  auto prefixFnPair = this->prefixParseFunctions.find(this->currentToken->type);
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing expression {}", *this->currentToken);
-  if (prefixFnPair == this->prefixParseFunctions.end()) {
+AST::Expression *Parser::parseExpression(Precedence prec) {
+  auto fn = Parser::rule(this->currentToken.type).prefix;
+  TRACE_INFO(this->logger, "Parsing expression {}", this->currentToken);
+  if (!fn) {
     auto msg = fmt::format("No prefix expression found for {}",
-                           this->currentToken->literal);
-    spdlog::get(PARSER_LOGGER)->warn(msg);
+                           this->currentToken.literal);
+    TRACE_WARN(this->logger, msg);
     this->addError(this->currentToken, msg);
     return nullptr;
   }
-  auto fn = prefixFnPair->second;
   auto left = (this->*fn)();
 
   while (!this->peekTokenIs(TokenType::SEMICOLON) &&
          prec < this->peekPrecedence()) {
-    spdlog::get(PARSER_LOGGER)
-        ->info("Finding right expression {}", *this->peekToken);
-    auto infixFnPair = this->infixParseFunctions.find(this->peekToken->type);
-    if (infixFnPair == this->infixParseFunctions.end()) {
-      spdlog::get(PARSER_LOGGER)
-          ->info("Didn't find infix function {}", *this->peekToken);
+    TRACE_INFO(this->logger, "Finding right expression {}", this->peekToken);
+    auto infixFn = Parser::rule(this->peekToken.type).infix;
+    if (!infixFn) {
+      TRACE_INFO(this->logger, "Didn't find infix function {}",
+                 this->peekToken);
       return left;
     }
     this->nextToken();
-    spdlog::get(PARSER_LOGGER)
-        ->info("Found infix function {}", *this->currentToken);
-    auto infixFn = infixFnPair->second;
+    TRACE_INFO(this->logger, "Found infix function {}", this->currentToken);
     left = (this->*infixFn)(left);
   };
   return left;
 }
 
-std::shared_ptr<AST::Expression> Parser::parseBoolean() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing boolean expression for {} ", *this->currentToken);
-  return std::make_shared<AST::Boolean>(this->currentToken,
-                                        this->currentTokenIs(TokenType::TRUE));
+AST::Expression *Parser::parseBoolean() {
+  TRACE_INFO(this->logger, "Parsing boolean expression for {} ",
+             this->currentToken);
+  return this->make<AST::Boolean>(this->currentToken,
+                                  this->currentTokenIs(TokenType::TRUE));
 }
 
-std::shared_ptr<AST::Expression> Parser::parsePrefixExpression() {
+AST::Expression *Parser::parsePrefixExpression() {
   auto tok = this->currentToken;
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing prefix for {} ", *this->currentToken);
+  TRACE_INFO(this->logger, "Parsing prefix for {} ", this->currentToken);
   this->nextToken();
   auto right = this->parseExpression(Precedence::PREFIX);
-  return std::make_shared<AST::PrefixExpression>(tok, right, tok->literal);
+  return this->make<AST::PrefixExpression>(tok, right, tok.literal);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseInfixExpression(
-    std::shared_ptr<AST::Expression> left) {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing infix for {} with prec {}", *this->currentToken,
+AST::Expression *Parser::parseInfixExpression(AST::Expression *left) {
+  TRACE_INFO(this->logger, "Parsing infix for {} with prec {}",
+             this->currentToken,
              precedenceToString(this->currentPrecedence()));
   auto tok = this->currentToken;
   auto prec = this->currentPrecedence();
   this->nextToken();
   auto right = this->parseExpression(prec);
-  auto expr =
-      std::make_shared<AST::InfixExpression>(tok, left, right, tok->literal);
-  spdlog::get(PARSER_LOGGER)
-      ->info("Returning infix expression {}", expr->toDebugString());
+  auto expr = this->make<AST::InfixExpression>(tok, left, right, tok.literal);
+  TRACE_INFO(this->logger, "Returning infix expression {}",
+             expr->toDebugString());
   return expr;
 }
 
-std::shared_ptr<AST::Expression> Parser::parseIdentifier() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing identifier for {} ", *this->currentToken);
-  return std::make_shared<AST::Identifier>(this->currentToken,
-                                           this->currentToken->literal);
+AST::Expression *Parser::parseIdentifier() {
+  TRACE_INFO(this->logger, "Parsing identifier for {} ", this->currentToken);
+  return this->make<AST::Identifier>(this->currentToken,
+                                     this->currentToken.symbol);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseString() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing string for {} ", *this->currentToken);
-  return std::make_shared<AST::StringLiteral>(this->currentToken,
-                                              this->currentToken->literal);
+AST::Expression *Parser::parseString() {
+  TRACE_INFO(this->logger, "Parsing string for {} ", this->currentToken);
+  return this->make<AST::StringLiteral>(this->currentToken,
+                                        this->currentToken.literal);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseIntegerLiteral() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing integer literal for {} ", *this->currentToken);
-  int64_t value;
-  try {
-    value = std::stoll(this->currentToken->literal);
-  } catch (std::invalid_argument const &e) {
-    this->addError(this->currentToken, "Token value was not an integer");
-    return nullptr;
-  } catch (std::out_of_range const &e) {
+AST::Expression *Parser::parseIntegerLiteral() {
+  TRACE_INFO(this->logger, "Parsing integer literal for {} ",
+             this->currentToken);
+  if (this->currentToken.overflow) {
     this->addError(this->currentToken, "Integer value out of range");
     return nullptr;
   }
-  return std::make_shared<AST::IntegerLiteral>(this->currentToken, value);
+  return this->make<AST::IntegerLiteral>(this->currentToken,
+                                         this->currentToken.integer);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseIfExpression() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing if expression for {} ", *this->currentToken);
+AST::Expression *Parser::parseIfExpression() {
+  TRACE_INFO(this->logger, "Parsing if expression for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
   if (!this->expectPeek(TokenType::LPAREN)) {
     return nullptr;
@@ -268,40 +352,37 @@ std::shared_ptr<AST::Expression> Parser::parseIfExpression() {
   if (!this->expectPeek(TokenType::LBRACE)) {
     return nullptr;
   }
-  auto whenTrue = std::dynamic_pointer_cast<AST::BlockStatement>(
-      this->parseBlockStatement());
-  std::shared_ptr<AST::BlockStatement> whenFalse = nullptr;
+  auto whenTrue = this->parseBlockStatement();
+  AST::BlockStatement *whenFalse = nullptr;
   if (this->peekTokenIs(TokenType::ELSE)) {
     this->nextToken();
     if (!this->expectPeek(TokenType::LBRACE)) {
       return nullptr;
     }
-    whenFalse = std::dynamic_pointer_cast<AST::BlockStatement>(
-        this->parseBlockStatement());
+    whenFalse = this->parseBlockStatement();
   }
-  return std::make_shared<AST::IfExpression>(tok, cond, whenTrue, whenFalse);
+  return this->make<AST::IfExpression>(tok, cond, whenTrue, whenFalse);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseWhileExpression() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing while expression for {} ", *this->currentToken);
+AST::Expression *Parser::parseWhileExpression() {
+  TRACE_INFO(this->logger, "Parsing while expression for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
   if (!this->expectPeek(TokenType::LBRACE)) {
     return nullptr;
   }
-  auto body = std::dynamic_pointer_cast<AST::BlockStatement>(
-      this->parseBlockStatement());
-  return std::make_shared<AST::WhileExpression>(tok, body);
+  auto body = this->parseBlockStatement();
+  return this->make<AST::WhileExpression>(tok, body);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseFunctionLiteral() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing function literal for {} ", *this->currentToken);
+AST::Expression *Parser::parseFunctionLiteral() {
+  TRACE_INFO(this->logger, "Parsing function literal for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
   if (!this->expectPeek(TokenType::LPAREN)) {
     return nullptr;
   }
-  std::vector<std::shared_ptr<AST::Expression>> args;
+  std::vector<AST::Expression *> args;
   auto foundParams =
       this->parseParameters(std::back_inserter(args), TokenType::RPAREN);
   if (!foundParams) {
@@ -310,24 +391,38 @@ std::shared_ptr<AST::Expression> Parser::parseFunctionLiteral() {
   if (!this->expectPeek(TokenType::LBRACE)) {
     return nullptr;
   }
-  auto body = this->parseBlockStatement();
-  auto fn = std::make_shared<AST::FunctionLiteral>(
-      tok, std::dynamic_pointer_cast<AST::BlockStatement>(body));
+  auto bodyBegin = this->currentToken.offset;
+  AST::BlockStatement *body = nullptr;
+  if (this->bodies == FunctionBodies::LAZY) {
+    if (!this->skipBlockStatement()) {
+      return nullptr;
+    }
+  } else {
+    body = this->parseBlockStatement();
+  }
+  std::vector<AST::Identifier *> arguments;
   for (auto arg : args) {
-    std::shared_ptr<AST::Identifier> ident =
-        convertExpressionToType<AST::Identifier>(arg);
+    auto ident = convertExpressionToType<AST::Identifier>(arg);
     if (ident) {
-      fn->addArgument(ident);
+      arguments.push_back(ident);
     } else {
       return nullptr;
     }
   };
-  return fn;
+  if (this->bodies == FunctionBodies::LAZY) {
+    auto literal = this->make<AST::FunctionLiteral>(
+        tok, this->arena.get(), this->arena->copy(arguments), bodyBegin,
+        this->currentToken.offset + 1);
+    this->deferred.push_back(literal);
+    return literal;
+  }
+  return this->make<AST::FunctionLiteral>(
+      tok, this->arena.get(), this->arena->copy(arguments), body);
 }
 
-std::shared_ptr<AST::Expression> Parser::parseGroupedExpression() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing grouped expression for {} ", *this->currentToken);
+AST::Expression *Parser::parseGroupedExpression() {
+  TRACE_INFO(this->logger, "Parsing grouped expression for {} ",
+             this->currentToken);
   this->nextToken();
   auto expr = this->parseExpression(Precedence::BOTTOM);
   if (!this->expectPeek(TokenType::RPAREN)) {
@@ -336,71 +431,89 @@ std::shared_ptr<AST::Expression> Parser::parseGroupedExpression() {
   return expr;
 }
 
-std::shared_ptr<AST::Statement> Parser::parseBlockStatement() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing block statement for {} ", *this->currentToken);
+AST::BlockStatement *Parser::parseBlockStatement() {
+  TRACE_INFO(this->logger, "Parsing block statement for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
-  auto block = std::make_shared<AST::BlockStatement>(tok);
+  std::vector<AST::Statement *> statements;
   this->nextToken();
   while (!this->currentTokenIs(TokenType::RBRACE)) {
     if (this->currentTokenIs(TokenType::END_OF_FILE)) {
       this->addError(
-          tok, fmt::format("Couldn't find matching } for block {}", *tok));
+          tok, fmt::format("Couldn't find matching }} for block {}", tok));
       return nullptr;
     }
-    block->addStatement(this->parseStatement());
+    statements.push_back(this->parseStatement());
+    this->nextToken();
+  }
+  return this->make<AST::BlockStatement>(tok, this->arena->copy(statements));
+}
+
+bool Parser::skipBlockStatement() {
+  auto tok = this->currentToken;
+  std::size_t depth = 1;
+  while (depth) {
     this->nextToken();
+    switch (this->currentToken.type) {
+      case TokenType::LBRACE:
+        depth++;
+        break;
+      case TokenType::RBRACE:
+        depth--;
+        break;
+      case TokenType::END_OF_FILE:
+        this->addError(
+            tok, fmt::format("Couldn't find matching }} for block {}", tok));
+        return false;
+      default:
+        break;
+    }
   }
-  return block;
+  return true;
 }
 
-std::shared_ptr<AST::Expression> Parser::parseCallExpression(
-    std::shared_ptr<AST::Expression> func) {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing call expression for {} ", *this->currentToken);
+AST::Expression *Parser::parseCallExpression(AST::Expression *func) {
+  TRACE_INFO(this->logger, "Parsing call expression for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
-  std::vector<std::shared_ptr<AST::Expression>> args;
+  std::vector<AST::Expression *> args;
   auto foundParams =
       this->parseParameters(std::back_inserter(args), TokenType::RPAREN);
   if (!foundParams) {
     return nullptr;
   }
-  auto fn = std::make_shared<AST::CallExpression>(tok, func);
-  for (auto arg : args) {
-    fn->addArgument(arg);
-  };
-  return fn;
+  return this->make<AST::CallExpression>(tok, func, this->arena->copy(args));
 }
 
-std::shared_ptr<AST::Statement> Parser::parseReturnStatement() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing return statement for {} ", *this->currentToken);
+AST::Statement *Parser::parseReturnStatement() {
+  TRACE_INFO(this->logger, "Parsing return statement for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
 
   if (this->peekTokenIs(TokenType::RBRACE)) {
-    return std::make_shared<AST::ReturnStatement>(tok, nullptr);
+    return this->make<AST::ReturnStatement>(tok, nullptr);
   }
   this->nextToken();
   if (this->currentTokenIs(TokenType::SEMICOLON)) {
-    return std::make_shared<AST::ReturnStatement>(tok, nullptr);
+    return this->make<AST::ReturnStatement>(tok, nullptr);
   }
   auto ret = this->parseExpression(Precedence::BOTTOM);
-  auto stmt = std::make_shared<AST::ReturnStatement>(tok, ret);
+  auto stmt = this->make<AST::ReturnStatement>(tok, ret);
   if (this->peekTokenIs(TokenType::SEMICOLON)) {
     this->nextToken();
   };
   return stmt;
 }
 
-std::shared_ptr<AST::Statement> Parser::parseLetStatement() {
-  spdlog::get(PARSER_LOGGER)
-      ->info("Parsing let statement for {} ", *this->currentToken);
+AST::Statement *Parser::parseLetStatement() {
+  TRACE_INFO(this->logger, "Parsing let statement for {} ",
+             this->currentToken);
   auto tok = this->currentToken;
   if (!this->expectPeek(TokenType::IDENT)) {
     return nullptr;
   }
-  auto name = std::make_shared<AST::Identifier>(this->currentToken,
-                                                this->currentToken->literal);
+  auto name = this->make<AST::Identifier>(this->currentToken,
+                                          this->currentToken.symbol);
   if (!this->expectPeek(TokenType::ASSIGN)) {
     return nullptr;
   }
@@ -409,14 +522,14 @@ std::shared_ptr<AST::Statement> Parser::parseLetStatement() {
   if (this->peekTokenIs(TokenType::SEMICOLON)) {
     this->nextToken();
   }
-  return std::make_shared<AST::LetStatement>(tok, name, val);
+  return this->make<AST::LetStatement>(tok, name, val);
 }
 
 bool Parser::currentTokenIs(TokenType type) const {
-  return this->currentToken->type == type;
+  return this->currentToken.type == type;
 }
 bool Parser::peekTokenIs(TokenType type) const {
-  return this->peekToken->type == type;
+  return this->peekToken.type == type;
 }
 
 bool Parser::expectPeek(TokenType type) {
@@ -427,7 +540,7 @@ bool Parser::expectPeek(TokenType type) {
     this->addError(
         this->peekToken,
         fmt::format("Expected {} but found {}", tokenTypeToString(type),
-                    tokenTypeToString(this->peekToken->type)));
+                    tokenTypeToString(this->peekToken.type)));
     return false;
   }
 }
@@ -1,7 +1,6 @@
 #pragma once
-#include "spdlog/sinks/null_sink.h"
-
 #include <spdlog/spdlog.h>
+#include <array>
 #include <ast.hpp>
 #include <functional>
 #include <lexer.hpp>
@@ -9,14 +8,15 @@
 #include <map>
 #include <parser_errors.hpp>
 #include <token.hpp>
+#include <token_buffer.hpp>
+#include <trace.hpp>
 
 const std::string PARSER_LOGGER = "parser";
 
 class Parser;
 
-typedef std::shared_ptr<AST::Expression> (Parser::*PrefixParseFunction)();
-typedef std::shared_ptr<AST::Expression> (Parser::*InfixParseFunction)(
-    std::shared_ptr<AST::Expression>);
+typedef AST::Expression *(Parser::*PrefixParseFunction)();
+typedef AST::Expression *(Parser::*InfixParseFunction)(AST::Expression *);
 
 enum class Precedence : std::uint8_t {
   BOTTOM = 1,
@@ -29,50 +29,85 @@ enum class Precedence : std::uint8_t {
   INDEX = 8,
 };
 
+// How a parser handles the bodies of function literals. LAZY only matches
+// their braces, which costs about as much as lexing them, and leaves each
+// body to be parsed into the program's arena the first time something asks
+// the literal for it. Syntax errors in a lazy body only turn up then, unless
+// the program is checked with Parser::validate.
+enum class FunctionBodies : std::uint8_t {
+  EAGER,
+  LAZY,
+};
+
 class Parser {
  private:
+  // Tokens come from exactly one of these: pulled from the lexer as the
+  // parser goes, or walked by index in a buffer lexed up front.
   std::unique_ptr<Lexer> lexer;
-  std::shared_ptr<Token> currentToken;
-  std::shared_ptr<Token> peekToken;
+  std::shared_ptr<const TokenBuffer> tokens;
+  std::size_t cursor = 0;
+  Source source;
+  // Where the nodes of the program being parsed are allocated.
+  std::shared_ptr<AST::Arena> arena;
+  FunctionBodies bodies;
+  // Literals deferred by this parser, handed to the arena once they're
+  // known to be part of a program that parsed.
+  std::vector<AST::FunctionLiteral *> deferred;
+  std::shared_ptr<spdlog::logger> logger;
+  Token currentToken;
+  Token peekToken;
   std::vector<ParserError> _errors;
 
-  std::map<TokenType, PrefixParseFunction> prefixParseFunctions;
-  std::map<TokenType, InfixParseFunction> infixParseFunctions;
+  // How a token type parses, indexed by its byte value. See parser.cpp.
+  struct PrattRule {
+    PrefixParseFunction prefix = nullptr;
+    InfixParseFunction infix = nullptr;
+    Precedence precedence = Precedence::BOTTOM;
+  };
+  typedef std::array<PrattRule, 256> PrattTable;
+  static constexpr PrattTable makePrattTable();
+  static const PrattTable PRATT_TABLE;
+  static const PrattRule &rule(TokenType type) {
+    return PRATT_TABLE[static_cast<std::uint8_t>(type)];
+  }
 
   void nextToken();
   bool expectPeek(TokenType type);
   bool currentTokenIs(TokenType type) const;
   bool peekTokenIs(TokenType type) const;
 
-  std::shared_ptr<AST::Statement> parseStatement();
-  std::shared_ptr<AST::Statement> parseLetStatement();
-  std::shared_ptr<AST::Statement> parseReturnStatement();
-  std::shared_ptr<AST::Statement> parseExpressionStatement();
-  std::shared_ptr<AST::Statement> parseBlockStatement();
-
-  std::shared_ptr<AST::Expression> parseExpression(Precedence);
-  std::shared_ptr<AST::Expression> parseIdentifier();
-  std::shared_ptr<AST::Expression> parseString();
-  std::shared_ptr<AST::Expression> parseIntegerLiteral();
-  std::shared_ptr<AST::Expression> parseBoolean();
-  std::shared_ptr<AST::Expression> parseHashLiteral();
-  std::shared_ptr<AST::Expression> parsePrefixExpression();
-  std::shared_ptr<AST::Expression> parseInfixExpression(
-      std::shared_ptr<AST::Expression>);
-  std::shared_ptr<AST::Expression> parseGroupedExpression();
-  std::shared_ptr<AST::Expression> parseIfExpression();
-  std::shared_ptr<AST::Expression> parseWhileExpression();
-  std::shared_ptr<AST::Expression> parseArrayLiteral();
-  std::shared_ptr<AST::Expression> parseFunctionLiteral();
-  std::shared_ptr<AST::Expression> parseCallExpression(
-      std::shared_ptr<AST::Expression> func);
-  std::shared_ptr<AST::Expression> parseIndexExpression(
-      std::shared_ptr<AST::Expression> left);
+  AST::Statement *parseStatement();
+  AST::Statement *parseLetStatement();
+  AST::Statement *parseReturnStatement();
+  AST::Statement *parseExpressionStatement();
+  AST::BlockStatement *parseBlockStatement();
+  // Moves from a { to its matching }, returning false if there isn't one.
+  bool skipBlockStatement();
+
+  AST::Expression *parseExpression(Precedence);
+  AST::Expression *parseIdentifier();
+  AST::Expression *parseString();
+  AST::Expression *parseIntegerLiteral();
+  AST::Expression *parseBoolean();
+  AST::Expression *parseHashLiteral();
+  AST::Expression *parsePrefixExpression();
+  AST::Expression *parseInfixExpression(AST::Expression *left);
+  AST::Expression *parseGroupedExpression();
+  AST::Expression *parseIfExpression();
+  AST::Expression *parseWhileExpression();
+  AST::Expression *parseArrayLiteral();
+  AST::Expression *parseFunctionLiteral();
+  AST::Expression *parseCallExpression(AST::Expression *func);
+  AST::Expression *parseIndexExpression(AST::Expression *left);
+
+  template <class T, class... Args>
+  T *make(Args &&...args) {
+    return this->arena->make<T>(std::forward<Args>(args)...);
+  }
 
   template <class T>
-  std::shared_ptr<T> convertExpressionToType(
-      std::shared_ptr<AST::Expression> node) {
-    auto conv = std::dynamic_pointer_cast<T>(node);
+  T *convertExpressionToType(AST::Expression *node) {
+    auto conv = dynamic_cast<T *>(node);
     if (conv) {
       return conv;
     } else {
@@ -105,58 +140,43 @@ class Parser {
   Precedence peekPrecedence();
   Precedence currentPrecedence();
 
-  void addError(std::shared_ptr<Token> token, std::string message) {
-    this->_errors.push_back(ParserError(token, message));
+  void addError(const Token &token, std::string message) {
+    auto location = this->source->locate(token.offset);
+    this->_errors.push_back(ParserError(token, location, message));
   }
 
+  static AST::BlockStatement *parseBody(AST::Arena &arena,
+                                        const AST::FunctionLiteral &literal,
+                                        std::vector<ParserError> &errors);
+  static AST::BlockStatement *parseDeferredBody(
+      AST::Arena &arena, const AST::FunctionLiteral &literal,
+      std::string &error);
+
  public:
-  explicit Parser(std::unique_ptr<Lexer> lexer) : lexer(std::move(lexer)) {
-    if (!spdlog::get(PARSER_LOGGER)) {
-      spdlog::create<spdlog::sinks::null_sink_st>(PARSER_LOGGER);
-    }
+  explicit Parser(std::unique_ptr<Lexer> lexer,
+                  FunctionBodies bodies = FunctionBodies::EAGER)
+      : lexer(std::move(lexer)),
+        bodies(bodies),
+        logger(Trace::logger(PARSER_LOGGER)) {
+    this->source = this->lexer->getSource();
     this->nextToken();
     this->nextToken();
-    initRegisterMaps();
   }
 
-  void initRegisterMaps() {
-    this->registerPrefix(TokenType::IDENT, &Parser::parseIdentifier);
-    this->registerPrefix(TokenType::INTEGER, &Parser::parseIntegerLiteral);
-    this->registerPrefix(TokenType::BANG, &Parser::parsePrefixExpression);
-    this->registerPrefix(TokenType::MINUS, &Parser::parsePrefixExpression);
-    this->registerPrefix(TokenType::TRUE, &Parser::parseBoolean);
-    this->registerPrefix(TokenType::FALSE, &Parser::parseBoolean);
-    this->registerPrefix(TokenType::LPAREN, &Parser::parseGroupedExpression);
-    this->registerPrefix(TokenType::IF, &Parser::parseIfExpression);
-    this->registerPrefix(TokenType::WHILE, &Parser::parseWhileExpression);
-    this->registerPrefix(TokenType::FUNCTION, &Parser::parseFunctionLiteral);
-    this->registerPrefix(TokenType::STRING, &Parser::parseString);
-    this->registerPrefix(TokenType::LBRACKET, &Parser::parseArrayLiteral);
-    this->registerPrefix(TokenType::LBRACE, &Parser::parseHashLiteral);
-
-    this->registerInfix(TokenType::PLUS, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::MINUS, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::SLASH, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::ASTERISK, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::EQ, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::NE, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::LT, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::GT, &Parser::parseInfixExpression);
-    this->registerInfix(TokenType::LPAREN, &Parser::parseCallExpression);
-    this->registerInfix(TokenType::LBRACKET, &Parser::parseIndexExpression);
+  explicit Parser(std::shared_ptr<const TokenBuffer> tokens,
+                  FunctionBodies bodies = FunctionBodies::EAGER)
+      : tokens(std::move(tokens)),
+        bodies(bodies),
+        logger(Trace::logger(PARSER_LOGGER)) {
+    this->source = this->tokens->getSource();
+    this->nextToken();
+    this->nextToken();
   }
 
   std::unique_ptr<AST::Program> parseProgram();
+  // Parses every function body `program` still has deferred, including ones
+  // nested in them, and returns their syntax errors.
+  static std::vector<ParserError> validate(AST::Program &program);
 
   const std::vector<ParserError> &errors() { return this->_errors; }
-
-  void registerPrefix(TokenType type, PrefixParseFunction func) {
-    this->prefixParseFunctions.insert(
-        std::pair<TokenType, PrefixParseFunction>(type, func));
-  }
-
-  void registerInfix(TokenType type, InfixParseFunction func) {
-    this->infixParseFunctions.insert(
-        std::pair<TokenType, InfixParseFunction>(type, func));
-  }
 };
\ No newline at end of file
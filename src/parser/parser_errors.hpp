@@ -4,12 +4,14 @@
 #include <token.hpp>
 
 struct ParserError {
-  ParserError(const std::shared_ptr<Token> &token, const std::string &message)
-      : token(token), message(message){};
-  std::shared_ptr<Token> token;
+  ParserError(const Token &token, Location location,
+              const std::string &message)
+      : token(token), location(location), message(message){};
+  Token token;
+  Location location;
   std::string message;
   template <typename OStream>
   friend OStream &operator<<(OStream &os, const ParserError &c) {
-    return os << "Error: " << c.message << " at " << *c.token;
+    return os << "Error: " << c.message << " at " << c.location << " " << c.token;
   }
 };
\ No newline at end of file
@@ -32,7 +32,7 @@ class ASTPrinter : public AST::AbstractDispatcher {
   };
   virtual void dispatch(AST::Program &node) override {
     for (const auto &statement : node.getStatements()) {
-      statement.get()->visit(*this);
+      statement->visit(*this);
     }
   };
   virtual void dispatch(AST::Identifier &node) override {
@@ -68,7 +68,7 @@ class ASTPrinter : public AST::AbstractDispatcher {
       if (arg != args.begin()) {
         writer(", ");
       }
-      arg->get()->visit(*this);
+      (*arg)->visit(*this);
     }
     writer("]");
   }
@@ -81,7 +81,7 @@ class ASTPrinter : public AST::AbstractDispatcher {
   }
   virtual void dispatch(AST::PrefixExpression &node) override {
     writer("(");
-    writer(node.getOp());
+    writer(std::string(node.getOp()));
     node.getRight()->visit(*this);
     writer(")");
   };
@@ -89,7 +89,7 @@ class ASTPrinter : public AST::AbstractDispatcher {
     writer("(");
     node.getLeft()->visit(*this);
     writer(" ");
-    writer(node.getOp());
+    writer(std::string(node.getOp()));
     writer(" ");
     if (node.getRight()) {
       node.getRight()->visit(*this);
@@ -117,10 +117,14 @@ class ASTPrinter : public AST::AbstractDispatcher {
       if (arg != args.begin()) {
         writer(", ");
       }
-      arg->get()->visit(*this);
+      (*arg)->visit(*this);
     }
     writer(") ");
-    node.getBody()->visit(*this);
+    if (auto body = node.getBody()) {
+      body->visit(*this);
+    } else {
+      writer("{ }");
+    }
   }
   virtual void dispatch(AST::CallExpression &node) override {
     node.getFunction()->visit(*this);
@@ -130,7 +134,7 @@ class ASTPrinter : public AST::AbstractDispatcher {
       if (arg != args.begin()) {
         writer(", ");
       }
-      arg->get()->visit(*this);
+      (*arg)->visit(*this);
     }
     writer(")");
   }
@@ -157,8 +161,8 @@ class ASTPrinter : public AST::AbstractDispatcher {
     auto stmts = node.getStatements();
     for (auto stmt = stmts.begin(); stmt != stmts.end(); ++stmt) {
       writer("\n" + getPadding());
-      stmt->get()->visit(*this);
-      if (stmt->get() != stmts.back().get()) {
+      (*stmt)->visit(*this);
+      if (*stmt != stmts.back()) {
         writer(";");
       }
     }
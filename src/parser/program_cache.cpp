@@ -0,0 +1,572 @@
+#include "program_cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <flat.hpp>
+#include <fstream>
+#include <lexer.hpp>
+
+namespace {
+constexpr char MAGIC[8] = {'M', 'O', 'N', 'K', 'E', 'Y', 'C', '\0'};
+// Written in the machine's own byte order, so a file from a machine with the
+// other one doesn't match.
+constexpr std::uint32_t ENDIANNESS = 0x01020304;
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint64_t sourceHash;
+  std::uint64_t sourceSize;
+  std::uint32_t nodes;
+  std::uint32_t lists;
+  std::uint32_t integers;
+  std::uint32_t strings;
+  std::uint32_t identifiers;
+  std::uint32_t unused;
+};
+
+// What the resolver gave an identifier. Its name is its token's literal.
+struct IdentifierRecord {
+  std::uint32_t resolved;
+  std::uint32_t depth;
+  std::uint32_t slot;
+};
+
+// Byte offsets of each array in a cache file. Tokens are one per node.
+struct Layout {
+  std::size_t nodes;
+  std::size_t tokens;
+  std::size_t lists;
+  std::size_t integers;
+  std::size_t strings;
+  std::size_t identifiers;
+  std::size_t size;
+
+  explicit Layout(const Header &header) {
+    auto at = sizeof(Header);
+    auto section = [&at](std::size_t count, std::size_t size) {
+      auto start = at;
+      at = (at + count * size + 7) & ~std::size_t(7);
+      return start;
+    };
+    this->nodes = section(header.nodes, sizeof(Flat::Node));
+    this->tokens = section(header.nodes, sizeof(Flat::Slice));
+    this->lists = section(header.lists, sizeof(std::uint32_t));
+    this->integers = section(header.integers, sizeof(std::int64_t));
+    this->strings = section(header.strings, sizeof(Flat::Slice));
+    this->identifiers =
+        section(header.identifiers, sizeof(IdentifierRecord));
+    this->size = at;
+  }
+};
+
+// Rebuilds nodes of a mapped cache file into an arena. Children come before
+// their parents in the file, so a subtree is a run of nodes that ends with
+// its root, and a run is built in one forward pass where every node is made
+// from ones that already are. Anything else means the file is corrupt.
+//
+// Function bodies are skipped and left in the file. The literal records
+// where its body's run is, and it's built the first time it's needed
+// through the arena's body parser, so a load only touches the nodes outside
+// of any function.
+class Reader {
+ private:
+  const Header &header;
+  std::string_view text;
+  const Flat::Node *nodes;
+  const Flat::Slice *tokens;
+  const std::uint32_t *lists;
+  const std::int64_t *integers;
+  const Flat::Slice *strings;
+  const IdentifierRecord *identifiers;
+  AST::Arena &arena;
+  Intern::Cache symbols;
+  // Where the run being built starts, and each node of it once it's built,
+  // in whichever of the two it belongs to.
+  std::uint32_t first = 0;
+  std::vector<AST::Expression *> expressions;
+  std::vector<AST::Statement *> statements;
+  // Literals whose body was skipped.
+  std::vector<AST::FunctionLiteral *> deferred;
+  bool failed = false;
+
+  template <class T>
+  const T *array(const char *base, std::size_t offset) {
+    return reinterpret_cast<const T *>(base + offset);
+  }
+
+  std::string_view slice(Flat::Slice slice) {
+    if (std::uint64_t(slice.offset) + slice.size > this->text.size()) {
+      this->failed = true;
+      return std::string_view();
+    }
+    return this->text.substr(slice.offset, slice.size);
+  }
+
+  bool built(std::uint32_t index, std::uint32_t parent) {
+    return index >= this->first && index < parent;
+  }
+  AST::Expression *expression(std::uint32_t index, std::uint32_t parent) {
+    if (this->built(index, parent) &&
+        this->expressions[index - this->first]) {
+      return this->expressions[index - this->first];
+    }
+    this->failed = true;
+    return nullptr;
+  }
+  AST::Expression *optionalExpression(std::uint32_t index,
+                                      std::uint32_t parent) {
+    return index == Flat::NONE ? nullptr : this->expression(index, parent);
+  }
+  AST::Statement *statement(std::uint32_t index, std::uint32_t parent) {
+    if (this->built(index, parent) && this->statements[index - this->first]) {
+      return this->statements[index - this->first];
+    }
+    this->failed = true;
+    return nullptr;
+  }
+  AST::BlockStatement *block(std::uint32_t index, std::uint32_t parent) {
+    auto statement = this->statement(index, parent);
+    if (statement && this->nodes[index].kind == Flat::Kind::BLOCK) {
+      return static_cast<AST::BlockStatement *>(statement);
+    }
+    this->failed = true;
+    return nullptr;
+  }
+  AST::BlockStatement *optionalBlock(std::uint32_t index,
+                                     std::uint32_t parent) {
+    return index == Flat::NONE ? nullptr : this->block(index, parent);
+  }
+  AST::Identifier *identifier(std::uint32_t index, std::uint32_t parent) {
+    auto expression = this->expression(index, parent);
+    if (expression && this->nodes[index].kind == Flat::Kind::IDENTIFIER) {
+      return static_cast<AST::Identifier *>(expression);
+    }
+    this->failed = true;
+    return nullptr;
+  }
+
+  // The children listed from `first`, each fetched with `get`.
+  template <class T, class Get>
+  AST::Span<T *> list(std::uint32_t first, std::uint64_t count,
+                      std::uint32_t parent, Get get) {
+    if (first + count > this->header.lists) {
+      this->failed = true;
+      return AST::Span<T *>();
+    }
+    std::vector<T *> children;
+    children.reserve(count);
+    for (auto at = first; at < first + count; at++) {
+      children.push_back((this->*get)(this->lists[at], parent));
+    }
+    return this->arena.copy(children);
+  }
+
+  bool inRange(std::uint32_t index, std::uint32_t count) {
+    this->failed |= index >= count;
+    return !this->failed;
+  }
+
+  template <class T, class... Args>
+  T *make(Args &&...args) {
+    return this->arena.make<T>(std::forward<Args>(args)...);
+  }
+
+  // The child of `node` that comes first in the file, or NONE for a leaf.
+  std::uint32_t firstChild(const Flat::Node &node) {
+    using Kind = Flat::Kind;
+    auto listed = [this](std::uint32_t first,
+                         std::uint32_t count) -> std::uint32_t {
+      if (count == 0) {
+        return Flat::NONE;
+      }
+      if (!this->inRange(first, this->header.lists)) {
+        return Flat::NONE;
+      }
+      return this->lists[first];
+    };
+    switch (node.kind) {
+      case Kind::PROGRAM:
+      case Kind::BLOCK:
+      case Kind::ARRAY:
+      case Kind::HASH:
+        return listed(node.a, node.b);
+      case Kind::FUNCTION:
+        return node.b ? listed(node.a, node.b) : node.c;
+      case Kind::PREFIX:
+      case Kind::INFIX:
+      case Kind::INDEX:
+      case Kind::IF:
+      case Kind::WHILE:
+      case Kind::CALL:
+      case Kind::RETURN:
+      case Kind::EXPRESSION:
+      case Kind::LET:
+        return node.a;
+      default:
+        return Flat::NONE;
+    }
+  }
+
+  // Where the subtree ending at `index` starts: the first node down its
+  // chain of first children.
+  std::uint32_t subtreeStart(std::uint32_t index) {
+    while (!this->failed) {
+      auto child = this->firstChild(this->nodes[index]);
+      if (child == Flat::NONE) {
+        break;
+      }
+      if (!this->built(child, index)) {
+        this->failed = true;
+        break;
+      }
+      index = child;
+    }
+    return index;
+  }
+
+  // Builds the nodes from `first` up to `end`, except for function bodies.
+  void buildRun(std::uint32_t first, std::uint32_t end) {
+    this->first = first;
+    this->expressions.assign(end - first, nullptr);
+    this->statements.assign(end - first, nullptr);
+    // The bodies to skip, found walking back from the end, so the one first
+    // in the file is last.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> bodies;
+    for (auto i = end; i-- > first && !this->failed;) {
+      const auto &node = this->nodes[i];
+      if (node.kind != Flat::Kind::FUNCTION || node.c == Flat::NONE) {
+        continue;
+      }
+      if (!this->built(node.c, i)) {
+        this->failed = true;
+        break;
+      }
+      i = this->subtreeStart(node.c);
+      bodies.emplace_back(i, node.c);
+    }
+    for (auto i = first; i < end && !this->failed; i++) {
+      if (!bodies.empty() && i == bodies.back().first) {
+        i = bodies.back().second;
+        bodies.pop_back();
+        continue;
+      }
+      this->buildNode(i);
+    }
+  }
+
+  void buildNode(std::uint32_t i) {
+    using Kind = Flat::Kind;
+    const auto &node = this->nodes[i];
+    auto literal = this->slice(this->tokens[i]);
+    Token token(this->tokens[i].offset, node.type, literal);
+    auto &expression = this->expressions[i - this->first];
+    auto &statement = this->statements[i - this->first];
+    switch (node.kind) {
+      case Kind::IDENTIFIER: {
+        if (!this->inRange(node.a, this->header.identifiers)) {
+          break;
+        }
+        const auto &record = this->identifiers[node.a];
+        token.symbol = this->symbols.intern(literal);
+        auto identifier = this->make<AST::Identifier>(token, token.symbol);
+        if (record.resolved) {
+          identifier->resolve(record.depth, record.slot);
+        }
+        expression = identifier;
+        break;
+      }
+      case Kind::INTEGER:
+        if (this->inRange(node.a, this->header.integers)) {
+          token.integer = this->integers[node.a];
+          expression = this->make<AST::IntegerLiteral>(token, token.integer);
+        }
+        break;
+      case Kind::STRING:
+        if (this->inRange(node.a, this->header.strings)) {
+          expression = this->make<AST::StringLiteral>(
+              token, this->slice(this->strings[node.a]));
+        }
+        break;
+      case Kind::BOOLEAN:
+        expression = this->make<AST::Boolean>(token, node.a != 0);
+        break;
+      case Kind::ARRAY:
+        expression = this->make<AST::ArrayLiteral>(
+            token, this->list<AST::Expression>(node.a, node.b, i,
+                                               &Reader::expression));
+        break;
+      case Kind::HASH: {
+        auto values = this->list<AST::Expression>(
+            node.a, std::uint64_t(node.b) * 2, i, &Reader::expression);
+        std::vector<AST::HashLiteral::Pair> pairs;
+        for (std::size_t pair = 0; pair + 1 < values.size(); pair += 2) {
+          pairs.emplace_back(values[pair], values[pair + 1]);
+        }
+        expression =
+            this->make<AST::HashLiteral>(token, this->arena.copy(pairs));
+        break;
+      }
+      case Kind::PREFIX:
+        expression = this->make<AST::PrefixExpression>(
+            token, this->expression(node.a, i), literal);
+        break;
+      case Kind::INFIX:
+        expression = this->make<AST::InfixExpression>(
+            token, this->expression(node.a, i),
+            this->optionalExpression(node.b, i), literal);
+        break;
+      case Kind::INDEX:
+        expression = this->make<AST::IndexExpression>(
+            token, this->expression(node.a, i), this->expression(node.b, i));
+        break;
+      case Kind::IF:
+        expression = this->make<AST::IfExpression>(
+            token, this->expression(node.a, i), this->block(node.b, i),
+            this->optionalBlock(node.c, i));
+        break;
+      case Kind::WHILE:
+        expression =
+            this->make<AST::WhileExpression>(token, this->block(node.a, i));
+        break;
+      case Kind::FUNCTION: {
+        if (node.c == Flat::NONE) {
+          this->failed = true;
+          break;
+        }
+        auto function = this->make<AST::FunctionLiteral>(
+            token, &this->arena,
+            this->list<AST::Identifier>(node.a, node.b, i,
+                                        &Reader::identifier),
+            this->subtreeStart(node.c), std::size_t(node.c) + 1);
+        this->deferred.push_back(function);
+        expression = function;
+        break;
+      }
+      case Kind::CALL:
+        expression = this->make<AST::CallExpression>(
+            token, this->expression(node.a, i),
+            this->list<AST::Expression>(node.b, node.c, i,
+                                        &Reader::expression));
+        break;
+      case Kind::RETURN:
+        statement = this->make<AST::ReturnStatement>(
+            token, this->optionalExpression(node.a, i));
+        break;
+      case Kind::EXPRESSION:
+        statement = this->make<AST::ExpressionStatement>(
+            token, this->expression(node.a, i));
+        break;
+      case Kind::LET:
+        statement = this->make<AST::LetStatement>(
+            token, this->identifier(node.a, i), this->expression(node.b, i));
+        break;
+      case Kind::BLOCK:
+        statement = this->make<AST::BlockStatement>(
+            token, this->list<AST::Statement>(node.a, node.b, i,
+                                              &Reader::statement));
+        break;
+      default:
+        this->failed = true;
+        break;
+    }
+  }
+
+ public:
+  Reader(const Header &header, std::string_view bytes, AST::Arena &arena)
+      : header(header), text(arena.getSource()->text()), arena(arena) {
+    Layout layout(header);
+    auto base = bytes.data();
+    this->nodes = this->array<Flat::Node>(base, layout.nodes);
+    this->tokens = this->array<Flat::Slice>(base, layout.tokens);
+    this->lists = this->array<std::uint32_t>(base, layout.lists);
+    this->integers = this->array<std::int64_t>(base, layout.integers);
+    this->strings = this->array<Flat::Slice>(base, layout.strings);
+    this->identifiers =
+        this->array<IdentifierRecord>(base, layout.identifiers);
+  }
+
+  // Adds the cached program's statements to `program`. False if the file is
+  // corrupt.
+  bool buildProgram(AST::Program &program) {
+    auto root = this->header.nodes - 1;
+    const auto &node = this->nodes[root];
+    if (node.kind != Flat::Kind::PROGRAM) {
+      return false;
+    }
+    this->buildRun(0, root);
+    auto statements = this->list<AST::Statement>(node.a, node.b, root,
+                                                 &Reader::statement);
+    if (this->failed) {
+      return false;
+    }
+    for (auto *statement : statements) {
+      program.addStatement(statement);
+    }
+    this->arena.defer(this->deferred);
+    return true;
+  }
+
+  // The body whose run is from `begin` up to `end`, or nullptr if the file
+  // is corrupt.
+  AST::BlockStatement *buildBody(std::size_t begin, std::size_t end) {
+    if (begin >= end || end > this->header.nodes) {
+      return nullptr;
+    }
+    auto first = static_cast<std::uint32_t>(begin);
+    auto last = static_cast<std::uint32_t>(end);
+    this->buildRun(first, last);
+    auto body = this->block(last - 1, last);
+    if (this->failed) {
+      return nullptr;
+    }
+    this->arena.defer(this->deferred);
+    return body;
+  }
+};
+
+// The arena's body parser for a program read from a cache: builds a body
+// from the cache file, which read() checked already.
+AST::BlockStatement *readBody(AST::Arena &arena,
+                              const AST::FunctionLiteral &literal,
+                              std::string &error) {
+  auto bytes = arena.getBodySource()->text();
+  Header header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  auto body = Reader(header, bytes, arena)
+                  .buildBody(literal.getBodyBegin(), literal.getBodyEnd());
+  if (!body) {
+    error = "corrupt program cache";
+  }
+  return body;
+}
+}  // namespace
+
+std::uint64_t ProgramCache::hash(std::string_view text) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : text) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::string ProgramCache::cachePath(const std::string &path) {
+  return path + "c";
+}
+
+bool ProgramCache::write(const std::string &path, AST::Program &program) {
+  const auto &source = program.getArena().getSource();
+  if (!source || source->text().size() > UINT32_MAX) {
+    return false;
+  }
+  auto tree = Flat::Tree::fromProgram(program);
+  Header header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.byteOrder = ENDIANNESS;
+  header.sourceHash = hash(source->text());
+  header.sourceSize = source->text().size();
+  header.nodes = static_cast<std::uint32_t>(tree.nodes().size());
+  header.lists = static_cast<std::uint32_t>(tree.lists().size());
+  header.integers = static_cast<std::uint32_t>(tree.integers().size());
+  header.strings = static_cast<std::uint32_t>(tree.strings().size());
+  header.identifiers = static_cast<std::uint32_t>(tree.identifiers().size());
+
+  Layout layout(header);
+  std::string bytes(layout.size, '\0');
+  auto put = [&bytes](std::size_t offset, const auto &values) {
+    if (!values.empty()) {
+      std::memcpy(&bytes[offset], values.data(),
+                  values.size() * sizeof(values[0]));
+    }
+  };
+  std::memcpy(&bytes[0], &header, sizeof(header));
+  put(layout.nodes, tree.nodes());
+  put(layout.tokens, tree.tokens());
+  put(layout.lists, tree.lists());
+  put(layout.integers, tree.integers());
+  put(layout.strings, tree.strings());
+  std::vector<IdentifierRecord> identifiers;
+  identifiers.reserve(tree.identifiers().size());
+  for (const auto &identifier : tree.identifiers()) {
+    identifiers.push_back({identifier.resolved, identifier.depth,
+                           identifier.slot});
+  }
+  put(layout.identifiers, identifiers);
+
+  // Written aside and renamed over the old file, so a reader never sees half
+  // of one.
+  auto temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.write(bytes.data(), bytes.size())) {
+      file.close();
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<AST::Program> ProgramCache::read(const std::string &path,
+                                                 Source source) {
+  auto file = SourceText::fromFile(path);
+  if (!file || !source) {
+    return nullptr;
+  }
+  auto bytes = file->text();
+  Header header;
+  if (bytes.size() < sizeof(header)) {
+    return nullptr;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  auto text = source->text();
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.byteOrder != ENDIANNESS ||
+      header.nodes == 0 || Layout(header).size != bytes.size() ||
+      header.sourceSize != text.size() || header.sourceHash != hash(text)) {
+    return nullptr;
+  }
+  auto arena = std::make_shared<AST::Arena>(std::move(source));
+  arena->setBodyParser(&readBody, std::move(file));
+  auto program = std::make_unique<AST::Program>(arena);
+  if (!Reader(header, bytes, *arena).buildProgram(*program)) {
+    return nullptr;
+  }
+  return program;
+}
+
+ProgramCache::Loaded ProgramCache::load(
+    const std::string &path, const std::function<Parser(Source)> &makeParser) {
+  Loaded loaded;
+  loaded.source = SourceText::fromFile(path);
+  if (!loaded.source) {
+    return loaded;
+  }
+  auto cache = cachePath(path);
+  loaded.program = read(cache, loaded.source);
+  if (loaded.program) {
+    loaded.cached = true;
+    return loaded;
+  }
+  auto parser = makeParser ? makeParser(loaded.source)
+                           : Parser(std::make_unique<Lexer>(loaded.source));
+  loaded.program = parser.parseProgram();
+  loaded.errors = parser.errors();
+  if (loaded.errors.empty()) {
+    // The cache holds every body, so any the parser deferred are parsed now.
+    loaded.errors = Parser::validate(*loaded.program);
+  }
+  if (!loaded.errors.empty()) {
+    loaded.program = nullptr;
+    return loaded;
+  }
+  // Caching is only an optimisation, so a script in a read-only directory
+  // is simply parsed every time.
+  write(cache, *loaded.program);
+  return loaded;
+}
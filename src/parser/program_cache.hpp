@@ -0,0 +1,64 @@
+#pragma once
+#include <ast.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <parser.hpp>
+#include <source.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+
+  Program cache
+
+  Parsed scripts can be saved next to their source as a .monkeyc file, so
+  loading the same script again skips lexing and parsing. The file is the
+  script's Flat::Tree behind a small header: every array is plain data at
+  an 8-byte aligned offset, so the file is mapped rather than read. Loading
+  builds the nodes outside of any function in one forward pass, and leaves
+  function bodies in the file to be built the first time each one is
+  called, so the time it takes follows the nodes a run touches rather than
+  the size of the script.
+
+  A cache file is keyed by an FNV-1a hash and the length of the source text
+  it was made from, and by a format version that has to change whenever the
+  layout, the node kinds or the token types do. Anything that doesn't match,
+  or that points outside its own arrays, is ignored and rewritten.
+
+  Tokens of a cached program point at their literal in the source. Only
+  parse errors use token offsets, and a cached program has none.
+
+*/
+class ProgramCache {
+ public:
+  static constexpr std::uint32_t VERSION = 1;
+
+  struct Loaded {
+    // nullptr if the script couldn't be opened or has parse errors.
+    std::unique_ptr<AST::Program> program;
+    std::vector<ParserError> errors;
+    // The script's text, which the errors' tokens point into.
+    Source source;
+    bool cached = false;
+  };
+
+  static std::uint64_t hash(std::string_view text);
+  // Where the cache for the script at `path` lives: foo.monkey caches to
+  // foo.monkeyc.
+  static std::string cachePath(const std::string &path);
+
+  // Saves `program`, which has to have been parsed from a source, to `path`.
+  // Returns false if it couldn't be written.
+  static bool write(const std::string &path, AST::Program &program);
+  // The program cached at `path` if it was made from `source` by this
+  // version, otherwise nullptr.
+  static std::unique_ptr<AST::Program> read(const std::string &path,
+                                            Source source);
+  // Loads the script at `path` from its cache when that's fresh, and parses
+  // it with a parser from `makeParser`, or a plain one, and refreshes the
+  // cache otherwise.
+  static Loaded load(const std::string &path,
+                     const std::function<Parser(Source)> &makeParser = {});
+};
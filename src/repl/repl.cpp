@@ -2,20 +2,49 @@
 #include <cstdlib>
 #include <env.hpp>
 #include <eval.hpp>
-#include <fstream>
 #include <iostream>
 #include <lexer.hpp>
 #include <parser.hpp>
 #include <print_dispatcher.hpp>
+#include <program_cache.hpp>
 #include <string>
+#include <thread>
+#include <token_buffer.hpp>
+#include <vm.hpp>
 
 namespace Repl {
-void run() {
+// Scripts at least this large are lexed on every core before parsing.
+constexpr std::size_t PARALLEL_LEX_SIZE = 8 << 20;
+
+// Parses a script loaded with @. Its function bodies are only brace-matched,
+// and ProgramCache::load checks them in full before caching it.
+Parser makeScriptParser(Source source) {
+  auto threads = std::thread::hardware_concurrency();
+  if (threads > 1 && source->text().size() >= PARALLEL_LEX_SIZE) {
+    return Parser(std::make_shared<const TokenBuffer>(
+                      TokenBuffer::parallel(std::move(source), threads)),
+                  FunctionBodies::LAZY);
+  }
+  return Parser(std::make_unique<Lexer>(std::move(source)),
+                FunctionBodies::LAZY);
+}
+
+void run(Engine engine) {
   const std::string prompt = ">> ";
   const std::string prompt_indent = "   ";
   fmt::print("{}", prompt);
   auto env = std::make_shared<Env::Environment>();
+  auto globals = std::make_shared<VirtualMachine::Globals>();
+  auto printErrors = [&](const std::vector<ParserError> &errors) {
+    for (const auto &error : errors) {
+      std::string padding(error.location.columnNumber, ' ');
+      fmt::print("{}{}{}\n{}({}, {})\n", prompt_indent, padding, "^",
+                 error.message, error.location.lineNumber,
+                 error.location.columnNumber);
+    }
+  };
   for (std::string line; std::getline(std::cin, line);) {
+    std::unique_ptr<AST::Program> program;
     if (line.size() > 0 && line.at(0) == '@') {
       auto file = line.substr(1, std::string::npos);
       auto installDir = std::getenv("CMONKEY_INSTALL_DIR");
@@ -24,31 +53,38 @@ void run() {
         fmt::print("{}", prompt);
         continue;
       }
-      std::stringstream ss;
-      ss << installDir << file << ".monkey";
-      fmt::print("Loading {}\n", ss.str());
-      std::ifstream ifs(ss.str());
-      std::string contents((std::istreambuf_iterator<char>(ifs)),
-                           (std::istreambuf_iterator<char>()));
-      line = contents;
-    }
-    auto lexer = std::make_unique<Lexer>(line);
-    auto parser = Parser(std::move(lexer));
-    auto program = parser.parseProgram();
-    if (parser.errors().size() != 0) {
-      for (const auto &error : parser.errors()) {
-        auto columnNumber = error.token->location->columnNumber;
-        std::string padding(error.token->location->columnNumber, ' ');
-        fmt::print("{}{}{}\n{}({}, {})\n", prompt_indent, padding, "^",
-                   error.message, error.token->location->lineNumber,
-                   error.token->location->columnNumber);
+      auto path = fmt::format("{}{}.monkey", installDir, file);
+      fmt::print("Loading {}\n", path);
+      auto loaded = ProgramCache::load(path, makeScriptParser);
+      if (!loaded.source) {
+        fmt::print("ERROR: couldn't open {}\n", path);
+        fmt::print("{}", prompt);
+        continue;
+      }
+      if (!loaded.program) {
+        printErrors(loaded.errors);
+        fmt::print("{}", prompt);
+        continue;
+      }
+      program = std::move(loaded.program);
+    } else {
+      // A line gains nothing from skipping bodies, so errors in them are
+      // reported right away.
+      auto parser = Parser(
+          std::make_unique<Lexer>(SourceText::fromString(std::move(line))));
+      program = parser.parseProgram();
+      auto errors = parser.errors();
+      if (errors.size() != 0) {
+        printErrors(errors);
+        fmt::print("{}", prompt);
+        continue;
       }
-      fmt::print("{}", prompt);
-      continue;
     }
-    auto evaluated = ASTEvaluator::eval(*program, env);
-    if (evaluated && evaluated->type() != Eval::Type::NULL_OBJ) {
-      fmt::print("{}\n", evaluated->inspect());
+    auto evaluated = engine == Engine::VM
+                         ? VirtualMachine::eval(*program, globals)
+                         : ASTEvaluator::eval(*program, env);
+    if (evaluated && evaluated.type() != Eval::Type::NULL_OBJ) {
+      fmt::print("{}\n", evaluated.inspect());
     }
 
     /*
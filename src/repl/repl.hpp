@@ -1,5 +1,10 @@
 #pragma once
 
 namespace Repl {
-void run();
+enum class Engine {
+  AST,
+  VM,
+};
+
+void run(Engine engine = Engine::AST);
 }
\ No newline at end of file
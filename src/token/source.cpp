@@ -0,0 +1,92 @@
+#include "source.hpp"
+#include <algorithm>
+#include <fstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CMONKEY_SOURCE_MMAP 1
+#endif
+
+class StringSource : public SourceText {
+ private:
+  std::string _string;
+
+ public:
+  explicit StringSource(std::string text) : _string(std::move(text)) {
+    this->_text = this->_string;
+  }
+};
+
+#if defined(CMONKEY_SOURCE_MMAP)
+class MappedSource : public SourceText {
+ private:
+  void *_address;
+  std::size_t _length;
+
+ public:
+  MappedSource(void *address, std::size_t length)
+      : _address(address), _length(length) {
+    this->_text = std::string_view(static_cast<const char *>(address), length);
+  }
+  ~MappedSource() override { munmap(this->_address, this->_length); }
+};
+
+static Source mapFile(const std::string &path) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  Source source;
+  struct stat info;
+  // Empty files and things like pipes can't be mapped; those are read.
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    auto length = static_cast<std::size_t>(info.st_size);
+    auto address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED) {
+      madvise(address, length, MADV_SEQUENTIAL);
+      source = std::make_shared<MappedSource>(address, length);
+    }
+  }
+  close(fd);
+  return source;
+}
+#endif
+
+Source SourceText::fromString(std::string text) {
+  return std::make_shared<StringSource>(std::move(text));
+}
+
+Source SourceText::fromFile(const std::string &path) {
+#if defined(CMONKEY_SOURCE_MMAP)
+  if (auto source = mapFile(path)) {
+    return source;
+  }
+#endif
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return nullptr;
+  }
+  std::string text;
+  char buffer[1 << 16];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    text.append(buffer, file.gcount());
+  }
+  return fromString(std::move(text));
+}
+
+Location SourceText::locate(std::size_t offset) const {
+  std::call_once(this->_indexed, [this]() {
+    this->_lineStarts.push_back(0);
+    for (auto newline = this->_text.find('\n');
+         newline != std::string_view::npos;
+         newline = this->_text.find('\n', newline + 1)) {
+      this->_lineStarts.push_back(newline + 1);
+    }
+  });
+  auto line = std::upper_bound(this->_lineStarts.begin(),
+                               this->_lineStarts.end(), offset) -
+              1;
+  return Location(line - this->_lineStarts.begin() + 1, offset - *line);
+}
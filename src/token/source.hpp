@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SourceText;
+
+// The text a program was lexed from. Tokens point into it, so the lexer and
+// the AST built from its tokens share ownership.
+typedef std::shared_ptr<const SourceText> Source;
+
+struct Location {
+  uint64_t lineNumber = 0;
+  uint64_t columnNumber = 0;
+  Location() = default;
+  Location(uint64_t lineNumber, uint64_t columnNumber)
+      : lineNumber(lineNumber), columnNumber(columnNumber) {}
+  template <typename OStream>
+  friend OStream &operator<<(OStream &os, const Location &c) {
+    return os << "[line=" << c.lineNumber << " column=" << c.columnNumber
+              << "]";
+  }
+};
+
+/*
+
+  Source text
+
+  Owns the bytes of a program, either as a string or as a read-only mapping
+  of the file it was loaded from, so loading a script doesn't copy it into a
+  string first.
+
+  Tokens only record their byte offset. Lines and columns are only needed
+  for error messages, so they're resolved by locate() from an index of line
+  starts that's built the first time it's asked for.
+
+*/
+class SourceText {
+ private:
+  mutable std::once_flag _indexed;
+  mutable std::vector<std::size_t> _lineStarts;
+
+ protected:
+  std::string_view _text;
+
+ public:
+  virtual ~SourceText() = default;
+  std::string_view text() const { return this->_text; }
+  // Line (from 1) and column (from 0) of the byte at `offset`.
+  Location locate(std::size_t offset) const;
+
+  static Source fromString(std::string text);
+  // Maps the file at `path`, or reads it when it can't be mapped. Returns
+  // nullptr if the file can't be opened.
+  static Source fromFile(const std::string &path);
+};
@@ -0,0 +1,117 @@
+#include "symbol.hpp"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace Intern {
+namespace {
+// Names by ID, in chunks that double in size so that none of them ever
+// moves. A name is in place before its ID is handed out, so reading one
+// needs no lock.
+class Names {
+ private:
+  // The first chunk holds 1 << FIRST_BITS names, and every 32-bit ID falls
+  // in one of the chunks after it.
+  static constexpr std::uint32_t FIRST_BITS = 6;
+  static constexpr std::uint32_t CHUNKS = 32 - FIRST_BITS + 1;
+
+  std::atomic<std::string *> chunks[CHUNKS] = {};
+  std::atomic<std::uint32_t> _size = 0;
+
+  // The chunk `id` is in, and where in that chunk.
+  static std::pair<std::uint32_t, std::uint32_t> locate(std::uint32_t id) {
+    auto chunk = 31 - __builtin_clz((id >> FIRST_BITS) + 1);
+    auto start = ((1u << chunk) - 1) << FIRST_BITS;
+    return {chunk, id - start};
+  }
+
+ public:
+  Names() = default;
+  Names(const Names &) = delete;
+  Names &operator=(const Names &) = delete;
+  ~Names() {
+    for (auto &chunk : this->chunks) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  std::uint32_t size() const {
+    return this->_size.load(std::memory_order_acquire);
+  }
+
+  // Only called by one thread at a time, under the table's unique lock.
+  const std::string &push(std::string_view name) {
+    auto id = this->_size.load(std::memory_order_relaxed);
+    auto [chunk, offset] = locate(id);
+    auto *names = this->chunks[chunk].load(std::memory_order_relaxed);
+    if (!names) {
+      names = new std::string[std::size_t(1) << (chunk + FIRST_BITS)];
+      this->chunks[chunk].store(names, std::memory_order_release);
+    }
+    names[offset] = std::string(name);
+    this->_size.store(id + 1, std::memory_order_release);
+    return names[offset];
+  }
+
+  const std::string &operator[](std::uint32_t id) const {
+    auto [chunk, offset] = locate(id);
+    return this->chunks[chunk].load(std::memory_order_acquire)[offset];
+  }
+};
+
+struct SymbolTable {
+  // Guards ids, and adding to names.
+  std::shared_mutex mutex;
+  Names names;
+  std::unordered_map<std::string_view, std::uint32_t> ids;
+
+  SymbolTable() { this->ids.emplace(this->names.push(""), 0); }
+};
+
+// Built on first use, so builtins can intern their names during static
+// initialisation.
+SymbolTable &symbolTable() {
+  static SymbolTable table;
+  return table;
+}
+}  // namespace
+
+Symbol Symbol::intern(std::string_view name) {
+  auto &table = symbolTable();
+  {
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    auto found = table.ids.find(name);
+    if (found != table.ids.end()) {
+      return Symbol(found->second);
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(table.mutex);
+  auto found = table.ids.find(name);
+  if (found != table.ids.end()) {
+    return Symbol(found->second);
+  }
+  auto id = table.names.size();
+  table.ids.emplace(table.names.push(name), id);
+  return Symbol(id);
+}
+
+std::size_t Symbol::count() { return symbolTable().names.size(); }
+
+const std::string &Symbol::name() const {
+  return symbolTable().names[this->_id];
+}
+
+Symbol Cache::intern(std::string_view name) {
+  std::uint32_t hash = 2166136261u;
+  for (unsigned char c : name) {
+    hash = (hash ^ c) * 16777619u;
+  }
+  auto &entry = this->entries[hash & (SIZE - 1)];
+  if (entry.name() != name) {
+    entry = Symbol::intern(name);
+  }
+  return entry;
+}
+}  // namespace Intern
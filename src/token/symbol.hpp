@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Intern {
+/*
+
+  Symbols
+
+  Identifier names are interned when they're lexed: every distinct name is
+  stored once, in a table shared by the whole process, and identifiers carry
+  the small integer ID it was given. Scopes and builtins compare and index
+  by ID, and only error messages and printing go back to the name.
+
+  Names are kept in chunks that never move and are in place before their ID
+  is handed out, so name() reads them without a lock. Interning looks the
+  name up in an index guarded by a shared mutex: names that are already
+  known only take the shared lock, and only new ones take it exclusively.
+  Lexers keep a Cache in front of it, so a name they've seen before costs
+  a hash and a compare that touch nothing shared.
+
+*/
+class Symbol {
+ private:
+  std::uint32_t _id = 0;
+  explicit Symbol(std::uint32_t id) : _id(id) {}
+
+ public:
+  // The empty name, which no identifier has.
+  Symbol() = default;
+
+  static Symbol intern(std::string_view name);
+  // Number of distinct names interned so far, which bounds every id().
+  static std::size_t count();
+
+  std::uint32_t id() const { return this->_id; }
+  const std::string &name() const;
+
+  bool operator==(Symbol other) const { return this->_id == other._id; }
+  bool operator!=(Symbol other) const { return this->_id != other._id; }
+  bool operator<(Symbol other) const { return this->_id < other._id; }
+};
+
+// A small direct-mapped cache in front of Symbol::intern, for one thread's
+// run of interning such as a lexer's. A name that maps to the same entry as
+// another just replaces it.
+class Cache {
+ private:
+  static constexpr std::size_t SIZE = 256;
+  Symbol entries[SIZE];
+
+ public:
+  Symbol intern(std::string_view name);
+};
+}  // namespace Intern
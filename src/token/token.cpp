@@ -1,28 +1,65 @@
 #include "token.hpp"
 #include <catch2/catch.hpp>
 #include <iostream>
-#include <map>
 
-Token::Token(std::unique_ptr<Location> location, TokenType type, char token)
-    : location(std::move(location)),
-      type(type),
-      literal(std::string(1, token)) {}
+/*
 
-Token::Token(std::unique_ptr<Location> location, TokenType type,
-             const std::string literal)
-    : location(std::move(location)), type(type), literal(std::move(literal)) {}
+  Keywords
 
-std::map<std::string, TokenType> keywords = {
+  Identifiers are classified with a perfect hash over KEYWORDS: the length
+  plus the first and last characters pick a slot, and only the keyword in
+  that slot is compared. The slots are filled from KEYWORDS at compile time,
+  and the build fails if a new keyword lands in an occupied slot.
+
+*/
+struct Keyword {
+  std::string_view text;
+  TokenType type;
+};
+
+static constexpr Keyword KEYWORDS[] = {
     {"fn", TokenType::FUNCTION},   {"let", TokenType::LET},
     {"true", TokenType::TRUE},     {"false", TokenType::FALSE},
     {"if", TokenType::IF},         {"else", TokenType::ELSE},
     {"return", TokenType::RETURN}, {"while", TokenType::WHILE},
 };
 
-TokenType lookupIdentity(std::string identity) {
-  auto lookup = keywords.find(identity);
-  if (lookup != keywords.end()) {
-    return lookup->second;
+static constexpr std::size_t KEYWORD_SLOTS = 32;
+
+static constexpr std::size_t keywordSlot(std::string_view word) {
+  return (word.size() + static_cast<unsigned char>(word.front()) +
+          static_cast<unsigned char>(word.back())) %
+         KEYWORD_SLOTS;
+}
+
+struct KeywordTable {
+  Keyword slots[KEYWORD_SLOTS] = {};
+  bool perfect = true;
+};
+
+static constexpr KeywordTable makeKeywordTable() {
+  KeywordTable table;
+  for (const auto &keyword : KEYWORDS) {
+    auto &slot = table.slots[keywordSlot(keyword.text)];
+    if (!slot.text.empty()) {
+      table.perfect = false;
+    }
+    slot = keyword;
+  }
+  return table;
+}
+
+static constexpr KeywordTable KEYWORD_TABLE = makeKeywordTable();
+static_assert(KEYWORD_TABLE.perfect,
+              "two keywords share a slot, adjust keywordSlot");
+
+TokenType lookupIdentity(std::string_view identity) {
+  if (identity.empty()) {
+    return TokenType::IDENT;
+  }
+  const auto &keyword = KEYWORD_TABLE.slots[keywordSlot(identity)];
+  if (keyword.text == identity) {
+    return keyword.type;
   }
   return TokenType::IDENT;
 }
@@ -1,6 +1,10 @@
 #pragma once
 #include <spdlog/fmt/ostr.h>
+#include <cstdint>
+#include <source.hpp>
 #include <string>
+#include <string_view>
+#include <symbol.hpp>
 enum class TokenType : std::uint8_t {
   // Info types
   ILLEGAL = 0x0,
@@ -48,32 +52,32 @@ enum class TokenType : std::uint8_t {
   WHILE = 0x57,
 };
 
-TokenType lookupIdentity(std::string identity);
+TokenType lookupIdentity(std::string_view identity);
 std::string tokenTypeToString(TokenType type);
 
-struct Location {
-  uint64_t lineNumber;
-  uint64_t columnNumber;
-  Location(uint64_t lineNumber, uint64_t columnNumber)
-      : lineNumber(lineNumber), columnNumber(columnNumber) {}
-  template <typename OStream>
-  friend OStream &operator<<(OStream &os, const Location &c) {
-    return os << "[line=" << c.lineNumber << " column=" << c.columnNumber
-              << "]";
-  }
-};
-
-class Token {
- public:
-  const TokenType type;
-  const std::string literal;
-  const std::unique_ptr<Location> location;
-  Token(std::unique_ptr<Location> location, TokenType type, char token);
-  Token(std::unique_ptr<Location> location, TokenType type,
-        std::string literal);
+// A token is a view of its literal in the Source plus the offset it starts
+// at, which SourceText::locate turns into a line and column; it is small
+// enough to pass by value.
+//
+// The lexer also decodes each literal's payload so the parser never looks
+// at its characters again: identifiers carry their interned name, integers
+// their value, and a string's literal is already its contents without the
+// quotes.
+struct Token {
+  TokenType type = TokenType::ILLEGAL;
+  // Set on INTEGER tokens whose digits don't fit in an int64_t.
+  bool overflow = false;
+  Intern::Symbol symbol;
+  std::string_view literal;
+  std::size_t offset = 0;
+  std::int64_t integer = 0;
+  Token() = default;
+  Token(std::size_t offset, TokenType type, std::string_view literal,
+        Intern::Symbol symbol = Intern::Symbol())
+      : type(type), symbol(symbol), literal(literal), offset(offset) {}
   template <typename OStream>
   friend OStream &operator<<(OStream &os, const Token &c) {
-    return os << "[token location" << *c.location
+    return os << "[token offset=" << c.offset
               << ", type=" << tokenTypeToString(c.type)
               << ", literal=" << c.literal << "]";
   }
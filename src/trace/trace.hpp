@@ -0,0 +1,63 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "spdlog/sinks/null_sink.h"
+
+/*
+
+  Tracing
+
+  The lexer, parser, evaluator and compiler trace every step they take,
+  which is useful when following a program through the REPL's log files and
+  far too expensive anywhere else. CMONKEY_TRACE_LEVEL, set from the CMake
+  option of the same name, is the lowest spdlog level compiled in; calls
+  below it expand to nothing. Calls that remain check the logger's level
+  before their arguments are evaluated, so an `inspect()` passed to a logger
+  that isn't listening is never built.
+
+*/
+#ifndef CMONKEY_TRACE_LEVEL
+#define CMONKEY_TRACE_LEVEL SPDLOG_LEVEL_INFO
+#endif
+
+#define CMONKEY_TRACE(logger, level, ...)   \
+  do {                                      \
+    if ((logger)->should_log(level)) {      \
+      (logger)->log(level, __VA_ARGS__);    \
+    }                                       \
+  } while (0)
+
+#if CMONKEY_TRACE_LEVEL <= SPDLOG_LEVEL_INFO
+#define TRACE_INFO(logger, ...) \
+  CMONKEY_TRACE(logger, spdlog::level::info, __VA_ARGS__)
+#else
+#define TRACE_INFO(logger, ...) (void)0
+#endif
+
+#if CMONKEY_TRACE_LEVEL <= SPDLOG_LEVEL_WARN
+#define TRACE_WARN(logger, ...) \
+  CMONKEY_TRACE(logger, spdlog::level::warn, __VA_ARGS__)
+#else
+#define TRACE_WARN(logger, ...) (void)0
+#endif
+
+namespace Trace {
+// The logger registered under `name`. When nobody registered one, a null
+// logger that is switched off is created so callers skip their arguments.
+// Look it up once and keep the handle; spdlog::get locks the registry.
+// Lexers on TokenBuffer::parallel's workers can get here at once, so the
+// lookup and the creation happen under one lock, and the null logger is
+// shared between threads.
+inline std::shared_ptr<spdlog::logger> logger(const std::string &name) {
+  static std::mutex creating;
+  std::lock_guard<std::mutex> lock(creating);
+  auto logger = spdlog::get(name);
+  if (!logger) {
+    logger = spdlog::create<spdlog::sinks::null_sink_mt>(name);
+    logger->set_level(spdlog::level::off);
+  }
+  return logger;
+}
+}  // namespace Trace
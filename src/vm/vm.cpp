@@ -0,0 +1,350 @@
+#include "vm.hpp"
+#include <builtin.hpp>
+#include <eval_errors.hpp>
+#include <eval_ops.hpp>
+#include <iterator>
+
+using Code::Opcode;
+
+std::string operatorForOpcode(Opcode op) {
+  switch (op) {
+    case Opcode::ADD:
+      return "+";
+    case Opcode::SUB:
+      return "-";
+    case Opcode::MUL:
+      return "*";
+    case Opcode::DIV:
+      return "/";
+    case Opcode::EQUAL:
+      return "==";
+    case Opcode::NOT_EQUAL:
+      return "!=";
+    case Opcode::GREATER_THAN:
+      return ">";
+    case Opcode::LESS_THAN:
+      return "<";
+    default:
+      return Code::lookup(op).name;
+  }
+}
+
+void VirtualMachine::unwind(std::size_t to) {
+  for (auto slot = to; slot < this->sp; slot++) {
+    this->stack[slot] = Eval::Value();
+  }
+  this->sp = to;
+}
+
+Eval::Value VirtualMachine::executeBinaryOperation(Opcode op) {
+  auto right = this->pop();
+  auto left = this->pop();
+  if (left.type() == Eval::Type::INTEGER_OBJ &&
+      right.type() == Eval::Type::INTEGER_OBJ) {
+    auto l = left.integer();
+    auto r = right.integer();
+    switch (op) {
+      case Opcode::ADD:
+        return Eval::Value::fromInteger(l + r);
+      case Opcode::SUB:
+        return Eval::Value::fromInteger(l - r);
+      case Opcode::MUL:
+        return Eval::Value::fromInteger(l * r);
+      case Opcode::DIV:
+        if (r == 0) {
+          return makeDivideByZeroError(l, r);
+        }
+        return Eval::Value::fromInteger(l / r);
+      case Opcode::EQUAL:
+        return Eval::Value::fromBoolean(l == r);
+      case Opcode::NOT_EQUAL:
+        return Eval::Value::fromBoolean(l != r);
+      case Opcode::GREATER_THAN:
+        return Eval::Value::fromBoolean(l > r);
+      case Opcode::LESS_THAN:
+        return Eval::Value::fromBoolean(l < r);
+      default:
+        break;
+    }
+  }
+  return evalInfixExpression(operatorForOpcode(op), left, right);
+}
+
+Eval::Value VirtualMachine::buildHash(std::size_t pairs) {
+  auto hash = std::make_shared<Eval::HashBag>();
+  hash->reserve(pairs);
+  auto start = this->sp - pairs * 2;
+  for (auto slot = start; slot < this->sp; slot += 2) {
+    auto &key = this->stack[slot];
+    auto keyHash = key.hash();
+    if (!keyHash) {
+      return makeInvalidHashKeyType(key.type());
+    }
+    hash->insert(*keyHash, Eval::HashPair(std::move(key),
+                                          std::move(this->stack[slot + 1])));
+  }
+  this->unwind(start);
+  this->push(std::move(hash));
+  return Eval::Value();
+}
+
+Eval::Value VirtualMachine::callFunction(std::uint8_t argc) {
+  auto calleeSlot = this->sp - 1 - argc;
+  const auto &callee = this->stack[calleeSlot];
+  switch (callee.type()) {
+    case Eval::Type::CLOSURE_OBJ: {
+      auto closure = static_cast<Eval::ClosureBag *>(callee.bag().get());
+      const auto &fn = closure->fn();
+      const auto &bound = closure->bound();
+      auto supplied = argc + bound.size();
+      if (supplied < fn->numParameters()) {
+        std::vector<Eval::Value> arguments(bound);
+        std::move(this->stack.begin() + calleeSlot + 1,
+                  this->stack.begin() + this->sp,
+                  std::back_inserter(arguments));
+        auto partial = std::make_shared<Eval::ClosureBag>(fn, closure->free(),
+                                                          arguments);
+        this->unwind(calleeSlot);
+        this->push(partial);
+        return Eval::Value();
+      }
+      if (supplied > fn->numParameters()) {
+        return makeWrongNumberOfArgumentsError(fn->numParameters(), supplied);
+      }
+      this->reserve(bound.size() + fn->numLocals());
+      if (!bound.empty()) {
+        std::move_backward(this->stack.begin() + calleeSlot + 1,
+                           this->stack.begin() + this->sp,
+                           this->stack.begin() + this->sp + bound.size());
+        std::copy(bound.begin(), bound.end(),
+                  this->stack.begin() + calleeSlot + 1);
+      }
+      auto basePointer = calleeSlot + 1;
+      const auto *instructions = fn->instructions().data();
+      this->frames.push_back(
+          Frame{closure, instructions, instructions, basePointer});
+      this->sp = basePointer + fn->numLocals();
+      return Eval::Value();
+    }
+    case Eval::Type::BUILTIN_OBJ: {
+      auto builtin = static_cast<Eval::BuiltinBag *>(callee.bag().get());
+      std::vector<Eval::Value> arguments(
+          std::make_move_iterator(this->stack.begin() + calleeSlot + 1),
+          std::make_move_iterator(this->stack.begin() + this->sp));
+      auto result = builtin->exec(arguments);
+      this->unwind(calleeSlot);
+      if (isError(result)) {
+        return result;
+      }
+      this->push(result);
+      return Eval::Value();
+    }
+    default:
+      return makeNotAFunctionError(callee.inspect());
+  }
+}
+
+Eval::Value VirtualMachine::run(const Bytecode &bytecode) {
+  auto main = bytecode.instructions;
+  main.push_back(static_cast<std::uint8_t>(Opcode::RETURN));
+  const auto &constants = bytecode.constants;
+  const auto &builtins = Builtin::list();
+  auto &globalValues = this->globals->values;
+  globalValues.resize(this->globals->symbols->size());
+
+  this->unwind(0);
+  this->frames.clear();
+  this->frames.push_back(Frame{nullptr, main.data(), main.data(), 0});
+  this->lastPopped = NULL_VALUE;
+  auto frame = &this->frames.back();
+
+  auto fail = [this](Eval::Value error) {
+    this->unwind(0);
+    this->frames.clear();
+    return error;
+  };
+
+  while (true) {
+    auto op = static_cast<Opcode>(*frame->ip++);
+    switch (op) {
+      case Opcode::CONSTANT: {
+        auto index = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        this->push(constants[index]);
+        break;
+      }
+      case Opcode::POP:
+        this->lastPopped = this->pop();
+        break;
+      case Opcode::PUSH_TRUE:
+        this->push(TRUE_VALUE);
+        break;
+      case Opcode::PUSH_FALSE:
+        this->push(FALSE_VALUE);
+        break;
+      case Opcode::PUSH_NULL:
+        this->push(NULL_VALUE);
+        break;
+
+      case Opcode::ADD:
+      case Opcode::SUB:
+      case Opcode::MUL:
+      case Opcode::DIV:
+      case Opcode::EQUAL:
+      case Opcode::NOT_EQUAL:
+      case Opcode::GREATER_THAN:
+      case Opcode::LESS_THAN: {
+        auto result = this->executeBinaryOperation(op);
+        if (isError(result)) {
+          return fail(result);
+        }
+        this->push(std::move(result));
+        break;
+      }
+      case Opcode::MINUS: {
+        auto result = evalNegateOperator(this->pop());
+        if (isError(result)) {
+          return fail(result);
+        }
+        this->push(std::move(result));
+        break;
+      }
+      case Opcode::BANG:
+        this->push(evalBangOperator(this->pop()));
+        break;
+
+      case Opcode::JUMP:
+        frame->ip = frame->instructions + Code::readUint16(frame->ip);
+        break;
+      case Opcode::JUMP_NOT_TRUTHY: {
+        auto target = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        auto condition = this->pop();
+        if (!isTruthy(condition)) {
+          frame->ip = frame->instructions + target;
+        }
+        break;
+      }
+
+      case Opcode::GET_GLOBAL: {
+        auto index = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        const auto &value = globalValues[index];
+        if (!value) {
+          return fail(makeIdentifierNotFoundError(
+              this->globals->symbols->nameAt(index)));
+        }
+        this->push(value);
+        break;
+      }
+      case Opcode::SET_GLOBAL: {
+        auto index = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        globalValues[index] = this->pop();
+        this->lastPopped = NULL_VALUE;
+        break;
+      }
+      case Opcode::GET_LOCAL: {
+        auto index = Code::readUint8(frame->ip++);
+        this->push(this->stack[frame->basePointer + index]);
+        break;
+      }
+      case Opcode::SET_LOCAL: {
+        auto index = Code::readUint8(frame->ip++);
+        this->stack[frame->basePointer + index] = this->pop();
+        break;
+      }
+      case Opcode::GET_BUILTIN: {
+        auto index = Code::readUint8(frame->ip++);
+        this->push(builtins[index]);
+        break;
+      }
+      case Opcode::GET_FREE: {
+        auto index = Code::readUint8(frame->ip++);
+        this->push(frame->closure->free()[index]);
+        break;
+      }
+      case Opcode::CURRENT_CLOSURE: {
+        // Recursion by name always refers to the function itself, not to a
+        // partially applied copy of it.
+        if (frame->closure->bound().empty()) {
+          this->push(this->stack[frame->basePointer - 1]);
+        } else {
+          this->push(std::make_shared<Eval::ClosureBag>(
+              frame->closure->fn(), frame->closure->free()));
+        }
+        break;
+      }
+
+      case Opcode::ARRAY: {
+        auto count = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        std::vector<Eval::Value> values(
+            std::make_move_iterator(this->stack.begin() + this->sp - count),
+            std::make_move_iterator(this->stack.begin() + this->sp));
+        this->sp -= count;
+        this->push(makeArrayBag(std::move(values)));
+        break;
+      }
+      case Opcode::HASH: {
+        auto pairs = Code::readUint16(frame->ip);
+        frame->ip += 2;
+        auto error = this->buildHash(pairs);
+        if (error) {
+          return fail(error);
+        }
+        break;
+      }
+      case Opcode::INDEX: {
+        auto index = this->pop();
+        auto left = this->pop();
+        auto result = evalIndexExpression(left, index);
+        if (isError(result)) {
+          return fail(result);
+        }
+        this->push(std::move(result));
+        break;
+      }
+
+      case Opcode::CALL: {
+        auto argc = Code::readUint8(frame->ip++);
+        auto error = this->callFunction(argc);
+        if (error) {
+          return fail(error);
+        }
+        frame = &this->frames.back();
+        break;
+      }
+      case Opcode::RETURN_VALUE:
+      case Opcode::RETURN: {
+        auto value = op == Opcode::RETURN_VALUE ? this->pop() : NULL_VALUE;
+        if (this->frames.size() == 1) {
+          if (op == Opcode::RETURN) {
+            value = this->lastPopped;
+          }
+          this->unwind(0);
+          this->frames.clear();
+          return value;
+        }
+        this->unwind(frame->basePointer - 1);
+        this->frames.pop_back();
+        frame = &this->frames.back();
+        this->push(std::move(value));
+        break;
+      }
+      case Opcode::CLOSURE: {
+        auto index = Code::readUint16(frame->ip);
+        auto numFree = Code::readUint8(frame->ip + 2);
+        frame->ip += 3;
+        auto fn = std::static_pointer_cast<Eval::CompiledFunctionBag>(
+            constants[index].bag());
+        std::vector<Eval::Value> free(
+            std::make_move_iterator(this->stack.begin() + this->sp - numFree),
+            std::make_move_iterator(this->stack.begin() + this->sp));
+        this->sp -= numFree;
+        this->push(std::make_shared<Eval::ClosureBag>(fn, std::move(free)));
+        break;
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <ast.hpp>
+#include <bag.hpp>
+#include <compiled_bag.hpp>
+#include <compiler.hpp>
+#include <constant_folder.hpp>
+#include <memory>
+#include <string>
+#include <symbol_table.hpp>
+#include <vector>
+
+class VirtualMachine {
+ public:
+  // Everything that outlives a single program: the global symbols known to the
+  // compiler, the values bound to them and the constant pool.
+  class Globals {
+   public:
+    Globals() : symbols(Compiler::makeGlobals()){};
+    std::shared_ptr<SymbolTable> symbols;
+    std::vector<Eval::Value> values;
+    std::vector<Eval::Value> constants;
+  };
+
+ private:
+  struct Frame {
+    Eval::ClosureBag *closure;
+    const std::uint8_t *instructions;
+    const std::uint8_t *ip;
+    std::size_t basePointer;
+  };
+
+  static const std::size_t INITIAL_STACK_SIZE = 2048;
+
+  std::shared_ptr<Globals> globals;
+  std::vector<Eval::Value> stack;
+  std::size_t sp = 0;
+  std::vector<Frame> frames;
+  Eval::Value lastPopped;
+
+  void reserve(std::size_t slots) {
+    if (this->sp + slots >= this->stack.size()) {
+      this->stack.resize(std::max(this->stack.size() * 2, this->sp + slots));
+    }
+  }
+  void push(Eval::Value value) {
+    this->reserve(1);
+    this->stack[this->sp++] = std::move(value);
+  }
+  Eval::Value pop() { return std::move(this->stack[--this->sp]); }
+  void unwind(std::size_t to);
+
+  Eval::Value executeBinaryOperation(Code::Opcode op);
+  // These push their result and hand back an error, or an empty Value when
+  // execution can continue.
+  Eval::Value callFunction(std::uint8_t argc);
+  Eval::Value buildHash(std::size_t pairs);
+
+ public:
+  explicit VirtualMachine(std::shared_ptr<Globals> globals)
+      : globals(globals), stack(INITIAL_STACK_SIZE){};
+
+  Eval::Value run(const Bytecode &bytecode);
+
+  static Eval::Value eval(AST::Node &n, std::shared_ptr<Globals> globals) {
+    if (auto program = dynamic_cast<AST::Program *>(&n)) {
+      ConstantFolder::fold(*program);
+    }
+    Compiler compiler(globals->symbols, globals->constants);
+    compiler.compile(n);
+    if (!compiler.errors().empty()) {
+      return std::make_shared<Eval::ErrorBag>(
+          fmt::format("compile error: {}", compiler.errors().front()));
+    }
+    auto bytecode = compiler.bytecode();
+    globals->constants = bytecode.constants;
+    VirtualMachine vm(globals);
+    return vm.run(bytecode);
+  }
+};
@@ -0,0 +1,577 @@
+#include <chrono>
+#include <env.hpp>
+#include <eval.hpp>
+#include <filesystem>
+#include <flat.hpp>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <lexer.hpp>
+#include <map>
+#include <parser.hpp>
+#include <program_cache.hpp>
+#include <random>
+#include <thread>
+#include <token_buffer.hpp>
+#include <vm.hpp>
+
+inline std::unique_ptr<AST::Program> testProgramWithInput(std::string input) {
+  auto lexer = std::make_unique<Lexer>(input);
+  auto parser = Parser(std::move(lexer));
+  auto program = parser.parseProgram();
+  assert(parser.errors().size() == 0);
+  return program;
+}
+
+const std::string FIB = R"V0G0N(
+let fib = fn(n) {
+  if (n < 2) {
+    n
+  } else {
+    fib(n - 1) + fib(n - 2)
+  }
+};
+)V0G0N";
+
+const std::string RANGE = R"V0G0N(
+let range = fn(start, end) {
+  let iter = fn(start, end, res) {
+    if (start == end) {
+      res
+    } else {
+      iter(start + 1, end, push(res, start))
+    }
+  }
+  iter(start, end, []);
+}
+)V0G0N";
+
+const std::string GROW = R"V0G0N(
+let grow = fn(s, n) {
+  if (n == 0) {
+    s
+  } else {
+    grow(sprint(s, s), n - 1)
+  }
+};
+)V0G0N";
+
+const std::string LITERALS = R"V0G0N(
+let literals = fn(n, acc) {
+  if (n == 0) {
+    acc
+  } else {
+    let t = {"name": "mon" + "key", "tags": ["a", "b"], "day": 60 * 60 * 24};
+    literals(n - 1, acc + len(t["tags"]) + t["day"] / 86400)
+  }
+};
+)V0G0N";
+
+// Runs `setup` once and then times `iterations` evaluations of `input` in the
+// same environment, printing the best run.
+void bench(const std::string &name, const std::string &setup,
+           const std::string &input, int iterations) {
+  using Engine = std::function<Eval::Value(AST::Program &)>;
+  auto env = std::make_shared<Env::Environment>();
+  auto globals = std::make_shared<VirtualMachine::Globals>();
+  std::pair<std::string, Engine> engines[] = {
+      {"ast", [&](AST::Program &p) { return ASTEvaluator::eval(p, env); }},
+      {"vm", [&](AST::Program &p) { return VirtualMachine::eval(p, globals); }},
+  };
+  auto setupProgram = testProgramWithInput(setup);
+  auto program = testProgramWithInput(input);
+  for (auto &engine : engines) {
+    engine.second(*setupProgram);
+    auto best = std::chrono::steady_clock::duration::max();
+    std::string result;
+    for (int i = 0; i < iterations; i++) {
+      auto start = std::chrono::steady_clock::now();
+      auto bag = engine.second(*program);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed);
+      result = bag.type() == Eval::Type::ARRAY_OBJ
+                   ? fmt::format("array({})",
+                                 Eval::convertToArray(bag)->values().size())
+                   : bag.inspect();
+    }
+    std::cout << fmt::format(
+                     "{:<24} {:<4} {:>10.3f} ms  {}", name, engine.first,
+                     std::chrono::duration<double, std::milli>(best).count(),
+                     result)
+              << std::endl;
+  }
+}
+
+// Inserts and then looks up `count` random integer keys in a HashBag, next
+// to the std::map keyed by HashKey that it replaced.
+void benchHash(int count, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto report = [](const std::string &name, Clock::duration elapsed) {
+    std::cout << fmt::format(
+                     "{:<24} {:<4} {:>10.3f} ms", name, "c++",
+                     std::chrono::duration<double, std::milli>(elapsed).count())
+              << std::endl;
+  };
+  std::mt19937_64 random(7919);
+  std::vector<Eval::Value> keys;
+  for (int i = 0; i < count; i++) {
+    keys.push_back(Eval::Value::fromInteger(random()));
+  }
+  auto lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), random);
+  auto bestTable = std::make_pair(Clock::duration::max(), Clock::duration::max());
+  auto bestMap = bestTable;
+  int64_t found = 0;
+  for (int i = 0; i < iterations; i++) {
+    auto start = Clock::now();
+    Eval::HashBag hash;
+    for (const auto &key : keys) {
+      hash.insert(*key.hash(), Eval::HashPair(key, key));
+    }
+    auto inserted = Clock::now();
+    for (const auto &key : lookups) {
+      found += hash.find(*key.hash(), key)->value().integer() == key.integer();
+    }
+    auto looked = Clock::now();
+    bestTable.first = std::min(bestTable.first, inserted - start);
+    bestTable.second = std::min(bestTable.second, looked - inserted);
+
+    start = Clock::now();
+    std::map<Eval::HashKey, Eval::HashPair> map;
+    for (const auto &key : keys) {
+      map.insert(std::make_pair(*key.hash(), Eval::HashPair(key, key)));
+    }
+    inserted = Clock::now();
+    for (const auto &key : lookups) {
+      found += map.find(*key.hash())->second.value().integer() == key.integer();
+    }
+    looked = Clock::now();
+    bestMap.first = std::min(bestMap.first, inserted - start);
+    bestMap.second = std::min(bestMap.second, looked - inserted);
+  }
+  if (found != int64_t(count) * iterations * 2) {
+    std::cerr << "hash lookups returned the wrong values" << std::endl;
+  }
+  report(fmt::format("hash insert {}", count), bestTable.first);
+  report(fmt::format("hash lookup {}", count), bestTable.second);
+  report(fmt::format("std::map insert {}", count), bestMap.first);
+  report(fmt::format("std::map lookup {}", count), bestMap.second);
+}
+
+// Lexes a source made of `count` identifiers and keywords, and separately
+// classifies the same words with lookupIdentity and with the std::map of
+// keywords it replaced.
+void benchLexer(int count, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto report = [count](const std::string &name, Clock::duration elapsed) {
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << fmt::format("{:<24} {:<4} {:>10.3f} ms  {:.1f}M idents/s",
+                             name, "c++", seconds * 1000,
+                             count / seconds / 1e6)
+              << std::endl;
+  };
+  const std::string words[] = {"let",   "value", "fn",   "counter", "if",
+                               "else",  "x",     "true", "result",  "while",
+                               "false", "return", "acc", "index",   "fib"};
+  std::mt19937_64 random(7919);
+  std::string input;
+  std::vector<std::string> identifiers;
+  for (int i = 0; i < count; i++) {
+    identifiers.push_back(words[random() % std::size(words)]);
+    input += identifiers.back() + " ";
+  }
+  const std::map<std::string, TokenType> keywords = {
+      {"fn", TokenType::FUNCTION},   {"let", TokenType::LET},
+      {"true", TokenType::TRUE},     {"false", TokenType::FALSE},
+      {"if", TokenType::IF},         {"else", TokenType::ELSE},
+      {"return", TokenType::RETURN}, {"while", TokenType::WHILE},
+  };
+  auto bestLex = Clock::duration::max();
+  auto bestLookup = bestLex;
+  auto bestMap = bestLex;
+  int64_t matched = 0;
+  for (int i = 0; i < iterations; i++) {
+    auto start = Clock::now();
+    Lexer lexer(input);
+    while (lexer.nextToken().type != TokenType::END_OF_FILE) {
+      matched++;
+    }
+    bestLex = std::min(bestLex, Clock::now() - start);
+
+    start = Clock::now();
+    for (const auto &identifier : identifiers) {
+      matched += lookupIdentity(identifier) != TokenType::IDENT;
+    }
+    bestLookup = std::min(bestLookup, Clock::now() - start);
+
+    start = Clock::now();
+    for (const auto &identifier : identifiers) {
+      auto lookup = keywords.find(std::string(identifier));
+      matched += lookup != keywords.end();
+    }
+    bestMap = std::min(bestMap, Clock::now() - start);
+  }
+  if (matched == 0) {
+    std::cerr << "lexer benchmark saw no tokens" << std::endl;
+  }
+  report(fmt::format("lex {}", count), bestLex);
+  report(fmt::format("keyword lookup {}", count), bestLookup);
+  report(fmt::format("map keywords {}", count), bestMap);
+}
+
+// A generated data file: one large array of long strings and numbers, one
+// element per indented line.
+std::string makeData(int count) {
+  std::mt19937_64 random(7919);
+  std::string input = "let data = [\n";
+  for (int i = 0; i < count; i++) {
+    input += "    \"" + std::string(20 + random() % 60, 'a' + i % 26) +
+             "\", " + std::to_string(random()) + ",\n";
+  }
+  input += "];\n";
+  return input;
+}
+
+// Prints the best of `iterations` runs of `run` as throughput over `input`.
+void benchData(const std::string &name, const std::string &input,
+               int iterations, const std::function<void()> &run) {
+  auto best = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::steady_clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::cout << fmt::format("{:<24} {:<4} {:>10.3f} ms  {:.0f} MB/s",
+                           fmt::format("{} {}MB", name, input.size() >> 20),
+                           "c++", seconds * 1000,
+                           input.size() / seconds / (1 << 20))
+            << std::endl;
+}
+
+// Lexing and parsing the data file, streaming and through a TokenBuffer.
+// The buffered parse is timed on its own, with the buffer already built.
+void benchLexData(int count, int iterations) {
+  auto input = makeData(count);
+  auto source = SourceText::fromString(input);
+  benchData("lex data", input, iterations, [&]() {
+    Lexer lexer(source);
+    while (lexer.nextToken().type != TokenType::END_OF_FILE) {
+    }
+  });
+  benchData("pre-lex data", input, iterations,
+            [&]() { TokenBuffer buffer(source); });
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  benchData(fmt::format("pre-lex data x{}", threads), input, iterations,
+            [&]() { TokenBuffer::parallel(source, threads); });
+  benchData("parse data", input, iterations, [&]() {
+    Parser parser(std::make_unique<Lexer>(source));
+    parser.parseProgram();
+  });
+  auto tokens = std::make_shared<const TokenBuffer>(source);
+  benchData("parse data buffer", input, iterations, [&]() {
+    Parser parser(tokens);
+    parser.parseProgram();
+  });
+}
+
+// Parses one short line at a time with a new Parser each, like the REPL.
+void benchParseLines(int count, int iterations) {
+  std::string line = "let x = a + b * c[1] - f(2, -d) == !e;";
+  auto best = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < count; n++) {
+      Parser parser(std::make_unique<Lexer>(line));
+      parser.parseProgram();
+    }
+    best = std::min(best, std::chrono::steady_clock::now() - start);
+  }
+  auto seconds = std::chrono::duration<double>(best).count();
+  std::cout << fmt::format("{:<24} {:<4} {:>10.3f} ms  {:.1f}K lines/s",
+                           fmt::format("parse lines {}", count), "c++",
+                           seconds * 1000, count / seconds / 1000)
+            << std::endl;
+}
+
+// A script of `count` small function definitions.
+std::string makeStatements(int count) {
+  std::string input;
+  for (int n = 0; n < count; n++) {
+    input += fmt::format(
+        "let f{} = fn(x) {{ if (x > {}) {{ [x, {{\"k\": x * 2}}] }} }};\n", n,
+        n);
+  }
+  return input;
+}
+
+// Parses a script of `count` statements, timing the parse and the teardown of
+// the resulting program separately.
+void benchParseStatements(int count, int iterations) {
+  auto source = SourceText::fromString(makeStatements(count));
+  auto bestParse = std::chrono::steady_clock::duration::max();
+  auto bestFree = std::chrono::steady_clock::duration::max();
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    auto program = Parser(std::make_unique<Lexer>(source)).parseProgram();
+    auto parsed = std::chrono::steady_clock::now();
+    program.reset();
+    auto freed = std::chrono::steady_clock::now();
+    bestParse = std::min(bestParse, parsed - start);
+    bestFree = std::min(bestFree, freed - parsed);
+  }
+  auto parse = std::chrono::duration<double>(bestParse).count();
+  auto free = std::chrono::duration<double>(bestFree).count();
+  std::cout << fmt::format("{:<24} {:<4} {:>10.3f} ms  free {:.3f} ms",
+                           fmt::format("parse statements {}", count), "c++",
+                           parse * 1000, free * 1000)
+            << std::endl;
+}
+
+// Counts the identifiers in a program through virtual visit calls.
+class IdentifierCounter : public AST::AbstractDispatcher {
+ public:
+  std::size_t count = 0;
+  void visitChild(AST::Node *node) {
+    if (node) {
+      node->visit(*this);
+    }
+  }
+  template <class Nodes>
+  void visitAll(const Nodes &nodes) {
+    for (auto *node : nodes) {
+      node->visit(*this);
+    }
+  }
+  void dispatch(AST::Node &) override {}
+  void dispatch(AST::Statement &) override {}
+  void dispatch(AST::Expression &) override {}
+  void dispatch(AST::Program &node) override {
+    this->visitAll(node.getStatements());
+  }
+  void dispatch(AST::Identifier &) override { this->count++; }
+  void dispatch(AST::IntegerLiteral &) override {}
+  void dispatch(AST::StringLiteral &) override {}
+  void dispatch(AST::Boolean &) override {}
+  void dispatch(AST::ArrayLiteral &node) override {
+    this->visitAll(node.getValues());
+  }
+  void dispatch(AST::HashLiteral &node) override {
+    for (const auto &pair : node.getPairs()) {
+      pair.first->visit(*this);
+      pair.second->visit(*this);
+    }
+  }
+  void dispatch(AST::IndexExpression &node) override {
+    this->visitChild(node.getLeft());
+    this->visitChild(node.getIndex());
+  }
+  void dispatch(AST::PrefixExpression &node) override {
+    this->visitChild(node.getRight());
+  }
+  void dispatch(AST::InfixExpression &node) override {
+    this->visitChild(node.getLeft());
+    this->visitChild(node.getRight());
+  }
+  void dispatch(AST::IfExpression &node) override {
+    this->visitChild(node.getCondition());
+    this->visitChild(node.getWhenTrue());
+    this->visitChild(node.getWhenFalse());
+  }
+  void dispatch(AST::WhileExpression &node) override {
+    this->visitChild(node.getBody());
+  }
+  void dispatch(AST::FunctionLiteral &node) override {
+    this->visitAll(node.getArguments());
+    this->visitChild(node.getBody());
+  }
+  void dispatch(AST::CallExpression &node) override {
+    this->visitChild(node.getFunction());
+    this->visitAll(node.getArguments());
+  }
+  void dispatch(AST::ReturnStatement &node) override {
+    this->visitChild(node.getReturnValue());
+  }
+  void dispatch(AST::ExpressionStatement &node) override {
+    this->visitChild(node.getExpression());
+  }
+  void dispatch(AST::LetStatement &node) override {
+    this->visitChild(node.getName());
+    this->visitChild(node.getValue());
+  }
+  void dispatch(AST::BlockStatement &node) override {
+    this->visitAll(node.getStatements());
+  }
+};
+
+// Counts the identifiers in a script of `count` statements by visiting the
+// AST, by recursing through the flat tree, and by one loop over its nodes.
+void benchWalk(int count, int iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto program = testProgramWithInput(makeStatements(count));
+  auto start = Clock::now();
+  auto tree = Flat::Tree::fromProgram(*program);
+  auto converted = Clock::now() - start;
+  std::size_t expected = 0;
+  auto report = [&](const std::string &name, std::size_t found,
+                    const std::function<std::size_t()> &walk) {
+    auto best = Clock::duration::max();
+    for (int i = 0; i < iterations; i++) {
+      start = Clock::now();
+      found = walk();
+      best = std::min(best, Clock::now() - start);
+    }
+    if (expected && found != expected) {
+      std::cerr << name << " counted the wrong identifiers" << std::endl;
+    }
+    expected = found;
+    std::cout << fmt::format(
+                     "{:<24} {:<4} {:>10.3f} ms", name, "c++",
+                     std::chrono::duration<double, std::milli>(best).count())
+              << std::endl;
+  };
+  report("walk ast", 0, [&]() {
+    IdentifierCounter counter;
+    program->visit(counter);
+    return counter.count;
+  });
+  report("walk flat", 0, [&]() {
+    std::size_t found = 0;
+    std::function<void(std::uint32_t)> walk = [&](std::uint32_t index) {
+      found += tree[index].kind == Flat::Kind::IDENTIFIER;
+      tree.forEachChild(index, walk);
+    };
+    walk(tree.root());
+    return found;
+  });
+  report("walk flat nodes", 0, [&]() {
+    std::size_t found = 0;
+    for (const auto &node : tree.nodes()) {
+      found += node.kind == Flat::Kind::IDENTIFIER;
+    }
+    return found;
+  });
+  std::cout << fmt::format(
+                   "{:<24} {:<4} {:>10.3f} ms  {} nodes", "flatten", "c++",
+                   std::chrono::duration<double, std::milli>(converted).count(),
+                   tree.nodes().size())
+            << std::endl;
+}
+
+// A generated library of `count` functions, only the last of which is called.
+std::string makeLibrary(int count) {
+  std::string input;
+  for (int n = 0; n < count; n++) {
+    input += fmt::format(
+        "let f{0} = fn(xs, n) {{\n"
+        "  let i = 0;\n"
+        "  let acc = {{\"total\": 0, \"seen\": []}};\n"
+        "  while {{\n"
+        "    if (i == n) {{ return acc; }};\n"
+        "    let acc = {{\"total\": acc[\"total\"] + xs[i] * {0},\n"
+        "                \"seen\": push(acc[\"seen\"], -xs[i])}};\n"
+        "    let i = i + 1;\n"
+        "  }}\n"
+        "}};\n",
+        n);
+  }
+  input += fmt::format("f{}([1, 2, 3], 3)[\"total\"]\n", count - 1);
+  return input;
+}
+
+// Loads the library by lexing it, parsing it eagerly and lazily, and lazily
+// or from its cache while also running the one call it makes.
+void benchLazyBodies(int count, int iterations) {
+  auto input = makeLibrary(count);
+  auto source = SourceText::fromString(input);
+  benchData("lex library", input, iterations, [&]() {
+    Lexer lexer(source);
+    while (lexer.nextToken().type != TokenType::END_OF_FILE) {
+    }
+  });
+  benchData("parse library", input, iterations, [&]() {
+    Parser(std::make_unique<Lexer>(source)).parseProgram();
+  });
+  benchData("parse library lazy", input, iterations, [&]() {
+    Parser(std::make_unique<Lexer>(source), FunctionBodies::LAZY)
+        .parseProgram();
+  });
+  benchData("run library lazy", input, iterations, [&]() {
+    auto program =
+        Parser(std::make_unique<Lexer>(source), FunctionBodies::LAZY)
+            .parseProgram();
+    auto env = std::make_shared<Env::Environment>();
+    if (ASTEvaluator::eval(*program, env).integer() != 6 * (count - 1)) {
+      std::cerr << "library benchmark got the wrong total" << std::endl;
+    }
+  });
+
+  auto path = std::filesystem::temp_directory_path() / "cmonkey-library.monkey";
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << input;
+  }
+  ProgramCache::load(path.string());
+  benchData("run library cached", input, iterations, [&]() {
+    auto loaded = ProgramCache::load(path.string());
+    auto env = std::make_shared<Env::Environment>();
+    if (!loaded.cached ||
+        ASTEvaluator::eval(*loaded.program, env).integer() !=
+            6 * (count - 1)) {
+      std::cerr << "library benchmark got the wrong total" << std::endl;
+    }
+  });
+  std::filesystem::remove(ProgramCache::cachePath(path.string()));
+  std::filesystem::remove(path);
+}
+
+// Loads a script of `count` statements by parsing it and from its cache.
+void benchProgramCache(int count, int iterations) {
+  auto path = std::filesystem::temp_directory_path() / "cmonkey-bench.monkey";
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << makeStatements(count);
+  }
+  auto cachePath = ProgramCache::cachePath(path.string());
+  auto best = [&](bool cached) {
+    auto best = std::chrono::steady_clock::duration::max();
+    for (int i = 0; i < iterations; i++) {
+      if (!cached) {
+        std::filesystem::remove(cachePath);
+      }
+      auto start = std::chrono::steady_clock::now();
+      auto loaded = ProgramCache::load(path.string());
+      best = std::min(best, std::chrono::steady_clock::now() - start);
+      if (!loaded.program || loaded.cached != cached) {
+        std::cerr << "program cache benchmark loaded the wrong way"
+                  << std::endl;
+      }
+    }
+    return std::chrono::duration<double, std::milli>(best).count();
+  };
+  auto parsed = best(false);
+  auto cached = best(true);
+  std::cout << fmt::format("{:<24} {:<4} {:>10.3f} ms  cached {:.3f} ms",
+                           fmt::format("load statements {}", count), "c++",
+                           parsed, cached)
+            << std::endl;
+  std::filesystem::remove(cachePath);
+  std::filesystem::remove(path);
+}
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 5;
+  bench("fib(25)", FIB, "fib(25)", iterations);
+  bench("range(1,1000)", RANGE, "range(1,1000)", iterations);
+  bench("range(1,50000)", RANGE, "range(1,50000)", iterations);
+  bench("sprint 8MB", GROW, "len(grow(\"a\", 23))", iterations);
+  bench("literals(20000)", LITERALS, "literals(20000, 0)", iterations);
+  benchHash(1000000, iterations);
+  benchLexer(1000000, iterations);
+  benchLexData(500000, iterations);
+  benchParseLines(100000, iterations);
+  benchParseStatements(100000, iterations);
+  benchWalk(100000, iterations);
+  benchProgramCache(100000, iterations);
+  benchLazyBodies(20000, iterations);
+}
@@ -1,13 +1,22 @@
 #include <catch2/catch.hpp>
+#include <constant_folder.hpp>
 #include <env.hpp>
 #include <eval.hpp>
+#include <filesystem>
+#include <flat.hpp>
+#include <fstream>
+#include <gc.hpp>
 #include <lexer.hpp>
 #include <parser.hpp>
+#include <print_dispatcher.hpp>
+#include <program_cache.hpp>
+#include <resolver.hpp>
 #include <test_eval_helpers.hpp>
 #include <test_helpers.hpp>
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 TEST_CASE("Integer eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<int64_t> pairs[] = {
       {"5", 5},
       {"123", 123},
@@ -22,13 +31,13 @@ TEST_CASE("Integer eval testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
 };
 
 TEST_CASE("Boolean eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<bool> pairs[] = {
       {"true", true},
       {"false", false},
@@ -46,26 +55,26 @@ TEST_CASE("Boolean eval testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testBooleanBag(bag, pair.expected);
   }
 };
 
 TEST_CASE("Bang eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<bool> pairs[] = {
       {"!true", false}, {"!false", true},   {"!5", false},
       {"!!true", true}, {"!!false", false},
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testBooleanBag(bag, pair.expected);
   }
 };
 
 TEST_CASE("If else testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<int64_t> pairs[] = {
       {"if (true) { 10 }", 10},
 
@@ -77,21 +86,20 @@ TEST_CASE("If else testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
   // Expecting nulls
   Pair<int64_t> pairs2[] = {{"if (false) { 10 }", 1}, {"if (1 > 2) { 10 }", 1}};
   for (const auto& pair : pairs2) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testNullBag(bag);
   }
 };
 
 TEST_CASE("Return statement testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<int64_t> pairs[] = {
       {"return 10;", 10},
       {"return 9; 10", 9},
@@ -108,13 +116,13 @@ TEST_CASE("Return statement testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
 };
 
 TEST_CASE("Error testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<std::string> pairs[] = {
       {"5 + true;", "type mismatch: INTEGER + BOOLEAN"},
       {"5 + true; 5;", "type mismatch: INTEGER + BOOLEAN"},
@@ -138,13 +146,13 @@ TEST_CASE("Error testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testErrorBag(bag, pair.expected);
   }
 }
 
 TEST_CASE("Let statement testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   //  spdlog::stdout_color_mt(EVAL_LOGGER);
   Pair<int64_t> pairs[] = {
       {"let a = 5; a;", 5},
@@ -154,13 +162,13 @@ TEST_CASE("Let statement testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
 }
 
 TEST_CASE("Index evaluation testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   //  spdlog::stdout_color_mt(EVAL_LOGGER);
   Pair<int64_t> pairs[] = {
       {"[1,2,3][0]", 1},
@@ -171,24 +179,72 @@ TEST_CASE("Index evaluation testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
 }
 
+TEST_CASE("Hash index testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  Pair<int64_t> pairs[] = {
+      {"{\"a\": 1, \"b\": 2}[\"b\"]", 2},
+      {"{1: 10, true: 20}[1]", 10},
+      {"{1: 10, true: 20}[true]", 20},
+      {"{1: 10, 1: 20}[1]", 10},
+      {"let key = \"k\"; {key: 5}[\"k\"]", 5},
+  };
+  for (const auto& pair : pairs) {
+    auto program = testProgramWithInput(pair.input);
+    auto bag = evalWithEngine(engine, *program);
+    testIntegerBag(bag, pair.expected);
+  }
+}
+
+TEST_CASE("Hash table testing", "[eval]") {
+  Eval::HashBag hash;
+  for (int64_t i = 0; i < 10000; i++) {
+    auto key = Eval::Value::fromInteger(i);
+    REQUIRE(hash.insert(*key.hash(),
+                        Eval::HashPair(key, Eval::Value::fromInteger(i * 2))));
+  }
+  REQUIRE(hash.pairs().size() == 10000);
+  for (int64_t i = 0; i < 10000; i += 101) {
+    auto key = Eval::Value::fromInteger(i);
+    auto pair = hash.find(*key.hash(), key);
+    REQUIRE(pair);
+    REQUIRE(pair->value().integer() == i * 2);
+  }
+  auto missing = Eval::Value::fromInteger(-1);
+  REQUIRE_FALSE(hash.find(*missing.hash(), missing));
+
+  Eval::StringBag left("key");
+  Eval::StringBag right("key");
+  REQUIRE(left.hash()->mix() == right.hash()->mix());
+
+  // Distinct keys whose hashes collide are kept apart.
+  Eval::HashKey collision(Eval::Type::STRING_OBJ, 42);
+  Eval::Value first = std::make_shared<Eval::StringBag>("first");
+  Eval::Value second = std::make_shared<Eval::StringBag>("second");
+  REQUIRE(hash.insert(collision, Eval::HashPair(first, Eval::TRUE_VALUE)));
+  REQUIRE(hash.insert(collision, Eval::HashPair(second, Eval::FALSE_VALUE)));
+  testBooleanBag(hash.find(collision, first)->value(), true);
+  testBooleanBag(hash.find(collision, second)->value(), false);
+  REQUIRE_FALSE(hash.insert(collision, Eval::HashPair(first, Eval::NULL_VALUE)));
+}
+
 TEST_CASE("Index evaluation testing invalid index", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   //  spdlog::stdout_color_mt(EVAL_LOGGER);
   std::string vals[] = {"[1,2,3][-1];", "[1,2,3][3];"};
   for (const auto& val : vals) {
     auto program = testProgramWithInput(val);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testNullBag(bag);
   }
 }
 
 TEST_CASE("String eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   //  spdlog::stdout_color_mt(EVAL_LOGGER);
   Pair<std::string> pairs[] = {
       {"let a = \"test123\"; a;", "test123"},
@@ -198,13 +254,13 @@ TEST_CASE("String eval testing", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testStringBag(bag, pair.expected);
   }
 }
 
 TEST_CASE("Array builtins int", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   Pair<int64_t> pairs[] = {
       {"len([1,2,3,4])", 4},
       {"len([])", 0},
@@ -212,21 +268,20 @@ TEST_CASE("Array builtins int", "[eval]") {
   };
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
 }
 
 TEST_CASE("Array builtins array", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   std::string inputs[] = {
       {"tail([1,2,3,4,5])"},
       {"push([2,3,4], 5)"},
   };
   for (const auto& input : inputs) {
     auto program = testProgramWithInput(input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
     auto arr = testArrayBag(bag, 4);
     testIntegerBag(arr->values().at(0), 2);
     testIntegerBag(arr->values().at(1), 3);
@@ -235,31 +290,72 @@ TEST_CASE("Array builtins array", "[eval]") {
   }
 }
 
+TEST_CASE("Persistent vector testing", "[eval]") {
+  Eval::PersistentVector<Eval::Value> values;
+  for (int64_t i = 0; i < 40000; i++) {
+    values = values.push_back(Eval::Value::fromInteger(i));
+  }
+  REQUIRE(values.size() == 40000);
+  for (int64_t i = 0; i < 40000; i += 997) {
+    REQUIRE(values[i].integer() == i);
+  }
+
+  // Versions branching off the same vector don't see each other's elements.
+  auto left = values.push_back(Eval::Value::fromInteger(-1));
+  auto right = values.push_back(Eval::Value::fromInteger(-2));
+  REQUIRE(values.size() == 40000);
+  REQUIRE(left[40000].integer() == -1);
+  REQUIRE(right[40000].integer() == -2);
+
+  auto rest = right.drop_front(39999);
+  REQUIRE(rest.size() == 2);
+  REQUIRE(rest.front().integer() == 39999);
+  REQUIRE(rest.push_back(Eval::Value::fromInteger(7))[2].integer() == 7);
+  REQUIRE(rest.drop_front(2).empty());
+}
+
+TEST_CASE("Large array builtins", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  auto input = R"(
+let range = fn(start, end, res) {
+  if (start == end) { res } else { range(start + 1, end, push(res, start)) }
+};
+let sum = fn(arr, total) {
+  if (len(arr) == 0) { total } else { sum(tail(arr), total + head(arr)) }
+};
+let numbers = range(0, 50000, []);
+sum(numbers, 0) + numbers[49999]
+)";
+  auto program = testProgramWithInput(input);
+  testIntegerBag(evalWithEngine(engine, *program), 1249975000 + 49999);
+}
+
 TEST_CASE("While eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   std::string input =
       "let x = 1; while { if ( x > 3 ) { return x; }; let x = x + 1; }; x ";
   auto program = testProgramWithInput(input);
-  auto env = std::make_shared<Env::Environment>();
-  auto bag = ASTEvaluator::eval(*program, env);
+  auto bag = evalWithEngine(engine, *program);
   testIntegerBag(bag, 4);
 }
 
 TEST_CASE("Array eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   // spdlog::stdout_color_mt(EVAL_LOGGER);
   auto input = "[1, 2 + 2, 3 * 3]";
   auto program = testProgramWithInput(input);
-  auto env = std::make_shared<Env::Environment>();
-  auto bag = ASTEvaluator::eval(*program, env);
+  auto bag = evalWithEngine(engine, *program);
   auto arr = testArrayBag(bag, 3);
   auto itr = arr->values().begin();
-  testIntegerBag(itr->get(), 1);
+  testIntegerBag(*itr, 1);
   itr++;
-  testIntegerBag(itr->get(), 4);
+  testIntegerBag(*itr, 4);
   itr++;
-  testIntegerBag(itr->get(), 9);
+  testIntegerBag(*itr, 9);
 }
 
 TEST_CASE("Function eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
   //  spdlog::stdout_color_mt(EVAL_LOGGER);
   Pair<int64_t> pairs[] = {
       {"let identity = fn(x) { x;}; identity(12);", 12},
@@ -280,8 +376,444 @@ TEST_CASE("Function eval testing", "[eval]") {
 
   for (const auto& pair : pairs) {
     auto program = testProgramWithInput(pair.input);
-    auto env = std::make_shared<Env::Environment>();
-    auto bag = ASTEvaluator::eval(*program, env);
+    auto bag = evalWithEngine(engine, *program);
+    testIntegerBag(bag, pair.expected);
+  }
+}
+TEST_CASE("Tail call testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  Pair<int64_t> pairs[] = {
+      {"let count = fn(n, acc) { if (n == 0) { acc } else { count(n - 1, acc "
+       "+ 1) } }; count(100000, 0)",
+       100000},
+      {"let count = fn(n) { if (n == 0) { return 7; }; return count(n - 1); "
+       "}; count(100000)",
+       7},
+      {"let even = fn(n) { if (n == 0) { true } else { odd(n - 1) } }; let "
+       "odd = fn(n) { if (n == 0) { false } else { even(n - 1) } }; if "
+       "(even(100001)) { 1 } else { 0 }",
+       0},
+      {"let f = fn(n) { let r = if (n > 0) { f(n - 1) } else { 0 }; r + 1 }; "
+       "f(10)",
+       11},
+      {"let add = fn(x, y) { x + y }; let f = fn(x) { add(x) }; f(1)(2)", 3},
+  };
+
+  for (const auto& pair : pairs) {
+    auto program = testProgramWithInput(pair.input);
+    auto bag = evalWithEngine(engine, *program);
+    testIntegerBag(bag, pair.expected);
+  }
+}
+
+TEST_CASE("Scope resolution testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  Pair<int64_t> pairs[] = {
+      {"let x = 1; let f = fn() { let y = x; let x = 2; y + x }; f()", 3},
+      {"let add3 = fn(a, b, c) { let s = a + b; s + c }; let p = add3(1); let "
+       "q = p(2); q(3) + p(5, 6)",
+       18},
+      {"let f = fn(n) { let i = 0; let s = 0; while { if (i == n) { return s "
+       "}; let s = s + i; let i = i + 1; } }; f(5)",
+       10},
+      {"let x = 5; let f = fn(a) { fn(b) { fn(c) { a + b + c + x } } }; "
+       "f(1)(2)(3)",
+       11},
+      {"let f = fn(len) { len }; f(3)", 3},
+  };
+
+  for (const auto& pair : pairs) {
+    auto program = testProgramWithInput(pair.input);
+    auto bag = evalWithEngine(engine, *program);
     testIntegerBag(bag, pair.expected);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Resolver testing", "[eval]") {
+  auto program = testProgramWithInput(
+      "let f = fn(a) { let b = a; fn(c) { let d = c; a + b + d + g } };");
+  Resolver::resolve(*program);
+  auto names = [](const std::vector<Intern::Symbol> &symbols) {
+    std::vector<std::string> names;
+    for (auto symbol : symbols) {
+      names.push_back(symbol.name());
+    }
+    return names;
+  };
+  auto let =
+      dynamic_cast<AST::LetStatement *>(program->getStatements().front());
+  REQUIRE(let);
+  REQUIRE_FALSE(let->getName()->isResolved());
+  auto outer = dynamic_cast<AST::FunctionLiteral *>(let->getValue());
+  REQUIRE(outer);
+  REQUIRE(names(*outer->getLocals()) == std::vector<std::string>{"a", "b"});
+
+  auto statement = dynamic_cast<AST::ExpressionStatement *>(
+      outer->getBody()->getStatements().back());
+  auto inner =
+      dynamic_cast<AST::FunctionLiteral *>(statement->getExpression());
+  REQUIRE(inner);
+  REQUIRE(names(*inner->getLocals()) == std::vector<std::string>{"c", "d"});
+
+  // ((a + b) + d) + g
+  statement = dynamic_cast<AST::ExpressionStatement *>(
+      inner->getBody()->getStatements().back());
+  std::vector<AST::Identifier *> identifiers;
+  auto expression = statement->getExpression();
+  while (auto infix = dynamic_cast<AST::InfixExpression *>(expression)) {
+    identifiers.insert(identifiers.begin(),
+                       dynamic_cast<AST::Identifier *>(infix->getRight()));
+    expression = infix->getLeft();
+  }
+  identifiers.insert(identifiers.begin(),
+                     dynamic_cast<AST::Identifier *>(expression));
+  REQUIRE(identifiers.size() == 4);
+  REQUIRE(identifiers[0]->isResolved());
+  REQUIRE(identifiers[0]->getDepth() == 1);
+  REQUIRE(identifiers[0]->getSlot() == 0);
+  REQUIRE(identifiers[1]->getDepth() == 1);
+  REQUIRE(identifiers[1]->getSlot() == 1);
+  REQUIRE(identifiers[2]->getDepth() == 0);
+  REQUIRE(identifiers[2]->getSlot() == 1);
+  REQUIRE_FALSE(identifiers[3]->isResolved());
+}
+
+TEST_CASE("Forward reference to a later local", "[eval]") {
+  auto program = testProgramWithInput(
+      "let f = fn() { let a = fn() { b() }; let b = fn() { 5 }; a() }; f()");
+  auto env = std::make_shared<Env::Environment>();
+  testIntegerBag(ASTEvaluator::eval(*program, env), 5);
+}
+
+TEST_CASE("Immediate value testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  auto program = testProgramWithInput("9223372036854775807");
+  auto value = evalWithEngine(engine, *program);
+  testIntegerBag(value, 9223372036854775807);
+  REQUIRE_FALSE(value.isHeap());
+
+  program = testProgramWithInput("let h = {1: \"one\", true: \"yes\"}; h[true]");
+  testStringBag(evalWithEngine(engine, *program), "yes");
+
+  Eval::Value moved = Eval::Value::fromBoolean(true);
+  auto target = std::move(moved);
+  testBooleanBag(target, true);
+  REQUIRE_FALSE(moved);
+}
+
+TEST_CASE("Function outlives its program", "[eval]") {
+  auto env = std::make_shared<Env::Environment>();
+  auto program = testProgramWithInput("let add = fn(a, b) { a + b };");
+  ASTEvaluator::eval(*program, env);
+  // Token literals point into the source the first program was parsed from.
+  program = testProgramWithInput("add");
+  auto fn = ASTEvaluator::eval(*program, env);
+  program.reset();
+  REQUIRE(fn.inspect() == "fn(a, b) { \n  (a + b)\n}");
+  program = testProgramWithInput("add(2, 3)");
+  testIntegerBag(ASTEvaluator::eval(*program, env), 5);
+}
+
+TEST_CASE("Garbage collection testing", "[eval]") {
+  auto env = std::make_shared<Env::Environment>();
+  auto program = testProgramWithInput(
+      "let make = fn(x) { let get = fn() { x }; get }; let keep = make(5);");
+  ASTEvaluator::eval(*program, env);
+  GC::Heap::collect();
+  auto baseline = GC::Heap::live();
+
+  program = testProgramWithInput("make(1); make(2); make(3);");
+  ASTEvaluator::eval(*program, env);
+  REQUIRE(GC::Heap::live() > baseline);
+  REQUIRE(GC::Heap::collect() > 0);
+  REQUIRE(GC::Heap::live() == baseline);
+
+  // Closures that are still referenced survive with their environment.
+  program = testProgramWithInput("keep()");
+  testIntegerBag(ASTEvaluator::eval(*program, env), 5);
+}
+
+TEST_CASE("Program cache testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  auto path = std::filesystem::temp_directory_path() / "cmonkey-cache.monkey";
+  auto cachePath = ProgramCache::cachePath(path.string());
+  std::filesystem::remove(cachePath);
+  auto writeScript = [&](const std::string &text) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+  };
+  auto print = [](AST::Program &program) {
+    std::stringstream ss;
+    ASTPrinter::write([&](std::string message) { ss << message; }, program);
+    return ss.str();
+  };
+  writeScript(
+      "let add = fn(a, b) { a + b }; let xs = [1, add(2, 3), -4];"
+      "let h = {\"k\": \"v\", true: !false}; let i = 0;"
+      "let f = fn(n) { while { if (i == n) { return i; }; let i = i + 1; } };"
+      "if (xs[1] > 4) { h[\"k\"] + \"w\" } else { f(3) }");
+
+  auto parsed = ProgramCache::load(path.string());
+  REQUIRE(parsed.program);
+  REQUIRE_FALSE(parsed.cached);
+  REQUIRE(std::filesystem::exists(cachePath));
+
+  auto cached = ProgramCache::load(path.string());
+  REQUIRE(cached.program);
+  REQUIRE(cached.cached);
+  REQUIRE(print(*cached.program) == print(*parsed.program));
+  auto value = evalWithEngine(engine, *cached.program);
+  testStringBag(value, "vw");
+
+  // Resolved identifiers keep their addresses.
+  Resolver::resolve(*parsed.program);
+  REQUIRE(ProgramCache::write(cachePath, *parsed.program));
+  cached = ProgramCache::load(path.string());
+  REQUIRE(cached.cached);
+  auto cachedTree = Flat::Tree::fromProgram(*cached.program);
+  auto parsedTree = Flat::Tree::fromProgram(*parsed.program);
+  REQUIRE(cachedTree.toString() == parsedTree.toString());
+  const auto &left = cachedTree.identifiers();
+  const auto &right = parsedTree.identifiers();
+  REQUIRE(left.size() == right.size());
+  for (std::size_t i = 0; i < left.size(); i++) {
+    REQUIRE(left[i].resolved == right[i].resolved);
+    REQUIRE(left[i].depth == right[i].depth);
+    REQUIRE(left[i].slot == right[i].slot);
+  }
+
+  // Changing the script makes the cache stale.
+  writeScript("let x = 5; x * 2");
+  auto source = SourceText::fromFile(path.string());
+  REQUIRE_FALSE(ProgramCache::read(cachePath, source));
+  auto reparsed = ProgramCache::load(path.string());
+  REQUIRE_FALSE(reparsed.cached);
+  testIntegerBag(evalWithEngine(engine, *reparsed.program), 10);
+  REQUIRE(ProgramCache::read(cachePath, source));
+
+  // Damaged caches are ignored.
+  auto size = std::filesystem::file_size(cachePath);
+  {
+    std::fstream file(cachePath, std::ios::binary | std::ios::in |
+                                     std::ios::out);
+    file.seekp(static_cast<std::streamoff>(size - 1));
+    file.put('\x7f');
+  }
+  std::filesystem::resize_file(cachePath, size - 8);
+  REQUIRE_FALSE(ProgramCache::read(cachePath, source));
+  {
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    file << "MONKEYC";
+  }
+  REQUIRE_FALSE(ProgramCache::read(cachePath, source));
+  reparsed = ProgramCache::load(path.string());
+  REQUIRE_FALSE(reparsed.cached);
+  testIntegerBag(evalWithEngine(engine, *reparsed.program), 10);
+
+  // Scripts with errors aren't cached.
+  std::filesystem::remove(cachePath);
+  writeScript("let = 5;");
+  auto failed = ProgramCache::load(path.string());
+  REQUIRE(failed.source);
+  REQUIRE_FALSE(failed.program);
+  REQUIRE_FALSE(failed.errors.empty());
+  REQUIRE_FALSE(std::filesystem::exists(cachePath));
+
+  std::filesystem::remove(path);
+  REQUIRE_FALSE(ProgramCache::load(path.string()).source);
+}
+
+TEST_CASE("Cached function body testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  auto path =
+      std::filesystem::temp_directory_path() / "cmonkey-cache-bodies.monkey";
+  auto cachePath = ProgramCache::cachePath(path.string());
+  std::filesystem::remove(cachePath);
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "let add = fn(a, b) { let twice = fn(x) { x * 2 }; twice(a) + b };"
+            "let unused = fn() { [1, 2] };"
+            "add(3, 4)";
+  }
+  auto parsed = ProgramCache::load(path.string());
+  REQUIRE(parsed.program);
+  auto tree = Flat::Tree::fromProgram(*parsed.program);
+
+  // Only the top level is built on load; bodies follow when they're needed.
+  auto cached = ProgramCache::load(path.string());
+  REQUIRE(cached.cached);
+  const auto &deferred = cached.program->getArena().deferred();
+  REQUIRE(deferred.size() == 2);
+  REQUIRE(deferred[0]->isDeferred());
+  REQUIRE(deferred[1]->isDeferred());
+  testIntegerBag(evalWithEngine(engine, *cached.program), 10);
+  REQUIRE_FALSE(deferred[0]->isDeferred());
+  REQUIRE(deferred.size() == 3);
+  REQUIRE(Parser::validate(*cached.program).empty());
+  REQUIRE(Flat::Tree::fromProgram(*cached.program).toString() ==
+          tree.toString());
+
+  // A body that's damaged in the file fails when it's called, not on load.
+  std::uint32_t body = Flat::NONE;
+  for (const auto &node : tree.nodes()) {
+    if (node.kind == Flat::Kind::FUNCTION) {
+      body = node.c;
+      break;
+    }
+  }
+  REQUIRE(body != Flat::NONE);
+  {
+    // Nodes start right after the 56-byte header, and a node starts with
+    // its kind.
+    std::fstream file(cachePath, std::ios::binary | std::ios::in |
+                                     std::ios::out);
+    file.seekp(static_cast<std::streamoff>(56 + sizeof(Flat::Node) * body));
+    file.put(static_cast<char>(Flat::Kind::INTEGER));
+  }
+  cached = ProgramCache::load(path.string());
+  REQUIRE(cached.cached);
+  auto error = evalWithEngine(engine, *cached.program);
+  REQUIRE(error.type() == Eval::Type::ERROR_OBJ);
+  REQUIRE(error.inspect().find("corrupt program cache") != std::string::npos);
+  auto errors = Parser::validate(*cached.program);
+  REQUIRE(errors.size() == 1);
+  REQUIRE(errors.front().message == "corrupt program cache");
+
+  std::filesystem::remove(cachePath);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Lazy function body eval testing", "[eval]") {
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  std::string inputs[] = {
+      "let add = fn(a, b) { a + b }; add(2, 3)",
+      "let f = fn(n) { if (n < 2) { n } else { f(n - 1) + f(n - 2) } }; f(10)",
+      "let make = fn(x) { let y = x * 2; fn(z) { x + y + z } }; make(1)(2)",
+      "let get = fn() { later }; let later = 7; get()",
+      "let add = fn(a, b, c) { a + b + c }; let add1 = add(1); add1(2, 3)",
+      "let f = fn(n) { let i = 0; while { if (i == n) { return i; }; "
+      "let i = i + 1; } }; f(4)",
+      "let h = {\"k\": fn(x) { {\"v\": x} }}; h[\"k\"](3)[\"v\"]",
+      "let f = fn() { fn() { 1 } }; f",
+  };
+  for (const auto &input : inputs) {
+    auto eager = testProgramWithInput(input);
+    auto lazy = testProgramWithInput(input, FunctionBodies::LAZY);
+    REQUIRE(evalWithEngine(engine, *lazy).inspect() ==
+            evalWithEngine(engine, *eager).inspect());
+  }
+
+  // A body with syntax errors only fails if the function is called.
+  auto program = testProgramWithInput(
+      "let broken = fn() { let = 1; }; let ok = fn() { 5 }; ok()",
+      FunctionBodies::LAZY);
+  if (engine == Engine::AST) {
+    testIntegerBag(evalWithEngine(engine, *program), 5);
+    program = testProgramWithInput("let broken = fn() { let = 1; }; broken()",
+                                   FunctionBodies::LAZY);
+  }
+  auto value = evalWithEngine(engine, *program);
+  REQUIRE(value.type() == Eval::Type::ERROR_OBJ);
+  REQUIRE(value.inspect().find("syntax error in function body: ") !=
+          std::string::npos);
+}
+
+TEST_CASE("Lazy function resolver testing", "[eval]") {
+  auto program = testProgramWithInput(
+      "let f = fn(a) { let b = a; fn(c) { a + b + c } };",
+      FunctionBodies::LAZY);
+  Resolver::resolve(*program);
+  auto let =
+      dynamic_cast<AST::LetStatement *>(program->getStatements().front());
+  auto outer = dynamic_cast<AST::FunctionLiteral *>(let->getValue());
+  REQUIRE(outer->isDeferred());
+  REQUIRE_FALSE(outer->getLocals());
+  REQUIRE(outer->getEnclosingScopes()->empty());
+
+  Resolver::resolveDeferred(*outer);
+  REQUIRE_FALSE(outer->getEnclosingScopes());
+  REQUIRE(outer->getLocals()->size() == 2);
+  auto statement = dynamic_cast<AST::ExpressionStatement *>(
+      outer->getBody()->getStatements().back());
+  auto inner =
+      dynamic_cast<AST::FunctionLiteral *>(statement->getExpression());
+  REQUIRE(inner->isDeferred());
+  const auto &scopes = *inner->getEnclosingScopes();
+  REQUIRE(scopes.size() == 1);
+  REQUIRE(scopes[0].size() == 2);
+  REQUIRE(scopes[0][1].name() == "b");
+
+  Resolver::resolveDeferred(*inner);
+  REQUIRE(inner->getLocals()->size() == 1);
+  // (a + b) + c
+  statement = dynamic_cast<AST::ExpressionStatement *>(
+      inner->getBody()->getStatements().back());
+  auto sum = dynamic_cast<AST::InfixExpression *>(statement->getExpression());
+  auto left = dynamic_cast<AST::InfixExpression *>(sum->getLeft());
+  auto b = dynamic_cast<AST::Identifier *>(left->getRight());
+  auto c = dynamic_cast<AST::Identifier *>(sum->getRight());
+  REQUIRE(b->isResolved());
+  REQUIRE(b->getDepth() == 1);
+  REQUIRE(b->getSlot() == 1);
+  REQUIRE(c->getDepth() == 0);
+  REQUIRE(c->getSlot() == 0);
+}
+
+TEST_CASE("Constant folding testing", "[eval]") {
+  Pair<std::string> folded[] = {
+      {"1 + 2 * 3", "7"},
+      {"-(4 - 9)", "5"},
+      {"!(1 < 2)", "false"},
+      {"\"a\" + \"b\" + \"c\"", "abc"},
+      {"[1, 2 + 3, \"x\"]", "[1, 5, x]"},
+      {"{\"a\": 1, 2: [3], 2: 4}", "{a: 1, 2: [3]}"},
+      {"[1, 2][1] * 10", "20"},
+      {"{true: \"t\"}[1 == 1]", "t"},
+  };
+  for (const auto &pair : folded) {
+    auto program = testProgramWithInput(pair.input);
+    ConstantFolder::fold(*program);
+    auto statement = dynamic_cast<AST::ExpressionStatement *>(
+        program->getStatements().front());
+    auto constant = statement->getExpression()->getConstant();
+    REQUIRE(constant);
+    REQUIRE(constant->inspect() == pair.expected);
+  }
+
+  // Anything that depends on a binding or fails is left for run time.
+  std::string unfolded[] = {"x + 1", "[1, x]", "{x: 1}", "1 / 0",
+                            "\"a\" - \"b\"", "-true", "[1][\"a\"]"};
+  for (const auto &input : unfolded) {
+    auto program = testProgramWithInput(input);
+    ConstantFolder::fold(*program);
+    auto statement = dynamic_cast<AST::ExpressionStatement *>(
+        program->getStatements().front());
+    REQUIRE_FALSE(statement->getExpression()->getConstant());
+  }
+
+  auto engine = GENERATE(Engine::AST, Engine::VM);
+  auto program = testProgramWithInput("1 / 0");
+  testErrorBag(evalWithEngine(engine, *program),
+               "divide by zero exception: 1/0");
+  program = testProgramWithInput(
+      "let f = fn(x) { let s = \"n\" + \"=\"; [s, x * (2 + 3)] }; "
+      "[f(1)[0], len(f(2)), f(3)[1], {\"k\": [4 + 4]}[\"k\"][0]]");
+  REQUIRE(evalWithEngine(engine, *program).inspect() == "[n=, 2, 15, 8]");
+
+  // Constant literals are built once and shared by every evaluation.
+  auto env = std::make_shared<Env::Environment>();
+  program = testProgramWithInput(
+      "let s = fn() { \"str\" }; let a = fn() { [1, [2], {3: \"4\"}] };");
+  ASTEvaluator::eval(*program, env);
+  program = testProgramWithInput("s()");
+  auto first = ASTEvaluator::eval(*program, env);
+  auto second = ASTEvaluator::eval(*program, env);
+  REQUIRE(first.bag() == second.bag());
+  program = testProgramWithInput("a()");
+  first = ASTEvaluator::eval(*program, env);
+  auto live = GC::Heap::live();
+  second = ASTEvaluator::eval(*program, env);
+  REQUIRE(first.bag() == second.bag());
+  REQUIRE(GC::Heap::live() == live);
+  REQUIRE(second.inspect() == "[1, [2], {3: 4}]");
+}
@@ -1,5 +1,12 @@
 #include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
 #include <lexer.hpp>
+#include <random>
+#include <scan.hpp>
+#include <thread>
+#include <token_buffer.hpp>
+#include <trace.hpp>
 
 struct Pair {
   TokenType type;
@@ -81,8 +88,8 @@ while(true);
   auto lexer = Lexer(input);
   for (const Pair &pair : testPairs) {
     auto tok = lexer.nextToken();
-    REQUIRE(tokenTypeToString(tok->type) == tokenTypeToString(pair.type));
-    REQUIRE(tok->literal == pair.literal);
+    REQUIRE(tokenTypeToString(tok.type) == tokenTypeToString(pair.type));
+    REQUIRE(tok.literal == pair.literal);
   }
 };
 
@@ -132,8 +139,8 @@ if (5 < 10) {
   auto lexer = Lexer(input);
   for (const Pair &pair : testPairs) {
     auto tok = lexer.nextToken();
-    REQUIRE(tokenTypeToString(tok->type) == tokenTypeToString(pair.type));
-    REQUIRE(tok->literal == pair.literal);
+    REQUIRE(tokenTypeToString(tok.type) == tokenTypeToString(pair.type));
+    REQUIRE(tok.literal == pair.literal);
   }
 }
 TEST_CASE("Multichar token parsing", "[lexer]") {
@@ -162,7 +169,314 @@ let seven = 7;
   auto lexer = Lexer(input);
   for (const Pair &pair : testPairs) {
     auto tok = lexer.nextToken();
-    REQUIRE(tokenTypeToString(tok->type) == tokenTypeToString(pair.type));
-    REQUIRE(tok->literal == pair.literal);
+    REQUIRE(tokenTypeToString(tok.type) == tokenTypeToString(pair.type));
+    REQUIRE(tok.literal == pair.literal);
   }
 };
+
+TEST_CASE("Tracing testing", "[lexer]") {
+  auto logger = Trace::logger("tracing-test");
+  int built = 0;
+  auto argument = [&]() {
+    built++;
+    return "argument";
+  };
+  TRACE_INFO(logger, "{}", argument());
+  REQUIRE(built == 0);
+
+  logger->set_level(spdlog::level::info);
+  TRACE_INFO(logger, "{}", argument());
+  REQUIRE(built == (CMONKEY_TRACE_LEVEL <= SPDLOG_LEVEL_INFO ? 1 : 0));
+
+  // Threads asking for a logger nobody registered all get the same one.
+  std::vector<std::shared_ptr<spdlog::logger>> loggers(8);
+  std::vector<std::thread> threads;
+  for (auto &shared : loggers) {
+    threads.emplace_back(
+        [&shared]() { shared = Trace::logger("tracing-threads-test"); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &shared : loggers) {
+    REQUIRE(shared == loggers.front());
+  }
+
+  spdlog::drop(LEXER_LOGGER);
+  auto source = SourceText::fromString(std::string(4096, ' ') + "let x;");
+  REQUIRE(TokenBuffer::parallel(source, 8).size() == 4);
+}
+
+TEST_CASE("Token location testing", "[lexer]") {
+  auto lexer = Lexer("let x = 5;\n// comment\n  x == 5;");
+  const auto &source = lexer.getSource();
+
+  struct Expected {
+    TokenType type;
+    std::string literal;
+    std::uint64_t line;
+    std::uint64_t column;
+  };
+  Expected expected[] = {
+      {TokenType::LET, "let", 1, 0},      {TokenType::IDENT, "x", 1, 4},
+      {TokenType::ASSIGN, "=", 1, 6},     {TokenType::INTEGER, "5", 1, 8},
+      {TokenType::SEMICOLON, ";", 1, 9},  {TokenType::IDENT, "x", 3, 2},
+      {TokenType::EQ, "==", 3, 4},        {TokenType::INTEGER, "5", 3, 7},
+      {TokenType::SEMICOLON, ";", 3, 8},
+  };
+  for (const auto &item : expected) {
+    auto tok = lexer.nextToken();
+    REQUIRE(tok.type == item.type);
+    REQUIRE(tok.literal == item.literal);
+    auto location = source->locate(tok.offset);
+    REQUIRE(location.lineNumber == item.line);
+    REQUIRE(location.columnNumber == item.column);
+    // Literals are views into the source rather than copies.
+    REQUIRE(tok.literal.data() >= source->text().data());
+    REQUIRE(tok.literal.data() < source->text().data() + source->text().size());
+  }
+  REQUIRE(lexer.nextToken().type == TokenType::END_OF_FILE);
+}
+
+TEST_CASE("Keyword lookup testing", "[lexer]") {
+  std::pair<std::string, TokenType> pairs[] = {
+      {"fn", TokenType::FUNCTION},   {"let", TokenType::LET},
+      {"true", TokenType::TRUE},     {"false", TokenType::FALSE},
+      {"if", TokenType::IF},         {"else", TokenType::ELSE},
+      {"return", TokenType::RETURN}, {"while", TokenType::WHILE},
+      {"f", TokenType::IDENT},       {"fnn", TokenType::IDENT},
+      {"lets", TokenType::IDENT},    {"While", TokenType::IDENT},
+      {"esle", TokenType::IDENT},    {"returns", TokenType::IDENT},
+      {"", TokenType::IDENT},        {"x", TokenType::IDENT},
+  };
+  for (const auto &pair : pairs) {
+    REQUIRE(tokenTypeToString(lookupIdentity(pair.first)) ==
+            tokenTypeToString(pair.second));
+  }
+}
+
+TEST_CASE("Character scanning testing", "[lexer]") {
+  Scan::CharClass classes[] = {Scan::WHITESPACE, Scan::LETTER, Scan::DIGIT,
+                               Scan::IDENTIFIER, Scan::STRING_BODY, Scan::CODE};
+  std::mt19937 random(7919);
+  auto alphabet = std::string(" \t\n\r_azAZ09\"`@[{/\x80\xff");
+  alphabet += '\0';
+  for (int run = 0; run < 200; run++) {
+    std::string input;
+    auto length = random() % 100;
+    // Long runs of one character cross several vector widths.
+    auto repeated = alphabet[random() % alphabet.size()];
+    for (std::size_t i = 0; i < length; i++) {
+      input += random() % 4 ? repeated : alphabet[random() % alphabet.size()];
+    }
+    for (auto cls : classes) {
+      for (std::size_t from = 0; from <= input.size(); from++) {
+        REQUIRE(Scan::skip(input, from, cls) ==
+                Scan::skipScalar(input, from, cls));
+      }
+    }
+  }
+}
+
+TEST_CASE("Long token testing", "[lexer]") {
+  auto identifier = std::string(70, 'a') + "_9";
+  auto number = std::string(40, '7');
+  auto input = "let " + identifier + " =\n\n" + std::string(50, ' ') + number +
+               ";\n\"" + std::string(40, 'x') + "\n" + std::string(20, 'y') +
+               "\"" + std::string(33, '\n') + "    x";
+  auto lexer = Lexer(input);
+
+  REQUIRE(lexer.nextToken().type == TokenType::LET);
+  auto tok = lexer.nextToken();
+  REQUIRE(tok.literal == identifier);
+  REQUIRE(lexer.nextToken().type == TokenType::ASSIGN);
+  tok = lexer.nextToken();
+  REQUIRE(tok.literal == number);
+  auto location = lexer.getSource()->locate(tok.offset);
+  REQUIRE(location.lineNumber == 3);
+  REQUIRE(location.columnNumber == 50);
+  REQUIRE(lexer.nextToken().type == TokenType::SEMICOLON);
+  tok = lexer.nextToken();
+  REQUIRE(tok.type == TokenType::STRING);
+  REQUIRE(tok.literal.size() == 61);
+  // Newlines inside strings count towards later tokens' locations.
+  tok = lexer.nextToken();
+  REQUIRE(tok.literal == "x");
+  location = lexer.getSource()->locate(tok.offset);
+  REQUIRE(location.lineNumber == 38);
+  REQUIRE(location.columnNumber == 4);
+}
+
+TEST_CASE("Source file testing", "[lexer]") {
+  auto path = std::filesystem::temp_directory_path() / "cmonkey-source.monkey";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "let x = \"mapped\";";
+  }
+  auto source = SourceText::fromFile(path.string());
+  REQUIRE(source);
+  REQUIRE(source->text() == "let x = \"mapped\";");
+
+  auto lexer = Lexer(source);
+  TokenType types[] = {TokenType::LET, TokenType::IDENT, TokenType::ASSIGN,
+                       TokenType::STRING, TokenType::SEMICOLON,
+                       TokenType::END_OF_FILE};
+  for (auto type : types) {
+    REQUIRE(lexer.nextToken().type == type);
+  }
+
+  // Empty files can't be mapped and are read instead.
+  { std::ofstream file(path, std::ios::binary | std::ios::trunc); }
+  source = SourceText::fromFile(path.string());
+  REQUIRE(source);
+  REQUIRE(source->text().empty());
+  REQUIRE(Lexer(source).nextToken().type == TokenType::END_OF_FILE);
+
+  std::filesystem::remove(path);
+  REQUIRE_FALSE(SourceText::fromFile(path.string()));
+}
+
+TEST_CASE("Symbol interning testing", "[lexer]") {
+  auto lexer = Lexer("let count = count + other; count");
+  std::vector<Token> identifiers;
+  for (auto tok = lexer.nextToken(); tok.type != TokenType::END_OF_FILE;
+       tok = lexer.nextToken()) {
+    if (tok.type == TokenType::IDENT) {
+      identifiers.push_back(tok);
+    } else {
+      REQUIRE(tok.symbol == Intern::Symbol());
+    }
+  }
+  REQUIRE(identifiers.size() == 4);
+  REQUIRE(identifiers[0].symbol == identifiers[1].symbol);
+  REQUIRE(identifiers[0].symbol == identifiers[3].symbol);
+  REQUIRE(identifiers[0].symbol != identifiers[2].symbol);
+  REQUIRE(identifiers[0].symbol == Intern::Symbol::intern("count"));
+  REQUIRE(identifiers[2].symbol.name() == "other");
+
+  // Threads interning the same names agree on their IDs.
+  std::vector<std::vector<Intern::Symbol>> results(4);
+  std::vector<std::thread> threads;
+  for (auto &result : results) {
+    threads.emplace_back([&result]() {
+      for (int i = 0; i < 1000; i++) {
+        result.push_back(
+            Intern::Symbol::intern("thread_name_" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &result : results) {
+    REQUIRE(result == results.front());
+  }
+  REQUIRE(results.front()[7].name() == "thread_name_7");
+
+  // Caches agree with the table, whether names hit, miss or evict each
+  // other, and names read back while other threads keep interning.
+  std::vector<int> mismatches(4);
+  threads.clear();
+  for (std::size_t t = 0; t < mismatches.size(); t++) {
+    threads.emplace_back([t, &mismatches]() {
+      Intern::Cache cache;
+      for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 2000; i++) {
+          auto name = "cache_name_" + std::to_string(t) + "_" +
+                      std::to_string(i % (round + 1) == 0 ? i : i / 2);
+          auto symbol = cache.intern(name);
+          mismatches[t] += symbol.name() != name;
+          mismatches[t] += symbol != Intern::Symbol::intern(name);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto count : mismatches) {
+    REQUIRE(count == 0);
+  }
+}
+
+TEST_CASE("Token payload testing", "[lexer]") {
+  auto lexer = Lexer("42 \"hi there\" 99999999999999999999");
+  auto integer = lexer.nextToken();
+  REQUIRE(integer.type == TokenType::INTEGER);
+  REQUIRE(integer.integer == 42);
+  REQUIRE_FALSE(integer.overflow);
+  auto string = lexer.nextToken();
+  REQUIRE(string.type == TokenType::STRING);
+  REQUIRE(string.literal == "hi there");
+  auto overflow = lexer.nextToken();
+  REQUIRE(overflow.type == TokenType::INTEGER);
+  REQUIRE(overflow.overflow);
+}
+
+// Checks that `buffer` holds exactly the tokens a Lexer produces for `input`.
+void requireLexerTokens(const TokenBuffer &buffer, const std::string &input) {
+  Lexer lexer(input);
+  std::size_t index = 0;
+  for (;; index++) {
+    auto expected = lexer.nextToken();
+    REQUIRE(index < buffer.size());
+    auto token = buffer.at(index);
+    REQUIRE(buffer.type(index) == expected.type);
+    REQUIRE(token.type == expected.type);
+    REQUIRE(token.offset == expected.offset);
+    REQUIRE(token.literal == expected.literal);
+    REQUIRE(token.symbol == expected.symbol);
+    REQUIRE(token.integer == expected.integer);
+    REQUIRE(token.overflow == expected.overflow);
+    if (expected.type == TokenType::END_OF_FILE) {
+      break;
+    }
+  }
+  REQUIRE(index + 1 == buffer.size());
+}
+
+TEST_CASE("Token buffer testing", "[lexer]") {
+  std::string input =
+      "let add = fn(a, b) { a + b; };\n"
+      "let s = \"str\"; 99999999999999999999 @ add(1, 2) == 3";
+  requireLexerTokens(TokenBuffer(SourceText::fromString(input)), input);
+}
+
+TEST_CASE("Parallel lexing testing", "[lexer]") {
+  // Fragments that make split points hard to find: strings spanning lines,
+  // comments holding quotes, and NULs that end a string or the input.
+  std::string fragments[] = {
+      "let", " ", "\n", "  ", "x1", "_y", "42", "99999999999999999999",
+      "==", "!=", "!", "=", "/", "//", "// \"quoted\n", "\"a // b\"",
+      "\"line\nbreak\"", "\"", "{", "}", ";", "@", std::string("\0", 1),
+      std::string("\"nul\0", 5)};
+  std::mt19937 random(7919);
+  for (int run = 0; run < 300; run++) {
+    std::string input;
+    auto length = random() % 200;
+    for (std::size_t i = 0; i < length; i++) {
+      input += fragments[random() % std::size(fragments)];
+    }
+    auto source = SourceText::fromString(input);
+    for (std::size_t chunks = 1; chunks <= 8; chunks++) {
+      auto splits = TokenBuffer::splitPoints(input, chunks);
+      REQUIRE(splits.size() < chunks);
+      for (std::size_t i = 0; i < splits.size(); i++) {
+        REQUIRE(Scan::is(input[splits[i]], Scan::WHITESPACE));
+        REQUIRE((i == 0 || splits[i - 1] < splits[i]));
+      }
+      requireLexerTokens(TokenBuffer::parallel(source, chunks), input);
+    }
+  }
+
+  // Inputs with plenty of room get every split they ask for.
+  std::string table = "let data = [\n";
+  for (int i = 0; i < 1000; i++) {
+    table += "  \"row " + std::to_string(i) + "\", " + std::to_string(i) +
+             ", // \"" + std::to_string(i) + "\"\n";
+  }
+  table += "];\n";
+  REQUIRE(TokenBuffer::splitPoints(table, 8).size() == 7);
+  requireLexerTokens(TokenBuffer::parallel(SourceText::fromString(table), 8),
+                     table);
+}
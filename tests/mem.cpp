@@ -1,8 +1,10 @@
 #include <env.hpp>
 #include <eval.hpp>
+#include <gc.hpp>
 #include <iostream>
 #include <lexer.hpp>
 #include <parser.hpp>
+#include <string>
 
 inline std::unique_ptr<AST::Program> testProgramWithInput(std::string input) {
   auto lexer = std::make_unique<Lexer>(input);
@@ -13,7 +15,10 @@ inline std::unique_ptr<AST::Program> testProgramWithInput(std::string input) {
   return program;
 }
 
-int main() {
+int main(int argc, char **argv) {
+  // With --check-live the run fails unless every iteration leaves the heap
+  // at the size it had after the first one.
+  auto checkLive = argc > 1 && std::string(argv[1]) == "--check-live";
   auto input = R"V0G0N(
 let range = fn(start, end) {
   let iter = fn(start, end, res) {
@@ -32,9 +37,24 @@ let range = fn(start, end) {
   std::string itr[] = {"range(1,1000);", "range(1,1000);", "range(1,1000);",
                        "range(1,1000);", "range(1,1000);", "range(1,1000);",
                        "range(1,1000);", "range(1,1000);", "range(1,1000);"};
+  std::size_t baseline = 0;
   for (const auto &str : itr) {
     program = testProgramWithInput(str);
     bag = ASTEvaluator::eval(*program, env);
-    std::cout << bag->inspect() << std::endl;
+    std::cout << bag.inspect() << std::endl;
+    if (!checkLive) {
+      continue;
+    }
+    auto swept = GC::Heap::collect();
+    auto live = GC::Heap::live();
+    std::cout << "swept " << swept << ", live " << live << std::endl;
+    if (baseline == 0) {
+      baseline = live;
+    } else if (live != baseline) {
+      std::cerr << "live objects grew from " << baseline << " to " << live
+                << std::endl;
+      return 1;
+    }
   }
+  return 0;
 }
\ No newline at end of file
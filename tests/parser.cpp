@@ -1,9 +1,12 @@
 #include <spdlog/spdlog.h>
 #include <catch2/catch.hpp>
+#include <flat.hpp>
 #include <iostream>
 #include <lexer.hpp>
+#include <numeric>
 #include <parser.hpp>
 #include <print_dispatcher.hpp>
+#include <resolver.hpp>
 #include <sstream>
 #include <test_helpers.hpp>
 #include <test_parser_helpers.hpp>
@@ -23,7 +26,7 @@ let foobar = 838383;)V0G0N";
   auto stmt = program->getStatements().begin();
 
   for (const std::string &identifier : expectedIdentifiers) {
-    testLetStatement(stmt->get(), identifier);
+    testLetStatement(*stmt, identifier);
     std::advance(stmt, 1);
   };
 };
@@ -33,12 +36,12 @@ TEST_CASE("Let statement with expression", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 2);
   auto stmt = program->getStatements().begin();
-  const auto let1 = testLetStatement(stmt->get(), "x");
+  const auto let1 = testLetStatement(*stmt, "x");
   const auto infix = testInfixExpression(let1->getValue(), "+");
   testIntegerLiteral(infix->getLeft(), "5", 5);
   testIntegerLiteral(infix->getRight(), "50", 50);
   stmt++;
-  const auto let2 = testLetStatement(stmt->get(), "y");
+  const auto let2 = testLetStatement(*stmt, "y");
   testBoolean(let2->getValue(), true);
 };
 
@@ -54,7 +57,7 @@ return 9999999;)V0G0N";
   auto stmt = program->getStatements().begin();
 
   for (const std::string &identifier : expectedIdentifiers) {
-    testReturnStatement(stmt->get());
+    testReturnStatement(*stmt);
     std::advance(stmt, 1);
   };
 };
@@ -64,17 +67,17 @@ TEST_CASE("Return statement with expression", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 2);
   auto stmt = program->getStatements().begin();
-  const auto ret1 = testReturnStatement(stmt->get());
+  const auto ret1 = testReturnStatement(*stmt);
   const auto infix = testInfixExpression(ret1->getReturnValue(), "+");
   testIntegerLiteral(infix->getLeft(), "6", 6);
   testIntegerLiteral(infix->getRight(), "7", 7);
   stmt++;
-  const auto ret2 = testReturnStatement(stmt->get());
+  const auto ret2 = testReturnStatement(*stmt);
   const auto call = testCallExpression(ret2->getReturnValue(), "add");
   auto callArgs = call->getArguments().begin();
-  testIntegerLiteral(callArgs->get(), "1", 1);
+  testIntegerLiteral(*callArgs, "1", 1);
   callArgs++;
-  testIntegerLiteral(callArgs->get(), "2", 2);
+  testIntegerLiteral(*callArgs, "2", 2);
 };
 
 TEST_CASE("Identifier expression statement parsing", "[parser]") {
@@ -83,7 +86,7 @@ TEST_CASE("Identifier expression statement parsing", "[parser]") {
   REQUIRE(program->size() == 1);
 
   auto stmt = program->getStatements().begin();
-  const auto statement = testExpressionStatement(stmt->get());
+  const auto statement = testExpressionStatement(*stmt);
   testIdentifier(statement->getExpression(), "foobar");
 };
 
@@ -93,7 +96,7 @@ TEST_CASE("Integer literal expression statement parsing", "[parser]") {
   REQUIRE(program->size() == 1);
 
   auto stmt = program->getStatements().begin();
-  const auto statement = testExpressionStatement(stmt->get());
+  const auto statement = testExpressionStatement(*stmt);
   testIntegerLiteral(statement->getExpression(), "5", 5);
 };
 
@@ -110,7 +113,7 @@ TEST_CASE("Prefix operator parsing", "[parser]") {
 
     auto stmt = program->getStatements().begin();
 
-    const auto statement = testExpressionStatement(stmt->get());
+    const auto statement = testExpressionStatement(*stmt);
     const auto expression =
         testPrefixExpression(statement->getExpression(), pair.op);
     testIntegerLiteral(expression->getRight(), std::to_string(pair.val),
@@ -163,6 +166,30 @@ TEST_CASE("Prefix operator precedence parsing", "[parser]") {
   };
 };
 
+TEST_CASE("Token buffer parsing", "[parser]") {
+  std::string input =
+      "let f = fn(x) { if (x > 1) { x * f(x - 1) } else { 1 } };\n"
+      "let h = {\"a\": [1, 2][0], true: !false}; f(h[\"a\"]);";
+  auto program = testProgramWithInput(input);
+  auto parser = Parser(
+      std::make_shared<TokenBuffer>(SourceText::fromString(input)));
+  auto buffered = parser.parseProgram();
+  REQUIRE(parser.errors().empty());
+  std::stringstream expected, actual;
+  ASTPrinter::write([&](std::string message) { expected << message; },
+                    *program);
+  ASTPrinter::write([&](std::string message) { actual << message; },
+                    *buffered);
+  REQUIRE(actual.str() == expected.str());
+
+  auto broken = Parser(std::make_shared<TokenBuffer>(
+      SourceText::fromString("let a = 1;\n  let b 2;")));
+  broken.parseProgram();
+  REQUIRE_FALSE(broken.errors().empty());
+  REQUIRE(broken.errors().front().location.lineNumber == 2);
+  REQUIRE(broken.errors().front().location.columnNumber == 8);
+}
+
 TEST_CASE("Hash literal parsing", "[parser]") {
   // spdlog::stdout_color_mt(PARSER_LOGGER);
   auto input = R"V0G0N({"one": 1, "two": 2, "three": 3})V0G0N";
@@ -170,7 +197,7 @@ TEST_CASE("Hash literal parsing", "[parser]") {
 
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto hash = testHashLiteral(statement->getExpression(), 3);
   struct testPair {
     std::string key;
@@ -185,8 +212,8 @@ TEST_CASE("Hash literal parsing", "[parser]") {
   for (const auto &pair : hashPairs) {
     auto expectedPair = pairs.find(pair.first->tokenLiteral());
     REQUIRE(expectedPair != pairs.end());
-    testString(pair.first.get(), expectedPair->first);
-    testIntegerLiteral(pair.second.get(), std::to_string(expectedPair->second),
+    testString(pair.first, expectedPair->first);
+    testIntegerLiteral(pair.second, std::to_string(expectedPair->second),
                        expectedPair->second);
   };
 }
@@ -198,7 +225,7 @@ TEST_CASE("Empty hash literal parsing", "[parser]") {
 
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto hash = testHashLiteral(statement->getExpression(), 0);
   REQUIRE(hash->getPairs().size() == 0);
 }
@@ -208,11 +235,10 @@ TEST_CASE("while expression parsing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   auto stmt = program->getStatements().begin();
-  const auto statement = testExpressionStatement(stmt->get());
+  const auto statement = testExpressionStatement(*stmt);
   const auto whileStmt = testWhileExpression(statement->getExpression());
   const auto body = whileStmt->getBody()->getStatements();
-  testBoolean(testExpressionStatement(body.begin()->get())->getExpression(),
-              true);
+  testBoolean(testExpressionStatement(*body.begin())->getExpression(), true);
 }
 
 TEST_CASE("If expression parsing", "[parser]") {
@@ -221,12 +247,12 @@ TEST_CASE("If expression parsing", "[parser]") {
 
   REQUIRE(program->size() == 1);
   auto stmt = program->getStatements().begin();
-  const auto statement = testExpressionStatement(stmt->get());
+  const auto statement = testExpressionStatement(*stmt);
   const auto expression = testIfExpression(statement->getExpression());
   const auto condition = testInfixExpression(expression->getCondition(), "<");
   testIdentifier(condition->getLeft(), "x");
   testIdentifier(condition->getRight(), "y");
-  auto block = expression->getWhenTrue()->getStatements().begin()->get();
+  auto block = *expression->getWhenTrue()->getStatements().begin();
   testIdentifier(testExpressionStatement(block)->getExpression(), "x");
 }
 
@@ -236,20 +262,20 @@ TEST_CASE("If else expression parsing", "[parser]") {
 
   REQUIRE(program->size() == 1);
   auto stmt = program->getStatements().begin();
-  const auto statement = testExpressionStatement(stmt->get());
+  const auto statement = testExpressionStatement(*stmt);
   const auto expression = testIfExpression(statement->getExpression());
   const auto condition = testInfixExpression(expression->getCondition(), ">");
   testIdentifier(condition->getLeft(), "x");
   testIdentifier(condition->getRight(), "y");
   auto tblockstatements = expression->getWhenTrue()->getStatements();
   testIdentifier(
-      testExpressionStatement(tblockstatements.begin()->get())->getExpression(),
+      testExpressionStatement(*tblockstatements.begin())->getExpression(),
       "w");
   auto fblockstatements = expression->getWhenFalse()->getStatements();
   REQUIRE(fblockstatements.size() == 2);
   auto itr = fblockstatements.begin();
   std::advance(itr, 1);
-  testIdentifier(testExpressionStatement(itr->get())->getExpression(), "q");
+  testIdentifier(testExpressionStatement(*itr)->getExpression(), "q");
 }
 
 TEST_CASE("Function literal parsing", "[parser]") {
@@ -257,16 +283,16 @@ TEST_CASE("Function literal parsing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto fnLit = testFunctionLiteral(statement->getExpression());
   REQUIRE(fnLit->getArguments().size() == 2);
   auto itr = fnLit->getArguments().begin();
-  testIdentifier(itr->get(), "x");
+  testIdentifier(*itr, "x");
   std::advance(itr, 1);
-  testIdentifier(itr->get(), "y");
+  testIdentifier(*itr, "y");
   REQUIRE(fnLit->getBody()->getStatements().size() == 1);
   const auto expr =
-      testExpressionStatement(fnLit->getBody()->getStatements().begin()->get());
+      testExpressionStatement(*fnLit->getBody()->getStatements().begin());
   const auto infx = testInfixExpression(expr->getExpression(), "+");
   testIdentifier(infx->getLeft(), "x");
   testIdentifier(infx->getRight(), "y");
@@ -277,18 +303,18 @@ TEST_CASE("Call expression testing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto call = testCallExpression(statement->getExpression(), "add");
   REQUIRE(call->getArguments().size() == 3);
   auto itr = call->getArguments().begin();
-  testIntegerLiteral(itr->get(), "1", 1);
+  testIntegerLiteral(*itr, "1", 1);
   itr++;
 
-  const auto expr1 = testInfixExpression(itr->get(), "*");
+  const auto expr1 = testInfixExpression(*itr, "*");
   testIntegerLiteral(expr1->getLeft(), "2", 2);
   testIntegerLiteral(expr1->getRight(), "3", 3);
   itr++;
-  const auto expr2 = testInfixExpression(itr->get(), "+");
+  const auto expr2 = testInfixExpression(*itr, "+");
   testIntegerLiteral(expr2->getLeft(), "4", 4);
   testIntegerLiteral(expr2->getRight(), "5", 5);
 }
@@ -298,7 +324,7 @@ TEST_CASE("String parsing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   const auto statement =
-      testLetStatement(program->getStatements().begin()->get(), "x");
+      testLetStatement(*program->getStatements().begin(), "x");
   testString(statement->getValue(), "test 123");
 }
 
@@ -308,18 +334,18 @@ TEST_CASE("Array parsing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto array = testArrayLiteral(statement->getExpression(), 4);
   auto itr = array->getValues().begin();
-  testIntegerLiteral(itr->get(), "3", 3);
+  testIntegerLiteral(*itr, "3", 3);
   itr++;
-  testIntegerLiteral(itr->get(), "4", 4);
+  testIntegerLiteral(*itr, "4", 4);
   itr++;
-  testInfixExpression(itr->get(), "+");
+  testInfixExpression(*itr, "+");
   itr++;
-  const auto fn = testFunctionLiteral(itr->get());
+  const auto fn = testFunctionLiteral(*itr);
   const auto body =
-      testExpressionStatement(fn->getBody()->getStatements().front().get());
+      testExpressionStatement(fn->getBody()->getStatements().front());
   testIdentifier(body->getExpression(), "x");
 }
 
@@ -329,13 +355,192 @@ TEST_CASE("Index expression parsing", "[parser]") {
   auto program = testProgramWithInput(input);
   REQUIRE(program->size() == 1);
   const auto statement =
-      testExpressionStatement(program->getStatements().begin()->get());
+      testExpressionStatement(*program->getStatements().begin());
   const auto expr = testIndexExpression(statement->getExpression());
   testIdentifier(expr->getLeft(), "someArray");
   const auto infix = testInfixExpression(expr->getIndex(), "+");
   testIntegerLiteral(infix->getLeft(), "3", 3);
   testIntegerLiteral(infix->getRight(), "1", 1);
 }
+TEST_CASE("Parser error location", "[parser]") {
+  auto parser = Parser(std::make_unique<Lexer>("let a = 1;\n  let b 2;"));
+  parser.parseProgram();
+  REQUIRE_FALSE(parser.errors().empty());
+  const auto &error = parser.errors().front();
+  REQUIRE(error.token.literal == "2");
+  REQUIRE(error.location.lineNumber == 2);
+  REQUIRE(error.location.columnNumber == 8);
+}
+
+TEST_CASE("Integer overflow testing", "[parser]") {
+  auto program = testProgramWithInput("9223372036854775807");
+  auto statement = dynamic_cast<AST::ExpressionStatement *>(
+      program->getStatements().front());
+  auto literal =
+      dynamic_cast<AST::IntegerLiteral *>(statement->getExpression());
+  REQUIRE(literal);
+  REQUIRE(literal->getValue() == INT64_MAX);
+
+  auto parser = Parser(std::make_unique<Lexer>("1 + 9223372036854775808"));
+  parser.parseProgram();
+  REQUIRE(parser.errors().size() == 1);
+  REQUIRE(parser.errors().front().token.literal == "9223372036854775808");
+  REQUIRE(parser.errors().front().message == "Integer value out of range");
+}
+
+TEST_CASE("Arena testing", "[parser]") {
+  int destroyed = 0;
+  struct Counted {
+    int *destroyed;
+    ~Counted() { (*this->destroyed)++; }
+  };
+  {
+    AST::Arena arena;
+    auto *byte = arena.make<char>('a');
+    auto *wide = arena.make<std::int64_t>(7);
+    REQUIRE(*byte == 'a');
+    REQUIRE(*wide == 7);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(wide) % alignof(std::int64_t) ==
+            0);
+    arena.make<Counted>(Counted{&destroyed});
+    REQUIRE(destroyed == 1);
+
+    // Larger than a block, and the block in use keeps being filled after it.
+    std::vector<int> values(100000);
+    std::iota(values.begin(), values.end(), 0);
+    auto span = arena.copy(values);
+    auto *after = arena.make<int>(3);
+    REQUIRE(span.size() == values.size());
+    REQUIRE(span.back() == 99999);
+    REQUIRE(*after == 3);
+    REQUIRE(arena.copy(std::vector<int>()).empty());
+  }
+  REQUIRE(destroyed == 2);
+
+  auto program = testProgramWithInput("let f = fn(x) { [x, {x: 1}] }; f(1)");
+  REQUIRE(program->getArena().size() > 0);
+  REQUIRE(program->getArena().getSource()->text().find("f(1)") !=
+          std::string::npos);
+}
+
+TEST_CASE("Flat tree testing", "[parser]") {
+  std::string inputs[] = {
+      "",
+      "let f = fn(x, y) { if (x > 1) { x * f(x - 1) } else { return; } };",
+      "let h = {\"a\": [1, 2][0], true: !false}; f(h[\"a\"]); {}",
+      "while { let a = -b + c / d != e; a == \"s\" }",
+      "fn() { fn(a) { return [] } }()(1, 2)",
+  };
+  for (const auto &input : inputs) {
+    auto program = testProgramWithInput(input);
+    auto tree = Flat::Tree::fromProgram(*program);
+    std::stringstream expected;
+    ASTPrinter::write([&](std::string message) { expected << message; },
+                      *program);
+    REQUIRE(tree.toString() == expected.str());
+
+    // Children come before their parents and every node is reached once.
+    std::vector<int> reached(tree.nodes().size());
+    for (std::uint32_t index = 0; index < tree.nodes().size(); index++) {
+      tree.forEachChild(index, [&](std::uint32_t child) {
+        REQUIRE(child < index);
+        reached[child]++;
+      });
+    }
+    reached[tree.root()]++;
+    REQUIRE(std::all_of(reached.begin(), reached.end(),
+                        [](int count) { return count == 1; }));
+    REQUIRE(tree[tree.root()].kind == Flat::Kind::PROGRAM);
+  }
+
+  auto program = testProgramWithInput("let f = fn(a) { fn(b) { a + b } };");
+  Resolver::resolve(*program);
+  auto tree = Flat::Tree::fromProgram(*program);
+  std::vector<Flat::Identifier> identifiers;
+  for (const auto &node : tree.nodes()) {
+    if (node.kind == Flat::Kind::IDENTIFIER) {
+      identifiers.push_back(tree.identifier(node));
+    }
+  }
+  // f, a, b, and then a and b in the body.
+  REQUIRE(identifiers.size() == 5);
+  REQUIRE_FALSE(identifiers[0].resolved);
+  REQUIRE(identifiers[3].symbol.name() == "a");
+  REQUIRE(identifiers[3].resolved);
+  REQUIRE(identifiers[3].depth == 1);
+  REQUIRE(identifiers[4].depth == 0);
+  REQUIRE(identifiers[4].slot == 0);
+}
+TEST_CASE("Lazy function body testing", "[parser]") {
+  auto print = [](AST::Node &node) {
+    std::stringstream ss;
+    ASTPrinter::write([&](std::string message) { ss << message; }, node);
+    return ss.str();
+  };
+  std::string inputs[] = {
+      "let f = fn(x, y) { if (x > 1) { x * f(x - 1) } else { return; } };",
+      "let h = fn() { {\"a\": \"}\", true: fn() { {} }} }; h()",
+      "fn() { fn(a) { return [] } }()(1, 2)",
+      "while { let g = fn(a) { while { a } }; g }",
+  };
+  for (const auto &input : inputs) {
+    auto eager = testProgramWithInput(input);
+    auto lazy = testProgramWithInput(input, FunctionBodies::LAZY);
+    REQUIRE_FALSE(lazy->getArena().deferred().empty());
+    for (auto *literal : lazy->getArena().deferred()) {
+      REQUIRE(literal->isDeferred());
+    }
+    // Printing parses each body as it gets to it.
+    REQUIRE(print(*lazy) == print(*eager));
+    REQUIRE(Parser::validate(*lazy).empty());
+    for (auto *literal : lazy->getArena().deferred()) {
+      REQUIRE_FALSE(literal->isDeferred());
+      REQUIRE(literal->getBody());
+    }
+  }
+
+  auto program = testProgramWithInput(
+      "let f = fn(a) { fn(b) { a + b } }; let g = fn() { 1 };",
+      FunctionBodies::LAZY);
+  const auto &deferred = program->getArena().deferred();
+  REQUIRE(deferred.size() == 2);
+  auto text = program->getArena().getSource()->text();
+  REQUIRE(text.substr(deferred[0]->getBodyBegin(),
+                      deferred[0]->getBodyEnd() -
+                          deferred[0]->getBodyBegin()) ==
+          "{ fn(b) { a + b } }");
+  // Literals in a body are deferred once it's parsed.
+  REQUIRE(deferred[0]->getBody()->getStatements().size() == 1);
+  REQUIRE(deferred.size() == 3);
+  REQUIRE(deferred[2]->isDeferred());
+
+  // Syntax errors in bodies wait for the body to be parsed or validated.
+  std::string input = "let f = fn(x) {\n  let = x;\n};\nlet g = 1;";
+  auto lexer = std::make_unique<Lexer>(input);
+  auto eager = Parser(std::move(lexer));
+  eager.parseProgram();
+  REQUIRE_FALSE(eager.errors().empty());
+  program = testProgramWithInput(input, FunctionBodies::LAZY);
+  auto errors = Parser::validate(*program);
+  REQUIRE(errors.size() == eager.errors().size());
+  REQUIRE(errors.front().message == eager.errors().front().message);
+  REQUIRE(errors.front().location.lineNumber == 2);
+  auto literal = program->getArena().deferred().front();
+  REQUIRE_FALSE(literal->getBody());
+  REQUIRE(literal->getBodyError() ==
+          fmt::format("{} (2, {})", errors.front().message,
+                      errors.front().location.columnNumber));
+  // Validating again reports the same errors.
+  REQUIRE(Parser::validate(*program).size() == errors.size());
+
+  // An unmatched brace is still found while parsing.
+  lexer = std::make_unique<Lexer>(std::string("let f = fn(x) { x + {"));
+  auto lazy = Parser(std::move(lexer), FunctionBodies::LAZY);
+  lazy.parseProgram();
+  REQUIRE(lazy.errors().size() == 1);
+  REQUIRE(lazy.errors().front().message.find("Couldn't find matching }") == 0);
+}
+
 /*
 future
       {"a * [1, 2, 3, 4][b * c] * d", "((a * ([1, 2, 3, 4][(b * c)])) * d)"},
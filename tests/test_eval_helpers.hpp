@@ -1,6 +1,22 @@
 #pragma once
 #include <bag.hpp>
 #include <catch2/catch.hpp>
+#include <eval.hpp>
+#include <vm.hpp>
+
+enum class Engine {
+  AST,
+  VM,
+};
+
+inline Eval::Value evalWithEngine(Engine engine, AST::Program &program) {
+  if (engine == Engine::VM) {
+    auto globals = std::make_shared<VirtualMachine::Globals>();
+    return VirtualMachine::eval(program, globals);
+  }
+  auto env = std::make_shared<Env::Environment>();
+  return ASTEvaluator::eval(program, env);
+}
 
 template <class T>
 struct Pair {
@@ -8,63 +24,44 @@ struct Pair {
   T expected;
 };
 
-inline Eval::IntegerBag *testIntegerBag(Eval::Bag *bag, int64_t value) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::INTEGER_OBJ);
-  const auto ret = dynamic_cast<Eval::IntegerBag *>(bag);
-  REQUIRE(ret);
-  REQUIRE(ret->value() == value);
-  return ret;
-}
-
-inline Eval::IntegerBag *testIntegerBag(std::shared_ptr<Eval::Bag> bag,
-                                        int length) {
-  REQUIRE(bag);
-  return testIntegerBag(bag.get(), length);
+inline void testIntegerBag(const Eval::Value &value, int64_t expected) {
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::INTEGER_OBJ);
+  REQUIRE(value.integer() == expected);
 }
 
-inline Eval::StringBag *testStringBag(std::shared_ptr<Eval::Bag> bag,
-                                      const std::string &value) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::STRING_OBJ);
-  auto ret = std::static_pointer_cast<Eval::StringBag>(bag);
-  REQUIRE(ret->value() == value);
+inline Eval::StringBag *testStringBag(const Eval::Value &value,
+                                      const std::string &expected) {
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::STRING_OBJ);
+  auto ret = Eval::convertToString(value);
+  REQUIRE(ret->value() == expected);
   return ret.get();
 }
 
-inline Eval::BooleanBag *testBooleanBag(std::shared_ptr<Eval::Bag> bag,
-                                        bool value) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::BOOLEAN_OBJ);
-  auto ret = std::static_pointer_cast<Eval::BooleanBag>(bag);
-  REQUIRE(ret->value() == value);
-  return ret.get();
+inline void testBooleanBag(const Eval::Value &value, bool expected) {
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::BOOLEAN_OBJ);
+  REQUIRE(value.boolean() == expected);
 }
 
-inline Eval::ArrayBag *testArrayBag(Eval::Bag *bag, int length) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::ARRAY_OBJ);
-  const auto ret = dynamic_cast<Eval::ArrayBag *>(bag);
-  REQUIRE(ret);
+inline Eval::ArrayBag *testArrayBag(const Eval::Value &value, int length) {
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::ARRAY_OBJ);
+  auto ret = Eval::convertToArray(value);
   REQUIRE(ret->values().size() == length);
-  return ret;
-}
-
-inline Eval::ArrayBag *testArrayBag(std::shared_ptr<Eval::Bag> bag,
-                                    int length) {
-  REQUIRE(bag);
-  return testArrayBag(bag.get(), length);
+  return ret.get();
 }
 
-inline void testNullBag(std::shared_ptr<Eval::Bag> bag) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::NULL_OBJ);
+inline void testNullBag(const Eval::Value &value) {
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::NULL_OBJ);
 }
 
-inline void testErrorBag(std::shared_ptr<Eval::Bag> bag,
+inline void testErrorBag(const Eval::Value &value,
                          const std::string &message) {
-  REQUIRE(bag);
-  REQUIRE(bag->type() == Eval::Type::ERROR_OBJ);
-  auto ret = std::static_pointer_cast<Eval::ErrorBag>(bag);
+  REQUIRE(value);
+  REQUIRE(value.type() == Eval::Type::ERROR_OBJ);
+  auto ret = Eval::convertToError(value);
   REQUIRE(ret->message() == message);
-}
\ No newline at end of file
+}
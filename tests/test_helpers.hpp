@@ -11,9 +11,10 @@ inline void printErrors(const std::vector<ParserError> &errors) {
   }
 }
 
-inline std::unique_ptr<AST::Program> testProgramWithInput(std::string input) {
+inline std::unique_ptr<AST::Program> testProgramWithInput(
+    std::string input, FunctionBodies bodies = FunctionBodies::EAGER) {
   auto lexer = std::make_unique<Lexer>(input);
-  auto parser = Parser(std::move(lexer));
+  auto parser = Parser(std::move(lexer), bodies);
   auto program = parser.parseProgram();
   auto errors = parser.errors();
   printErrors(errors);
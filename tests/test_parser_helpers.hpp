@@ -7,15 +7,6 @@
 #include <sstream>
 #include "spdlog/sinks/stdout_color_sinks.h"
 
-inline AST::IntegerLiteral *testIntegerLiteral(
-    std::shared_ptr<AST::Expression> node, const std::string &str, int num) {
-  const auto expression = dynamic_cast<AST::IntegerLiteral *>(node.get());
-  REQUIRE(expression);
-  REQUIRE(expression->getValue() == num);
-  REQUIRE(expression->tokenLiteral() == str);
-  return expression;
-}
-
 inline AST::IntegerLiteral *testIntegerLiteral(AST::Expression *node,
                                                const std::string &str,
                                                int num) {
@@ -26,24 +17,21 @@ inline AST::IntegerLiteral *testIntegerLiteral(AST::Expression *node,
   return expression;
 }
 
-inline AST::ArrayLiteral *testArrayLiteral(
-    std::shared_ptr<AST::Expression> node, int num) {
-  const auto expression = dynamic_cast<AST::ArrayLiteral *>(node.get());
+inline AST::ArrayLiteral *testArrayLiteral(AST::Expression *node, int num) {
+  const auto expression = dynamic_cast<AST::ArrayLiteral *>(node);
   REQUIRE(expression);
   REQUIRE(expression->size() == num);
   return expression;
 }
 
-inline AST::IndexExpression *testIndexExpression(
-    std::shared_ptr<AST::Expression> node) {
-  const auto expression = dynamic_cast<AST::IndexExpression *>(node.get());
+inline AST::IndexExpression *testIndexExpression(AST::Expression *node) {
+  const auto expression = dynamic_cast<AST::IndexExpression *>(node);
   REQUIRE(expression);
   return expression;
 }
 
-inline AST::WhileExpression *testWhileExpression(
-    std::shared_ptr<AST::Expression> node) {
-  const auto expression = dynamic_cast<AST::WhileExpression *>(node.get());
+inline AST::WhileExpression *testWhileExpression(AST::Expression *node) {
+  const auto expression = dynamic_cast<AST::WhileExpression *>(node);
   REQUIRE(expression);
   return expression;
 }
@@ -72,14 +60,6 @@ inline AST::ExpressionStatement *testExpressionStatement(AST::Statement *node) {
   return statement;
 }
 
-inline AST::Boolean *testBoolean(std::shared_ptr<AST::Expression> node,
-                                 bool expect) {
-  const auto statement = dynamic_cast<AST::Boolean *>(node.get());
-  REQUIRE(statement);
-  REQUIRE(statement->getValue() == expect);
-  return statement;
-}
-
 inline AST::Boolean *testBoolean(AST::Expression *node, bool expect) {
   const auto statement = dynamic_cast<AST::Boolean *>(node);
   REQUIRE(statement);
@@ -87,14 +67,6 @@ inline AST::Boolean *testBoolean(AST::Expression *node, bool expect) {
   return statement;
 }
 
-inline AST::StringLiteral *testString(std::shared_ptr<AST::Expression> node,
-                                      const std::string &expect) {
-  const auto statement = dynamic_cast<AST::StringLiteral *>(node.get());
-  REQUIRE(statement);
-  REQUIRE(statement->getValue() == expect);
-  return statement;
-}
-
 inline AST::StringLiteral *testString(AST::Expression *node,
                                       const std::string &expect) {
   const auto statement = dynamic_cast<AST::StringLiteral *>(node);
@@ -103,49 +75,26 @@ inline AST::StringLiteral *testString(AST::Expression *node,
   return statement;
 }
 
-inline AST::IfExpression *testIfExpression(
-    std::shared_ptr<AST::Expression> node) {
-  const auto statement = dynamic_cast<AST::IfExpression *>(node.get());
-  REQUIRE(statement);
-  return statement;
-}
-
 inline AST::IfExpression *testIfExpression(AST::Expression *node) {
   const auto statement = dynamic_cast<AST::IfExpression *>(node);
   REQUIRE(statement);
   return statement;
 }
 
-inline AST::HashLiteral *testHashLiteral(std::shared_ptr<AST::Expression> node,
+inline AST::HashLiteral *testHashLiteral(AST::Expression *node,
                                          int numberOfPairs) {
-  const auto statement = dynamic_cast<AST::HashLiteral *>(node.get());
+  const auto statement = dynamic_cast<AST::HashLiteral *>(node);
   REQUIRE(statement);
   REQUIRE(statement->getPairs().size() == numberOfPairs);
   return statement;
 }
 
-inline AST::FunctionLiteral *testFunctionLiteral(
-    std::shared_ptr<AST::Expression> node) {
-  const auto statement = dynamic_cast<AST::FunctionLiteral *>(node.get());
-  REQUIRE(statement);
-  return statement;
-}
-
 inline AST::FunctionLiteral *testFunctionLiteral(AST::Expression *node) {
   const auto statement = dynamic_cast<AST::FunctionLiteral *>(node);
   REQUIRE(statement);
   return statement;
 }
 
-inline AST::Identifier *testIdentifier(std::shared_ptr<AST::Expression> node,
-                                       const std::string &val) {
-  const auto expression = dynamic_cast<AST::Identifier *>(node.get());
-  REQUIRE(expression);
-  REQUIRE(expression->getValue() == val);
-  REQUIRE(expression->tokenLiteral() == val);
-  return expression;
-}
-
 inline AST::Identifier *testIdentifier(AST::Expression *node,
                                        const std::string &val) {
   const auto expression = dynamic_cast<AST::Identifier *>(node);
@@ -163,14 +112,6 @@ inline AST::InfixExpression *testInfixExpression(AST::Expression *node,
   return expression;
 }
 
-inline AST::InfixExpression *testInfixExpression(
-    std::shared_ptr<AST::Expression> node, const std::string &op) {
-  const auto expression = dynamic_cast<AST::InfixExpression *>(node.get());
-  REQUIRE(expression);
-  REQUIRE(expression->getOp() == op);
-  return expression;
-}
-
 inline AST::CallExpression *testCallExpression(AST::Expression *node,
                                                const std::string &name) {
   const auto expression = dynamic_cast<AST::CallExpression *>(node);
@@ -178,22 +119,6 @@ inline AST::CallExpression *testCallExpression(AST::Expression *node,
   return expression;
 }
 
-inline AST::CallExpression *testCallExpression(
-    std::shared_ptr<AST::Expression> node, const std::string &name) {
-  const auto expression = dynamic_cast<AST::CallExpression *>(node.get());
-  REQUIRE(expression);
-  testIdentifier(expression->getFunction(), name);
-  return expression;
-}
-
-inline AST::PrefixExpression *testPrefixExpression(
-    std::shared_ptr<AST::Expression> node, const std::string &op) {
-  const auto expression = dynamic_cast<AST::PrefixExpression *>(node.get());
-  REQUIRE(expression);
-  REQUIRE(expression->getOp() == op);
-  return expression;
-}
-
 inline AST::PrefixExpression *testPrefixExpression(AST::Expression *node,
                                                    const std::string &op) {
   const auto expression = dynamic_cast<AST::PrefixExpression *>(node);
@@ -0,0 +1,162 @@
+#include <catch2/catch.hpp>
+#include <code.hpp>
+#include <compiler.hpp>
+#include <test_eval_helpers.hpp>
+#include <test_helpers.hpp>
+#include <vm.hpp>
+
+TEST_CASE("Instruction encoding testing", "[vm]") {
+  auto instruction = Code::make(Code::Opcode::CONSTANT, {65534});
+  REQUIRE(instruction.size() == 3);
+  REQUIRE(instruction[0] == static_cast<uint8_t>(Code::Opcode::CONSTANT));
+  REQUIRE(instruction[1] == 0xFF);
+  REQUIRE(instruction[2] == 0xFE);
+
+  instruction = Code::make(Code::Opcode::CLOSURE, {65535, 255});
+  REQUIRE(Code::instructionsToString(instruction) == "0000 CLOSURE 65535 255\n");
+}
+
+TEST_CASE("Compiler instruction testing", "[vm]") {
+  Pair<std::string> pairs[] = {
+      {"1 + 2", "0000 CONSTANT 0\n0003 CONSTANT 1\n0006 ADD\n0007 POP\n"},
+      {"let x = 1; x", "0000 CONSTANT 0\n0003 SET_GLOBAL 0\n0006 GET_GLOBAL 0\n"
+                       "0009 POP\n"},
+      {"if (true) { 10 }; 3333;",
+       "0000 PUSH_TRUE\n0001 JUMP_NOT_TRUTHY 10\n0004 CONSTANT 0\n"
+       "0007 JUMP 11\n0010 PUSH_NULL\n0011 POP\n0012 CONSTANT 1\n0015 POP\n"},
+      {"len([])", "0000 GET_BUILTIN 1\n0002 ARRAY 0\n0005 CALL 1\n0007 POP\n"},
+  };
+  for (const auto &pair : pairs) {
+    auto program = testProgramWithInput(pair.input);
+    Compiler compiler(Compiler::makeGlobals());
+    compiler.compile(*program);
+    REQUIRE(compiler.errors().empty());
+    REQUIRE(Code::instructionsToString(compiler.bytecode().instructions) ==
+            pair.expected);
+  }
+}
+
+TEST_CASE("Closure compilation testing", "[vm]") {
+  auto program = testProgramWithInput(
+      "let adder = fn(x) { fn(y) { x + y } }; let inc = adder(1);");
+  Compiler compiler(Compiler::makeGlobals());
+  compiler.compile(*program);
+  auto bytecode = compiler.bytecode();
+  auto inner = Eval::convertToCompiledFunction(bytecode.constants.at(0));
+  REQUIRE(inner);
+  REQUIRE(Code::instructionsToString(inner->instructions()) ==
+          "0000 GET_FREE 0\n0002 GET_LOCAL 0\n0004 ADD\n0005 RETURN_VALUE\n");
+  auto outer = Eval::convertToCompiledFunction(bytecode.constants.at(1));
+  REQUIRE(outer);
+  REQUIRE(Code::instructionsToString(outer->instructions()) ==
+          "0000 GET_LOCAL 0\n0002 CLOSURE 0 1\n0006 RETURN_VALUE\n");
+}
+
+TEST_CASE("Engine parity testing", "[vm]") {
+  std::string prelude = R"V0G0N(
+let map = fn(f, arr) {
+  let iter = fn(arr, acc) {
+    if (len(arr) == 0) {
+      acc
+    } else {
+      iter(tail(arr), push(acc, f(head(arr))));
+    }
+  };
+  iter(arr, []);
+};
+let reduce = fn(f, initial, arr) {
+  let iter = fn(arr, res) {
+    if (len(arr) == 0) { res } else { iter(tail(arr), f(res, head(arr))); }
+  };
+  iter(arr, initial);
+};
+let range = fn(start, end) {
+  let iter = fn(start, end, res) {
+    if (start == end) { res } else { iter(start + 1, end, push(res, start)) }
+  }
+  iter(start, end, []);
+}
+let wfold = fn(op, arr) {
+  if (len(arr) != 0) {
+    let acc = head(arr)
+    let arr = tail(arr)
+    while {
+      if (len(arr) == 0) {
+        return acc
+      }
+      let acc = op(acc, head(arr))
+      let arr = tail(arr)
+    }
+  }
+}
+let add = fn(x, y) { x + y };
+)V0G0N";
+  std::string inputs[] = {
+      "map(range(0, 10), fn(x) { x * 2 })",
+      "reduce(add, 0, range(1, 101))",
+      "wfold(add, [1, 2, 3, 4])",
+      "let addTwo = add(2); addTwo(40)",
+      "let f = fn(a, b, c) { a * b + c }; let g = f(2); let h = g(3); h(4)",
+      "let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; "
+      "fib(15)",
+      "{\"a\": 1, 2: \"b\", true: [1]}[2]",
+      "let x = 10; let f = fn() { x }; f() + len(\"four\")",
+      "sprint(\"a\", 1, [1, 2], true)",
+      "add(1, 2, 3)",
+      "1 + fn(){}",
+      "if (len([]) == 0) { return 1; } 2",
+      "fn(x) { x }",
+  };
+  for (const auto &input : inputs) {
+    auto program = testProgramWithInput(prelude + input);
+    auto expected = evalWithEngine(Engine::AST, *program);
+    auto actual = evalWithEngine(Engine::VM, *program);
+    INFO(input);
+    REQUIRE(Eval::typeToString(actual.type()) ==
+            Eval::typeToString(expected.type()));
+    REQUIRE(actual.inspect() == expected.inspect());
+  }
+}
+
+TEST_CASE("VM globals persist between programs", "[vm]") {
+  auto globals = std::make_shared<VirtualMachine::Globals>();
+  auto program = testProgramWithInput("let x = 5; let double = fn(y) { y * 2 };");
+  testNullBag(VirtualMachine::eval(*program, globals));
+  program = testProgramWithInput("double(x)");
+  testIntegerBag(VirtualMachine::eval(*program, globals), 10);
+  program = testProgramWithInput("missing");
+  testErrorBag(VirtualMachine::eval(*program, globals),
+               "identifier not found: missing");
+}
+
+TEST_CASE("Jump range testing", "[vm]") {
+  // Each let compiles to six bytes, so 12000 of them push jump targets past
+  // what a 16-bit operand can hold.
+  auto makeInput = [](int lets, const std::string &tail) {
+    std::string input;
+    for (int i = 0; i < lets; i++) {
+      input += fmt::format("let x{} = {};\n", i, i);
+    }
+    return input + tail;
+  };
+  const std::string branch = "if (x1 < x2) { 222 } else { 333 }";
+  const std::string loop = "while { return 222; }";
+  for (const auto &tail : {branch, loop}) {
+    auto program = testProgramWithInput(makeInput(10000, tail));
+    testIntegerBag(
+        VirtualMachine::eval(*program,
+                             std::make_shared<VirtualMachine::Globals>()),
+        222);
+
+    program = testProgramWithInput(makeInput(12000, tail));
+    Compiler compiler(Compiler::makeGlobals());
+    compiler.compile(*program);
+    REQUIRE(compiler.errors().size() == 2);
+    REQUIRE(compiler.errors().front() ==
+            "too much code in one function to jump over");
+    testErrorBag(
+        VirtualMachine::eval(*program,
+                             std::make_shared<VirtualMachine::Globals>()),
+        "compile error: too much code in one function to jump over");
+  }
+}